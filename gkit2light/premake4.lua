@@ -250,6 +250,41 @@ project("benchv3")
 	files ( gkit_files )
 	files { gkit_dir .. "/tutos/bench/benchv3.cpp" }
 
+project("bench_lights")
+	language "C++"
+	kind "ConsoleApp"
+	targetdir "bin"
+	files ( gkit_files )
+	files { gkit_dir .. "/tutos/bench/bench_lights.cpp" }
+
+project("bench_triangles")
+	language "C++"
+	kind "ConsoleApp"
+	targetdir "bin"
+	files ( gkit_files )
+	files { gkit_dir .. "/tutos/bench/bench_triangles.cpp" }
+
+project("bench_sampling")
+	language "C++"
+	kind "ConsoleApp"
+	targetdir "bin"
+	files ( gkit_files )
+	files { gkit_dir .. "/tutos/bench/bench_sampling.cpp" }
+
+project("bench_export")
+	language "C++"
+	kind "ConsoleApp"
+	targetdir "bin"
+	files ( gkit_files )
+	files { gkit_dir .. "/tutos/bench/bench_export.cpp" }
+
+project("bench_load")
+	language "C++"
+	kind "ConsoleApp"
+	targetdir "bin"
+	files ( gkit_files )
+	files { gkit_dir .. "/tutos/bench/bench_load.cpp" }
+
 
 project("gltf")
 	language "C++"
@@ -2,7 +2,8 @@
 #include <vector>
 #include <cfloat>
 #include <chrono>
-#include <random>
+#include <string>
+#include <cstdlib>
 
 #include "vec.h"
 #include "mat.h"
@@ -13,87 +14,23 @@
 #include "orbiter.h"
 #include "mesh.h"
 #include "wavefront.h"
-
-struct Ray
+#include "mesh_cache.h"
+#include "bvh.h"
+#include "tiles.h"
+#include "sampler.h"
+#include "sampling.h"
+#include "light_sampler.h"
+#include "simd_triangles.h"
+
+// nombres aleatoires : sequence de Sobol brouillee, cf sampler.h. ou PixelSampler, R2Sampler
+typedef SobolSampler Sampler;
+
+// methodes de calcul, cf arguments
+enum Methode
 {
-    Point o;                // origine
-    Vector d;               // direction
-    float tmax;             // position de l'extremite, si elle existe. le rayon est un intervalle [0 tmax]
-    
-    // le rayon est un segment, on connait origine et extremite, et tmax= 1
-    Ray( const Point& origine, const Point& extremite ) : o(origine), d(Vector(origine, extremite)), tmax(1) {}
-    
-    // le rayon est une demi droite, on connait origine et direction, et tmax= \inf
-    Ray( const Point& origine, const Vector& direction ) : o(origine), d(direction), tmax(FLT_MAX) {}
-    
-    // renvoie le point sur le rayon pour t
-    Point point( const float t ) const { return o + t * d; }
-};
-
-
-struct Hit
-{
-    float t;            // p(t)= o + td, position du point d'intersection sur le rayon
-    float u, v;         // p(u, v), position du point d'intersection sur le triangle
-    int triangle_id;    // indice du triangle dans le mesh
-    
-    Hit( ) : t(FLT_MAX), u(), v(), triangle_id(-1) {}
-    Hit( const float _t, const float _u, const float _v, const int _id ) : t(_t), u(_u), v(_v), triangle_id(_id) {}
-    
-    // renvoie vrai si intersection
-    operator bool ( ) { return (triangle_id != -1); }
-};
-
-struct Triangle
-{
-    Point p;            // sommet a du triangle
-    Vector e1, e2;      // aretes ab, ac du triangle
-    int id;             // indice du triangle
-    
-    Triangle( const TriangleData& data, const int _id ) : p(data.a), e1(Vector(data.a, data.b)), e2(Vector(data.a, data.c)), id(_id) {}
-    
-    /* calcule l'intersection ray/triangle
-        cf "fast, minimum storage ray-triangle intersection" 
-        
-        renvoie faux s'il n'y a pas d'intersection valide (une intersection peut exister mais peut ne pas se trouver dans l'intervalle [0 tmax] du rayon.)
-        renvoie vrai + les coordonnees barycentriques (u, v) du point d'intersection + sa position le long du rayon (t).
-        convention barycentrique : p(u, v)= (1 - u - v) * a + u * b + v * c
-    */
-    Hit intersect( const Ray &ray, const float tmax ) const
-    {
-        Vector pvec= cross(ray.d, e2);
-        float det= dot(e1, pvec);
-        
-        float inv_det= 1 / det;
-        Vector tvec(p, ray.o);
-        
-        float u= dot(tvec, pvec) * inv_det;
-        if(u < 0 || u > 1) return Hit();        // pas d'intersection
-        
-        Vector qvec= cross(tvec, e1);
-        float v= dot(ray.d, qvec) * inv_det;
-        if(v < 0 || u + v > 1) return Hit();    // pas d'intersection
-        
-        float t= dot(e2, qvec) * inv_det;
-        if(t > tmax || t < 0) return Hit();     // pas d'intersection
-        
-        return Hit(t, u, v, id);                // p(u, v)= (1 - u - v) * a + u * b + v * c
-    }
-    float area() const
-    {
-        return 0.5f * length(cross(e1, e2));
-    }
-
-    Point getA() const{
-        return p; 
-    }
-    Point getB() const{
-        return p + e1; 
-    }
-    Point getC() const{
-        return p + e2; 
-    }
-
+    EFFICACE= 0,    // eclairage direct, echantillonne les sources
+    SIMPLE= 1,      // eclairage direct, echantillonne l'hemisphere
+    CHEMINS= 2      // eclairage global, sources + brdf, MIS
 };
 
 // renvoie la normale au point d'intersection
@@ -108,48 +45,33 @@ Vector normal( const Mesh& mesh, const Hit& hit )
     return normalize(n);
 }
 
-Color computeColor (const Vector& n, const Point& p, const std::vector<Triangle>& triangles, const int& N)
+Color computeColor (const Vector& n, const Point& p, const BVH& bvh, const int& N, Sampler& sampler, const unsigned pixel)
 {
     //return Color(std::abs(n.x), std::abs(n.y), std::abs(n.z));
 
-    std::random_device hwseed;
-
-    // init d'un générateur de nombre de aleatoire std
-    std::default_random_engine rng( hwseed() );
-    std::uniform_real_distribution<float> uniform(0, 1);
-
     Color color(0, 0, 0, 1.0);
     for(int i= 0; i < N; i++)
     {
-        // genere u1 et u2
-        float u1= uniform( rng );
-        float u2= uniform( rng );
+        // genere u1 et u2, sequence de l'echantillon i du pixel
+        sampler.index(pixel, i);
+        float u1= sampler.sample();
+        float u2= sampler.sample();
     
-        // construit la direction l et évalue sa pdf
-        float cos = u1; 
-        float sin = sqrt(1.0 - cos*cos); 
-        float phi = 2.0 * M_PI * u2; 
-        Vector l= Vector(std::cos(phi) * sin, cos, sin * std::sin(phi));
-        float pdf= 1.0/(2.0 * M_PI);
+        // construit la direction l autour de la normale et évalue sa pdf
+        World world(n);
+        Vector local= sample_cosine_hemisphere(u1, u2);
+        Vector l= world(local);
+        float pdf= pdf_cosine_hemisphere(local.z);
 
         // evalue la fonction
 
         Ray lr (p, normalize(l)); 
-        float V= 1; // 0 ou 1, selon les intersections
-        float tmax= lr.tmax;   // extremite du rayon
+        // 0 ou 1, selon les intersections, pas besoin de l'intersection la plus proche
+        float V= bvh.occluded(lr) ? 0 : 1;
 
         Color emission= Color(1);
-
-        for(int i= 0; i < int(triangles.size()); i++)
-        {
-            if(Hit h= triangles[i].intersect(lr, tmax))
-            {
-                assert(h.t > 0);
-                tmax = h.t; 
-            }
-        }
         
-        float cos_theta= dot(normalize(n), normalize(l));
+        float cos_theta= local.z;
     
         // moyenne
         color = color + emission * V * cos_theta / pdf;
@@ -158,71 +80,68 @@ Color computeColor (const Vector& n, const Point& p, const std::vector<Triangle>
 }
 
 
-Color computeColor (const Vector& n, const Point& p, const std::vector<Triangle>& triangles, const Mesh& mesh, const int& N, std::default_random_engine& rng)
+// direction sur l'hemisphere, et les termes de l'estimateur, cf computeColor
+struct HemisphereSample
+{
+    Ray ray;
+    float cos_theta;
+    float pdf;
+};
+
+HemisphereSample sampleHemisphere (const Vector& n, const Point& p, Sampler& sampler)
 {
-    std::uniform_real_distribution<float> uniform(0, 1);
+    // genere u1 et u2
+    float u1= sampler.sample();
+    float u2= sampler.sample();
+
+    // construit la direction l autour de la normale et évalue sa pdf, proportionnelle a cos theta, cf sampling.h
+    World world(n);
+    Vector local= sample_cosine_hemisphere(u1, u2);
+    float cos_theta= local.z;
+    float pdf= pdf_cosine_hemisphere(cos_theta);
+    Vector l= world(local);
+
+    return { Ray(p, l), cos_theta, pdf };
+}
+
+// evalue la contribution d'une direction, emission de l'intersection, V 0 ou 1 selon les intersections
+Color hemisphereContribution (const HemisphereSample& s, const Color& emission, const float V)
+{
+    return emission * V * s.cos_theta / s.pdf;
+}
 
+// somme des echantillons [first, first + N) du pixel
+Color computeColor (const Vector& n, const Point& p, const BVH& bvh, const Mesh& mesh, const int& N, Sampler& sampler, const unsigned pixel, const int first= 0)
+{
     Color color(0, 0, 0, 1.0);
-    for(int i= 0; i < N; i++)
+    for(int i= first; i < first + N; i++)
     {
-        // genere u1 et u2
-        float u1= uniform( rng );
-        float u2= uniform( rng );
-    
-        // construit la direction l et évalue sa pdf
-        float cos = u1; 
-        float sin = sqrt(1.0 - cos*cos); 
-        float phi = 2.0 * M_PI * u2; 
-        Vector l= Vector(std::cos(phi) * sin, cos, sin * std::sin(phi));
-        float pdf= 1.0/(2.0 * M_PI);
+        // sequence de l'echantillon i du pixel
+        sampler.index(pixel, i);
+        HemisphereSample s= sampleHemisphere(n, p, sampler);
 
         // evalue la fonction
-
-        Ray lr (p, normalize(l)); 
         float V= 0; // 0 ou 1, selon les intersections
-        float tmax= lr.tmax;   // extremite du rayon
-
         Color emission= Color(1);
 
-        for(int i= 0; i < int(triangles.size()); i++)
+        // intersection la plus proche, cf bvh
+        if(Hit h= bvh.intersect(s.ray))
         {
-            if(Hit h= triangles[i].intersect(lr, tmax))
-            {
-                assert(h.t > 0);
-                tmax = h.t; 
-                const Material& material= mesh.triangle_material(h.triangle_id);    // cf la doc de Mesh
-                emission= material.emission;
-                V = 1; 
-            }
+            assert(h.t > 0);
+            const Material& material= mesh.triangle_material(h.triangle_id);    // cf la doc de Mesh
+            emission= material.emission;
+            V = 1; 
         }
         
-        float cos_theta= dot(normalize(n), normalize(l));
-    
         // moyenne
-        color = color + emission * V * cos_theta / pdf;
+        color = color + hemisphereContribution(s, emission, V);
     }
     return color;
 }
 
-int selectSource(const std::vector<float>& cdf, std::default_random_engine& rng) 
-{ 
-    std::uniform_real_distribution<float> U(0, 1); 
-    float u = U(rng); // recherche linéaire (peut être binaire si tu veux) 
-    for(int i = 0; i < (int)cdf.size(); i++) 
-        if(u < cdf[i]) 
-            return i; 
-    
-    return cdf.size() - 1; // fallback 
-}
-
-
-Point pdfTriangle(const Triangle& t, float& pdf){ 
-    std::random_device hwseed;
-    std::default_random_engine rng( hwseed() );
-    std::uniform_real_distribution<float> uniform(0, 1);
-
-    float r1= std::sqrt(uniform( rng ));
-    float u2= uniform( rng );
+Point pdfTriangle(const Triangle& t, float& pdf, Sampler& sampler){ 
+    float r1= std::sqrt(sampler.sample());
+    float u2= sampler.sample();
     
     // generer les coordonnées barycentriques
     float alpha= 1 - r1;
@@ -230,7 +149,7 @@ Point pdfTriangle(const Triangle& t, float& pdf){
     float gamma= u2 * r1;
     
     // construire le point
-    Point q= alpha*t.getA() + beta*t.getB() + gamma*t.getC();
+    Point q= alpha*t.p + beta*(t.p + t.e1) + gamma*(t.p + t.e2);
     
     // evaluer sa densite de proba
     pdf= 1 / t.area();
@@ -239,71 +158,721 @@ Point pdfTriangle(const Triangle& t, float& pdf){
 }
 
 
-Color computeColorMonteCarlo (const Vector& n, const Point& p, const std::vector<Triangle>& triangles, const Mesh& mesh, const int& N, 
-                            const std::vector<Triangle>& sourceLumineuse, std::default_random_engine& rng, const std::vector<float>& cdf)
+// rayon d'ombre vers un point d'une source, et contribution de la source si elle est visible, cf computeColorMonteCarlo
+struct ShadowSample
+{
+    Ray ray;
+    Color contribution;
+};
+
+// renvoie faux si l'echantillon ne contribue pas, pas besoin de rayon d'ombre
+bool sampleSource (const Vector& n, const Point& p, const Mesh& mesh, const std::vector<Triangle>& triangles, const LightSampler& sources, Sampler& sampler, ShadowSample& shadow)
+{
+    // choisit une source, proportionnellement a son aire et a sa puissance
+    LightSample source = sources.sample(sampler.sample()); 
+    if(!source)
+        return false;
+    const Triangle& s = triangles[source.triangle_id]; 
+
+    // puis un point sur la source, densite : proba de choisir la source * densite du point sur la source
+    float pdf = 0; 
+    Point q = pdfTriangle(s, pdf, sampler); 
+    pdf = source.pdf * pdf; 
+
+    Vector l = normalize(q - p);
+    Vector n_s = normalize(cross(s.e1, s.e2));
+    float cosThetaP = std::max(0.0f, dot(n, l));
+    float cosThetaQ = std::max(0.0f, dot(n_s, -l));
+    if(cosThetaP == 0 || cosThetaQ == 0)
+        return false;
+
+    // emission de la source choisie, pas celle de l'intersection
+    Color emission= mesh.triangle_material(source.triangle_id).emission;
+
+    // rayon d'ombre, segment [p q), sans la source : n'importe quelle intersection avant q suffit, cf occluded(ray, 0.999f)
+    shadow.ray= Ray(p, q);
+    shadow.contribution= emission * cosThetaP * cosThetaQ / (length2(q-p) * pdf);
+    return true;
+}
+
+// somme des echantillons [first, first + N) du pixel
+Color computeColorMonteCarlo (const Vector& n, const Point& p, const BVH& bvh, const Mesh& mesh, const int& N, 
+                            const std::vector<Triangle>& triangles, const LightSampler& sources, Sampler& sampler, const unsigned pixel, const int first= 0)
 {
 
     Color color(0, 0, 0, 1.0);
-    for(int i= 0; i < N; i++)
+    for(int i= first; i < first + N; i++)
     {
-        int idSource = selectSource(cdf, rng); 
-        Triangle s = sourceLumineuse[idSource]; 
+        // sequence de l'echantillon i du pixel
+        sampler.index(pixel, i);
 
-        float pdf = 0; 
-        Point q = pdfTriangle(s, pdf); 
+        ShadowSample shadow;
+        if(!sampleSource(n, p, mesh, triangles, sources, sampler, shadow))
+            continue;   // pas de contribution, pas besoin de rayon d'ombre
 
-        Vector l = normalize(q - p);
-        Ray lr(p, l);
-        float V= 0; // 0 ou 1, selon les intersections
-        float tmax= lr.tmax;   // extremite du rayon
+        if(bvh.occluded(shadow.ray, 0.999f))
+            continue;
 
-        Color emission= Color(1);
+        color = color + shadow.contribution;
+    }
 
-        for(int i= 0; i < int(triangles.size()); i++)
+    return color; 
+}
+
+/* brdf blinn-phong normalisee, decrite par les matieres du mesh, cf materials.h :
+    fr(o, l)= diffuse / pi + specular * (ns + 8) / (8 pi) * cos^ns theta_h
+    
+    echantillonnage : melange de cos theta / pi pour la partie diffuse et de (ns + 1) / (2 pi) cos^ns theta_h pour le reflet, 
+    choisi proportionnellement a la reflectance de chaque partie.
+ */
+struct BlinnPhong
+{
+    Color diffuse;
+    Color specular;
+    float ns;
+    float ps;       // probabilite de choisir le reflet
+    
+    BlinnPhong( const Material& material ) : diffuse(material.diffuse), specular(material.specular), ns(material.ns), ps(0)
+    {
+        if(ns <= 0)
+            specular= Color(0);
+        
+        // conservation d'energie, les matieres obj ne la respectent pas forcement...
+        float k= diffuse.max() + specular.max();
+        if(k > 1)
+        {
+            diffuse= diffuse / k;
+            specular= specular / k;
+        }
+        
+        if(k > 0)
+            ps= specular.max() / (diffuse.max() + specular.max());
+    }
+    
+    Color f( const Vector& n, const Vector& o, const Vector& l ) const
+    {
+        Color color= diffuse / float(M_PI);
+        if(ps > 0)
+        {
+            Vector h= normalize(o + l);
+            float cos_theta_h= std::max(0.f, dot(n, h));
+            color= color + specular * (ns + 8) / float(8 * M_PI) * std::pow(cos_theta_h, ns);
+        }
+        return color;
+    }
+    
+    float pdf( const Vector& n, const Vector& o, const Vector& l ) const
+    {
+        float cos_theta= dot(n, l);
+        if(cos_theta <= 0)
+            return 0;
+        
+        float pdf= (1 - ps) * pdf_cosine_hemisphere(cos_theta);
+        if(ps > 0)
+        {
+            Vector h= normalize(o + l);
+            float cos_theta_h= std::max(0.f, dot(n, h));
+            float cos_theta_o= dot(o, h);
+            float d= pdf_cosine_power_hemisphere(ns, cos_theta_h);
+            if(cos_theta_o > 0)
+                pdf= pdf + ps * d / (4 * cos_theta_o);
+        }
+        return pdf;
+    }
+    
+    // genere une direction l, renvoie faux si elle est sous la surface
+    bool sample( const Vector& n, const Vector& o, Sampler& sampler, Vector& l ) const
+    {
+        float u= sampler.sample();
+        float u1= sampler.sample();
+        float u2= sampler.sample();
+        
+        World world(n);
+        if(u < ps)
+        {
+            // demi vecteur autour de la normale, puis reflechit o
+            Vector h= world(sample_cosine_power_hemisphere(ns, u1, u2));
+            l= 2 * dot(o, h) * h - o;
+        }
+        else
+            l= world(sample_cosine_hemisphere(u1, u2));
+        
+        return dot(n, l) > 0;
+    }
+};
+
+// densite de la strategie "sources", exprimee par rapport aux angles solides, pour un point q de la source triangle_id vu dans la direction l depuis p
+float pdfSource( const std::vector<Triangle>& triangles, const LightSampler& sources, const int triangle_id, const Point& p, const Point& q, const Vector& l )
+{
+    const Triangle& s= triangles[triangle_id];
+    Vector n_s= normalize(cross(s.e1, s.e2));
+    float cos_theta_q= dot(n_s, -l);
+    if(cos_theta_q <= 0)
+        return 0;
+    
+    return sources.pdf(triangle_id) / s.area() * length2(q - p) / cos_theta_q;
+}
+
+// chemin complet depuis le point p vu dans la direction -o, renvoie la lumiere reflechie, sans l'emission de p.
+// eclairage direct : combine les strategies sources et brdf avec l'heuristique balance, MIS, rebonds : roulette russe.
+Color pathSample( Vector n, Point p, Vector o, const Material& material, const BVH& bvh, const Mesh& mesh, 
+    const std::vector<Triangle>& triangles, const LightSampler& sources, Sampler& sampler )
+{
+    const int maxRebonds= 16;
+    
+    Color color(0, 0, 0, 0);
+    Color weight(1, 1, 1, 1);    // produit fr * cos / pdf le long du chemin
+    BlinnPhong brdf(material);
+    for(int rebond= 0; rebond < maxRebonds; rebond++)
+    {
+        // normale du cote de l'observateur
+        if(dot(n, o) < 0)
+            n= -n;
+        
+        // strategie sources
+        if(LightSample source= sources.sample(sampler.sample()))
         {
-            if(Hit h= triangles[i].intersect(lr, tmax))
+            float pdf_area= 0;
+            Point q= pdfTriangle(triangles[source.triangle_id], pdf_area, sampler);
+            Vector l= normalize(q - p);
+            float cos_theta= dot(n, l);
+            if(cos_theta > 0)
             {
-                assert(h.t > 0);
-                tmax = h.t; 
-                const Material& material= mesh.triangle_material(h.triangle_id);    // cf la doc de Mesh
-                emission= material.emission;
-                V = 1; 
+                float pdf_source= pdfSource(triangles, sources, source.triangle_id, p, q, l);
+                if(pdf_source > 0 && !bvh.occluded(Ray(p, q), 0.999f))
+                {
+                    float pdf_brdf= brdf.pdf(n, o, l);
+                    float w= pdf_source / (pdf_source + pdf_brdf);
+                    Color emission= mesh.triangle_material(source.triangle_id).emission;
+                    color= color + weight * brdf.f(n, o, l) * emission * (w * cos_theta / pdf_source);
+                }
             }
         }
-        Vector n_s = normalize(cross(s.e1, s.e2));
-        float cosThetaP = std::max(0.0f, dot(n, l));
-        float cosThetaQ = std::max(0.0f, dot(n_s, -l));
-
-        color = color + emission * V * cosThetaP * cosThetaQ / (length2(q-p) * pdf);
+        
+        // strategie brdf, prolonge le chemin
+        Vector l;
+        if(!brdf.sample(n, o, sampler, l))
+            break;
+        
+        l= normalize(l);
+        float pdf_brdf= brdf.pdf(n, o, l);
+        if(pdf_brdf <= 0)
+            break;
+        weight= weight * brdf.f(n, o, l) * (dot(n, l) / pdf_brdf);
+        
+        Ray ray(p, l);
+        Hit hit= bvh.intersect(ray);
+        if(!hit)
+            break;
+        
+        Point q= ray.o + hit.t * ray.d;
+        const Material& hit_material= mesh.triangle_material(hit.triangle_id);
+        if(hit_material.emission.power() > 0)
+        {
+            float pdf_source= pdfSource(triangles, sources, hit.triangle_id, p, q, l);
+            if(pdf_source > 0)
+            {
+                float w= pdf_brdf / (pdf_brdf + pdf_source);
+                color= color + weight * hit_material.emission * w;
+            }
+        }
+        
+        // roulette russe, apres quelques rebonds
+        if(rebond >= 2)
+        {
+            float survie= std::min(0.95f, weight.max());
+            if(sampler.sample() >= survie)
+                break;
+            weight= weight / survie;
+        }
+        
+        // point suivant
+        n= normal(mesh, hit);
+        o= -l;
+        if(dot(n, o) < 0)
+            n= -n;
+        p= q + 0.0001 * n;
+        brdf= BlinnPhong(hit_material);
+    }
+    
+    return color;
+}
 
+// somme des echantillons [first, first + N) du pixel, eclairage global
+Color computeColorPath (const Vector& n, const Point& p, const Vector& o, const Material& material, const BVH& bvh, const Mesh& mesh, const int& N,
+                            const std::vector<Triangle>& triangles, const LightSampler& sources, Sampler& sampler, const unsigned pixel, const int first= 0)
+{
+    Color color(0, 0, 0, 1.0);
+    for(int i= first; i < first + N; i++)
+    {
+        // sequence de l'echantillon i du pixel
+        sampler.index(pixel, i);
+        color= color + pathSample(n, p, o, material, bvh, mesh, triangles, sources, sampler);
     }
+    
+    return color;
+}
 
+// point visible dans un pixel, calcule une seule fois pour toutes les passes du rendu progressif
+struct PixelHit
+{
+    Vector n;
+    Point p;
+    Vector o;           // direction vers la camera
+    Color diffuse;      // facteur applique a la moyenne des echantillons, 1 pour les chemins qui evaluent deja la brdf
+    Color emission;
+    int triangle_id;
+    bool hit;
+};
 
-    return color; 
+// statistiques d'un pixel, moyenne et variance incrementales, cf Welford
+// https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Welford's_online_algorithm
+struct PixelStats
+{
+    Color sum;      // somme des echantillons
+    int n;          // nombre d'echantillons
+    float mean;     // moyenne de la luminance des echantillons
+    float m2;       // somme des carres des ecarts a la moyenne
+    bool done;      // le pixel a converge, ou a atteint le nombre max d'echantillons
+    
+    void insert( const Color& sample, const float y )
+    {
+        sum= sum + sample;
+        n++;
+        float delta= y - mean;
+        mean= mean + delta / n;
+        m2= m2 + delta * (y - mean);
+    }
+    
+    // erreur relative de la moyenne : ecart type de la moyenne / moyenne
+    bool converged( const float seuil ) const
+    {
+        float variance= (n > 1) ? m2 / (n -1) : 0;
+        return std::sqrt(variance / n) <= seuil * mean;
+    }
+};
+
+/* rendu progressif : accumule des passes de quelques echantillons par pixel, et arrete les pixels dont l'erreur relative est inferieure a seuil.
+    ecrit l'image toutes les checkpoint secondes, renvoie le nombre total d'echantillons.
+ */
+long long renderProgressive( Image& image, const Transform& inv, const Mesh& mesh, const BVH& bvh, const std::vector<Triangle>& triangles, const LightSampler& sources,
+    const Methode methode, const uint64_t seed, const int maxRayons, const float seuil, const float checkpoint, const char *filename )
+{
+    const int minRayons= std::min(16, maxRayons);  // nombre d'echantillons avant de tester la convergence
+    const int passRayons= 8;                        // nombre d'echantillons par passe
+    
+    int width= image.width();
+    int height= image.height();
+    std::vector<PixelHit> hits(width * height);
+    std::vector<PixelStats> stats(width * height, PixelStats { Color(0, 0, 0, 0), 0, 0, 0, false });
+    
+    TileScheduler scheduler(width, height);
+    
+    // visibilite : 1 rayon au centre de chaque pixel, les pixels sans intersection ne sont plus calcules
+    scheduler.run(
+        [&]( Tile& tile )
+        {
+            for(int y= tile.y0; y < tile.y1; y++)
+            for(int x= tile.x0; x < tile.x1; x++)
+            {
+                Point origine= inv(Point(x + float(0.5), y + float(0.5), 0));
+                Point extremite= inv(Point(x + float(0.5), y + float(0.5), 1));
+                Ray ray(origine, extremite);
+                
+                PixelHit& pixel= hits[y * width + x];
+                pixel.hit= false;
+                if(Hit hit= bvh.intersect(ray))
+                {
+                    const Material& material= mesh.triangle_material(hit.triangle_id);
+                    pixel.n= normal(mesh, hit);
+                    pixel.p= ray.o + hit.t * ray.d + 0.0001 * pixel.n;
+                    pixel.o= normalize(-ray.d);
+                    pixel.diffuse= (methode == CHEMINS) ? Color(1) : material.diffuse;
+                    pixel.emission= material.emission;
+                    pixel.triangle_id= hit.triangle_id;
+                    pixel.hit= true;
+                }
+                else
+                    stats[y * width + x].done= true;
+            }
+        });
+    
+    auto start= std::chrono::high_resolution_clock::now();
+    float last= 0;
+    long long total= 0;
+    for(int pass= 0; ; pass++)
+    {
+        scheduler.run(
+            [&]( Tile& tile )
+            {
+                Sampler sampler(seed);
+                bool converged= true;
+                for(int y= tile.y0; y < tile.y1; y++)
+                for(int x= tile.x0; x < tile.x1; x++)
+                {
+                    unsigned id= y * width + x;
+                    PixelStats& pixel= stats[id];
+                    if(pixel.done)
+                        continue;
+                    
+                    const PixelHit& hit= hits[id];
+                    int count= std::min(passRayons, maxRayons - pixel.n);
+                    for(int k= 0; k < count; k++)
+                    {
+                        // 1 echantillon a la fois, pour estimer la variance. meme sequence aleatoire que le rendu complet
+                        Color sample;
+                        if(methode == SIMPLE)
+                            sample= computeColor(hit.n, hit.p, bvh, mesh, 1, sampler, id, pixel.n);
+                        else if(methode == CHEMINS)
+                            sample= computeColorPath(hit.n, hit.p, hit.o, mesh.triangle_material(hit.triangle_id), bvh, mesh, 1, triangles, sources, sampler, id, pixel.n);
+                        else
+                            sample= computeColorMonteCarlo(hit.n, hit.p, bvh, mesh, 1, triangles, sources, sampler, id, pixel.n);
+                        
+                        pixel.insert(sample, (hit.diffuse * sample).power());
+                    }
+                    
+                    if(pixel.n >= maxRayons)
+                        pixel.done= true;
+                    else if(pixel.n < minRayons || !pixel.converged(seuil))
+                        converged= false;
+                }
+                
+                // arrete le bloc lorsque tous ses pixels ont converge. 
+                // un pixel seul n'est pas fiable : ses premiers echantillons peuvent tous etre identiques dans une penombre...
+                if(converged)
+                    for(int y= tile.y0; y < tile.y1; y++)
+                    for(int x= tile.x0; x < tile.x1; x++)
+                        stats[y * width + x].done= true;
+            });
+        
+        // bilan de la passe
+        int active= 0;
+        long long samples= 0;
+        for(unsigned i= 0; i < stats.size(); i++)
+        {
+            if(!stats[i].done) active++;
+            samples+= stats[i].n;
+        }
+        total= samples;
+        
+        float elapsed= std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+        printf("pass %d: %d active pixels, %.2f rays/pixel, %.1fs\n", pass, active, double(samples) / (width * height), elapsed);
+        
+        // resout l'image : moyenne des echantillons
+        bool end= (active == 0);
+        if(end || elapsed - last >= checkpoint)
+        {
+            last= elapsed;
+            for(unsigned i= 0; i < stats.size(); i++)
+            {
+                if(!hits[i].hit)
+                    continue;
+                
+                Color color= hits[i].diffuse * stats[i].sum / float(stats[i].n) + hits[i].emission;
+                color.a= 1;
+                image(i)= color;
+            }
+            
+            write_image(image, (std::string(filename) + ".png").c_str());
+            write_image_hdr(image, (std::string(filename) + ".hdr").c_str());
+        }
+        
+        if(end)
+            break;
+    }
+    
+    return total;
 }
 
-int main( const int argc, const char **argv )
+// rendu wavefront : les rayons sont generes par paquets, ranges dans des files, et chaque etape traite toute une file a la fois.
+// l'etape d'intersection est un parametre : bvh ou paquets de 8 rayons, cf BVHIntersector et PacketIntersector.
+
+// intersections avec le bvh, 1 rayon a la fois
+struct BVHIntersector
 {
+    const BVH& bvh;
+    
+    // intersection la plus proche de chaque rayon, entre 0 et ray.tmax
+    void intersect( const std::vector<Ray>& rays, std::vector<Hit>& hits ) const
+    {
+        hits.resize(rays.size());
+        for(unsigned i= 0; i < rays.size(); i++)
+            hits[i]= bvh.intersect(rays[i]);
+    }
+    
+    // visibilite de chaque rayon, entre 0 et htmax
+    void occluded( const std::vector<Ray>& rays, const float htmax, std::vector<char>& hidden ) const
+    {
+        hidden.resize(rays.size());
+        for(unsigned i= 0; i < rays.size(); i++)
+            hidden[i]= bvh.occluded(rays[i], htmax);
+    }
+};
+
+// intersections par paquets de 8 rayons, teste tous les triangles, cf simd_triangles.h. interessant pour les scenes simples...
+struct PacketIntersector
+{
+    const std::vector<Triangle>& triangles;
+    
+    // remplit un paquet avec les rayons [i, i+8), le dernier paquet est complete avec le rayon i
+    static int packet( const std::vector<Ray>& rays, const unsigned i, RayBlock& block )
+    {
+        int n= std::min(8, int(rays.size() - i));
+        for(int k= 0; k < 8; k++)
+            block.set(k, rays[i + (k < n ? k : 0)]);
+        return n;
+    }
+    
+    void intersect( const std::vector<Ray>& rays, std::vector<Hit>& hits ) const
+    {
+        hits.resize(rays.size());
+        for(unsigned i= 0; i < rays.size(); i+= 8)
+        {
+            RayBlock block;
+            int n= packet(rays, i, block);
+            
+            HitBlock hit_block;
+            for(int k= 0; k < n; k++)
+                hit_block.t[k]= rays[i+k].tmax;
+            
+            for(unsigned t= 0; t < triangles.size(); t++)
+                ::intersect(triangles[t], block, hit_block);
+            
+            for(int k= 0; k < n; k++)
+                hits[i+k]= hit_block.hit(k);
+        }
+    }
+    
+    void occluded( const std::vector<Ray>& rays, const float htmax, std::vector<char>& hidden ) const
+    {
+        hidden.resize(rays.size());
+        for(unsigned i= 0; i < rays.size(); i+= 8)
+        {
+            RayBlock block;
+            int n= packet(rays, i, block);
+            
+            HitBlock hit_block(htmax);
+            for(unsigned t= 0; t < triangles.size(); t++)
+            {
+                ::intersect(triangles[t], block, hit_block);
+                
+                // arrete le paquet lorsque tous les rayons sont bloques
+                bool all= true;
+                for(int k= 0; k < 8; k++)
+                    all= all && (hit_block.triangle_id[k] != -1);
+                if(all)
+                    break;
+            }
+            
+            for(int k= 0; k < n; k++)
+                hidden[i+k]= (hit_block.triangle_id[k] != -1);
+        }
+    }
+};
 
-    std::random_device hwseed;
+// file de rayons : le rayon et l'indice de l'entree qui l'a genere
+struct RayQueue
+{
+    std::vector<Ray> rays;
+    std::vector<unsigned> ids;
+    
+    void clear( ) { rays.clear(); ids.clear(); }
+    void push( const Ray& ray, const unsigned id ) { rays.push_back(ray); ids.push_back(id); }
+    unsigned size( ) const { return unsigned(rays.size()); }
+};
 
-    // init d'un générateur de nombre de aleatoire std
-    std::default_random_engine rng( hwseed() );
+/* meme image que le rendu par pixel, cf main : les echantillons de chaque pixel sont accumules dans le meme ordre.
+    etapes, pour chaque bloc de pixels :
+        camera : genere les rayons primaires du bloc, puis intersect( ),
+        shade : genere les echantillons de chaque pixel touche, file shadow (sources) ou file extend (hemisphere),
+        shadow / extend : occluded( ) ou intersect( ) sur toute la file,
+        accumule les contributions visibles.
+    les echantillons sont traites par groupes de chunkRayons par pixel, pour limiter la taille des files.
+ */
+template< typename Intersector >
+int renderWavefront( Image& image, const Transform& inv, const Mesh& mesh, const Intersector& intersector, const std::vector<Triangle>& triangles, const LightSampler& sources,
+    const bool simple, const uint64_t seed, const int NbRayons )
+{
+    const int chunkRayons= 16;
+    const int width= image.width();
+    
+    TileScheduler scheduler(image.width(), image.height());
+    return scheduler.run(
+        [&]( Tile& tile )
+        {
+            Sampler sampler(seed);
+            
+            RayQueue camera;
+            RayQueue extend;
+            RayQueue shadow;
+            std::vector<Hit> hits;
+            std::vector<char> hidden;
+            std::vector<HemisphereSample> hemisphere;
+            std::vector<Color> contributions;
+            
+            // etape camera : rayons primaires du bloc
+            for(int y= tile.y0; y < tile.y1; y++)
+            for(int x= tile.x0; x < tile.x1; x++)
+            {
+                Point origine= inv(Point(x + float(0.5), y + float(0.5), 0));
+                Point extremite= inv(Point(x + float(0.5), y + float(0.5), 1));
+                camera.push(Ray(origine, extremite), y * width + x);
+            }
+            intersector.intersect(camera.rays, hits);
+            
+            // pixels touches
+            std::vector<PixelHit> pixels;
+            std::vector<unsigned> ids;
+            for(unsigned i= 0; i < camera.size(); i++)
+            {
+                const Hit& hit= hits[i];
+                if(!hit)
+                    continue;
+                
+                const Ray& ray= camera.rays[i];
+                const Material& material= mesh.triangle_material(hit.triangle_id);
+                Vector n= normal(mesh, hit);
+                pixels.push_back( { n, ray.o + hit.t * ray.d + 0.0001 * n, normalize(-ray.d), material.diffuse, material.emission, hit.triangle_id, true } );
+                ids.push_back(camera.ids[i]);
+            }
+            
+            std::vector<Color> colors(pixels.size(), Color(0, 0, 0, 1.0));
+            for(int first= 0; first < NbRayons; first+= chunkRayons)
+            {
+                int last= std::min(NbRayons, first + chunkRayons);
+                
+                // etape shade : genere les echantillons [first, last) de chaque pixel, dans l'ordre
+                extend.clear();
+                shadow.clear();
+                hemisphere.clear();
+                contributions.clear();
+                for(unsigned k= 0; k < pixels.size(); k++)
+                for(int i= first; i < last; i++)
+                {
+                    sampler.index(ids[k], i);
+                    if(simple)
+                    {
+                        HemisphereSample s= sampleHemisphere(pixels[k].n, pixels[k].p, sampler);
+                        extend.push(s.ray, k);
+                        hemisphere.push_back(s);
+                    }
+                    else
+                    {
+                        ShadowSample s;
+                        if(sampleSource(pixels[k].n, pixels[k].p, mesh, triangles, sources, sampler, s))
+                        {
+                            shadow.push(s.ray, k);
+                            contributions.push_back(s.contribution);
+                        }
+                    }
+                }
+                
+                // etapes extend / shadow, puis accumule les contributions
+                if(simple)
+                {
+                    intersector.intersect(extend.rays, hits);
+                    for(unsigned i= 0; i < extend.size(); i++)
+                    {
+                        float V= 0;
+                        Color emission= Color(1);
+                        if(hits[i])
+                        {
+                            emission= mesh.triangle_material(hits[i].triangle_id).emission;
+                            V= 1;
+                        }
+                        
+                        colors[extend.ids[i]]= colors[extend.ids[i]] + hemisphereContribution(hemisphere[i], emission, V);
+                    }
+                }
+                else
+                {
+                    intersector.occluded(shadow.rays, 0.999f, hidden);
+                    for(unsigned i= 0; i < shadow.size(); i++)
+                        if(!hidden[i])
+                            colors[shadow.ids[i]]= colors[shadow.ids[i]] + contributions[i];
+                }
+            }
+            
+            // resout les pixels du bloc
+            for(unsigned k= 0; k < pixels.size(); k++)
+            {
+                Color color= pixels[k].diffuse * colors[k] / float(NbRayons) + pixels[k].emission;
+                color.a= 1.0;
+                image(ids[k])= color;
+            }
+        },
+        print_progress);
+}
 
+int main( const int argc, const char **argv )
+{
+    // options : --progressive [seuil], --checkpoint secondes, --seed graine et --wavefront [bvh | packet], les autres arguments sont positionnels
+    bool progressive= false;
+    const char *wavefront= nullptr;
+    uint64_t seed= 0;
+    float seuil= 0.02f;
+    float checkpoint= 10;
+    std::vector<const char *> args;
+    for(int i= 0; i < argc; i++)
+    {
+        std::string option= argv[i];
+        if(option == "--progressive")
+        {
+            progressive= true;
+            if(i +1 < argc)
+            {
+                // seuil optionnel : uniquement si l'argument suivant est un nombre complet, .05, 1e-2, etc
+                char *end= nullptr;
+                float value= std::strtof(argv[i+1], &end);
+                if(end != argv[i+1] && *end == 0)
+                {
+                    seuil= value;
+                    i++;
+                }
+            }
+        }
+        else if(option == "--checkpoint" && i +1 < argc)
+            checkpoint= std::stof(argv[++i]);
+        else if(option == "--seed" && i +1 < argc)
+            seed= std::stoull(argv[++i]);
+        else if(option == "--wavefront")
+        {
+            wavefront= "bvh";
+            if(i +1 < argc && (std::string(argv[i+1]) == "bvh" || std::string(argv[i+1]) == "packet"))
+                wavefront= argv[++i];
+        }
+        else
+            args.push_back(argv[i]);
+    }
+    
     int NbRayons = 16; 
-    if(argc > 1){
-        NbRayons = std::stoi(argv[1]);
+    if(args.size() > 1){
+        NbRayons = std::stoi(args[1]);
     }
     std::cerr<<"Nombre de rayons choisi : "<<NbRayons<<std::endl;   
 
     const char *mesh_filename= "data/cornell.obj";
     const char *orbiter_filename= "data/cornell_orbiter.txt";
+    if(args.size() > 3)
+    {
+        // autre scene, et sa camera si elle est fournie
+        mesh_filename= args[3];
+        orbiter_filename= (args.size() > 4) ? args[4] : nullptr;
+    }
+
+    Mesh mesh= read_mesh_cache(mesh_filename);
+    if(mesh.triangle_count() == 0)
+        return 1;
     
     Orbiter camera;
-    if(camera.read_orbiter(orbiter_filename) < 0)
+    if(orbiter_filename == nullptr)
+    {
+        Point pmin, pmax;
+        mesh.bounds(pmin, pmax);
+        camera.lookat(pmin, pmax);
+    }
+    else if(camera.read_orbiter(orbiter_filename) < 0)
         return 1;
-
-    Mesh mesh= read_mesh(mesh_filename);
     
     int n= mesh.triangle_count();
 
@@ -314,32 +883,20 @@ int main( const int argc, const char **argv )
             triangles.emplace_back(mesh.triangle(i), i);
     }
 
-    std::vector<Triangle> sourceLumineuse;
+    // construit le bvh des triangles
+    BVH bvh;
     {
-        for(int i =0; i<n; i++){
-            const Material& material=mesh.triangle_material(i);
-            if(material.emission.r != 0 || material.emission.g != 0 || material.emission.b != 0){
-                sourceLumineuse.push_back(triangles[i]); 
-            }
-        }
+        auto start= std::chrono::high_resolution_clock::now();
+        bvh.build(triangles);
+        auto stop= std::chrono::high_resolution_clock::now();
+        int cpu= std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+        printf("bvh: %d triangles, %d nodes, %dms\n", n, bvh.node_count(), cpu);
     }
 
-    // fonction de répartition cumulative
-    std::vector<float> cdf;  
-    {
-        cdf.reserve(sourceLumineuse.size());
-
-        float totalArea = 0.0f;
-        for(const Triangle& s : sourceLumineuse)
-            totalArea += s.area();
-
-        float cumul = 0.0f;
-        for(const Triangle& s : sourceLumineuse)
-        {
-            cumul += s.area() / totalArea;
-            cdf.push_back(cumul);
-        }
-    }
+    // sources de lumiere : triangles emissifs, choisis proportionnellement a aire * puissance
+    LightSampler sources;
+    if(sources.build(mesh) == 0)
+        std::cerr<<"pas de sources de lumiere..."<<std::endl;
 
 
     //
@@ -353,82 +910,107 @@ int main( const int argc, const char **argv )
     Transform viewport= camera.viewport();
     Transform inv= Inverse(viewport * projection * view * model);
     
-auto start= std::chrono::high_resolution_clock::now();
+    // mode de calcul, cf arguments
+    Methode methode= EFFICACE;
+    if(args.size() > 2 && std::string(args[2]) == "1")
+        methode= SIMPLE;
+    else if(args.size() > 2 && std::string(args[2]) == "2")
+        methode= CHEMINS;
     
-    // parcours tous les pixels de l'image
-    for(int y= 0; y < image.height(); y++)
-    for(int x= 0; x < image.width(); x++)
+    bool simple= (methode == SIMPLE);
+    if(simple)
+        std::cerr<<"Monte Carlo simple choisi "<<std::endl;   
+    else if(methode == CHEMINS)
+        std::cerr<<"Monte Carlo, chemins et MIS choisi "<<std::endl;
+    else
+        std::cerr<<"Monte Carlo orienté vers les sources de lumières choisi "<<std::endl;
+    const char *filename= simple ? "rendu_monteCarlo_simple" : "rendu_monteCarlo_efficace";
+    if(methode == CHEMINS)
+        filename= "rendu_monteCarlo_chemins";
+    
+    if(progressive)
     {
-        // generer le rayon au centre du pixel
-        Point origine= inv(Point(x + float(0.5), y + float(0.5), 0));
-        Point extremite= inv(Point(x + float(0.5), y + float(0.5), 1));
-        Ray ray(origine, extremite);
-        
-        // calculer les intersections avec tous les triangles
-        Hit hit;                // proprietes de l'intersection
-        float tmax= ray.tmax;   // extremite du rayon
-        for(int i= 0; i < int(triangles.size()); i++)
-        {
-            if(Hit h= triangles[i].intersect(ray, tmax))
-            {
-                // ne conserve que l'intersection *valide* la plus proche de l'origine du rayon
-                assert(h.t > 0);
-                hit= h;
-                tmax= h.t;
-            }
-        }
+        // NbRayons est le nombre max d'echantillons par pixel
+        auto start= std::chrono::high_resolution_clock::now();
+        long long total= renderProgressive(image, inv, mesh, bvh, triangles, sources, methode, seed, NbRayons, seuil, checkpoint, filename);
+        auto stop= std::chrono::high_resolution_clock::now();
+        int cpu= std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+        printf("%dms, %lld rays, %.2f rays/pixel\n", cpu, total, double(total) / (image.width() * image.height()));
+        return 0;
+    }
+    
+    if(wavefront && methode == CHEMINS)
+        std::cerr<<"wavefront : pas de chemins, rendu pixel par pixel..."<<std::endl;
+    else if(wavefront)
+    {
+        int cpu= 0;
+        if(std::string(wavefront) == "packet")
+            cpu= renderWavefront(image, inv, mesh, PacketIntersector { triangles }, triangles, sources, simple, seed, NbRayons);
+        else
+            cpu= renderWavefront(image, inv, mesh, BVHIntersector { bvh }, triangles, sources, simple, seed, NbRayons);
+        printf("wavefront %s: %dms\n", wavefront, cpu);
         
-        if(hit)
+        write_image(image, (std::string(filename) + ".png").c_str());
+        write_image_hdr(image, (std::string(filename) + ".hdr").c_str());
+        return 0;
+    }
+    
+    // parcours tous les pixels de l'image, par blocs, sur tous les threads
+    TileScheduler scheduler(image.width(), image.height());
+    int cpu= scheduler.run(
+        [&]( Tile& tile )
         {
-            Vector n= normal(mesh, hit);
-            Point p= ray.o + hit.t * ray.d + 0.0001 * n; 
-            int N = 256; 
+            // nombres aleatoires : 1 sequence independante par pixel et par echantillon
+            Sampler sampler(seed);
             
-            Color color; 
-            if(argc > 2)
+            for(int y= tile.y0; y < tile.y1; y++)
+            for(int x= tile.x0; x < tile.x1; x++)
             {
-                std::string argument1 = argv[2]; // récupération de l'argument
-                if(argument1 == "1") {
-                    color = computeColor (n, p, triangles, mesh, NbRayons, rng);
-                } else{
-                    color = computeColorMonteCarlo(n, p, triangles, mesh, NbRayons, sourceLumineuse, rng, cdf); 
+                // generer le rayon au centre du pixel
+                Point origine= inv(Point(x + float(0.5), y + float(0.5), 0));
+                Point extremite= inv(Point(x + float(0.5), y + float(0.5), 1));
+                Ray ray(origine, extremite);
+                
+                // calculer l'intersection *valide* la plus proche de l'origine du rayon
+                Hit hit= bvh.intersect(ray);
+                
+                if(hit)
+                {
+                    Vector n= normal(mesh, hit);
+                    Point p= ray.o + hit.t * ray.d + 0.0001 * n; 
+                    
+                    unsigned pixel= y * image.width() + x;
+                    const Material& material= mesh.triangle_material(hit.triangle_id);
+                    Color color; 
+                    if(methode == CHEMINS)
+                    {
+                        // les chemins evaluent deja la brdf
+                        color = computeColorPath(n, p, normalize(-ray.d), material, bvh, mesh, NbRayons, triangles, sources, sampler, pixel);
+                        color = color/float(NbRayons) + material.emission;
+                        color.a = 1.0;
+                        image(x, y)= color;
+                        continue;
+                    }
+                    
+                    if(simple)
+                        color = computeColor (n, p, bvh, mesh, NbRayons, sampler, pixel);
+                    else
+                        color = computeColorMonteCarlo(n, p, bvh, mesh, NbRayons, triangles, sources, sampler, pixel); 
+                    
+                    Color diffuse = material.diffuse; 
+                    color = diffuse * color/float(NbRayons) + material.emission; 
+                    color.a = 1.0; 
+                    image(x, y)= color;
                 }
-            } else {
-                color = computeColorMonteCarlo(n, p, triangles, mesh, NbRayons, sourceLumineuse, rng, cdf); 
             }
-            
-            const Material& material= mesh.triangle_material(hit.triangle_id);
-            Color diffuse = material.diffuse; 
-            color = diffuse * color/float(NbRayons) + material.emission; 
-            color.a = 1.0; 
-            // image(x, y)= Color(color.r / float(N), color.g / float(N), color.b / float(N), 1.0); 
-            image(x, y)= color;
-        }
-    }
-
-auto stop= std::chrono::high_resolution_clock::now();
-    int cpu= std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+        },
+        print_progress);
+    
     printf("%dms\n", cpu);
     
 
-    if(argc > 2)
-    {
-        std::string argument1 = argv[2]; // récupération de l'argument
-        if(argument1 == "1") {
-            std::cerr<<"Monte Carlo simple choisi "<<std::endl;   
-
-            write_image(image, "rendu_monteCarlo_simple.png");
-            write_image_hdr(image, "rendu_monteCarlo_simple.hdr");   
-        } else{
-            std::cerr<<"Monte Carlo orienté vers les sources de lumières choisi "<<std::endl;  
-            write_image(image, "rendu_monteCarlo_efficace.png");
-            write_image_hdr(image, "rendu_monteCarlo_efficace.hdr");
-        }
-    } else {
-        std::cerr<<"Monte Carlo orienté vers les sources de lumières choisi "<<std::endl;
-        write_image(image, "rendu_monteCarlo_efficace.png");
-        write_image_hdr(image, "rendu_monteCarlo_efficace.hdr");
-    }
+    write_image(image, (std::string(filename) + ".png").c_str());
+    write_image_hdr(image, (std::string(filename) + ".hdr").c_str());
     
     return 0;
 }
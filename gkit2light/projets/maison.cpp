@@ -3,6 +3,14 @@
 
 
 #include "wavefront.h"
+#include "mesh_cache.h"
+#include "mesh_optimize.h"
+#include "mesh_packed.h"
+#include "meshlet.h"
+#include "mesh_simplify.h"
+#include "light_clusters.h"
+#include "frustum.h"
+#include "indirect_cull.h"
 #include "texture.h"
 
 #include "draw.h"        
@@ -14,9 +22,28 @@
 #include "mat.h"
 #include "image.h"
 #include <cstdio>
+#include <cstdlib>
 #include <vector>
 #include <ctime>
 
+// parametres de glMultiDrawElementsIndirect, cf tutos/M2/tuto_mdi_elements.cpp
+struct IndirectParam
+{
+    unsigned index_count;
+    unsigned instance_count;
+    unsigned first_index;
+    unsigned vertex_base;
+    unsigned instance_base;
+};
+
+// draws des meshlets visibles d'une cellule
+struct CellDraws
+{
+    int cell;
+    int first;
+    int n;
+};
+
 class Camera{
 public: 
     Camera() {
@@ -144,17 +171,133 @@ class HeightField{
     std::vector<float> m_data; 
 }; 
 
+// sinus approche, sans appel de fonction : les boucles d'animation sont vectorisees. erreur < 1e-6.
+// reduit l'angle dans [-pi pi], 2pi = a + b, reduction en 2 etapes, precise pour des angles de quelques milliers de tours
+inline float reduce_angle( const float x )
+{
+    // floor( )
+    float q = x * 0.159154943f + 0.5f;
+    float k = float(int(q));
+    k = (k > q) ? k - 1 : k;
+    return (x - k * 6.28125f) - k * 1.93530717e-3f;
+}
+
+// polynome de taylor, x dans [-pi/2 pi/2]
+inline float sin_poly( const float x )
+{
+    float x2 = x * x;
+    float p = -2.5052108e-8f;
+    p = p * x2 + 2.7557319e-6f;
+    p = p * x2 - 1.9841270e-4f;
+    p = p * x2 + 8.3333333e-3f;
+    p = p * x2 - 1.6666667e-1f;
+    return x + x * x2 * p;
+}
+
+inline float fast_sin( const float a )
+{
+    // sin(x) = sin(pi - x)
+    float x = reduce_angle(a);
+    float s = std::copysign(3.14159265f, x);
+    return sin_poly(std::fabs(x) > 1.57079633f ? s - x : x);
+}
+
+inline float fast_cos( const float a )
+{
+    // cos(x) = sin(pi/2 - |x|)
+    return sin_poly(1.57079633f - std::fabs(reduce_angle(a)));
+}
+
+// animation des lumieres : mouvement sinusoidal independant sur chaque axe, autour du centre de la scene.
+// organisation SoA, un tableau par parametre, pour vectoriser le calcul des positions, et repartir les lumieres par blocs entre les threads.
+class AnimatedLights{
+public:
+    AnimatedLights(){}
+
+    void create(const int n){
+        m_phase_x.resize(n);
+        m_phase_y.resize(n);
+        m_phase_z.resize(n);
+        for(int i = 0; i < n; i++){
+            m_phase_x[i] = float(i);
+            m_phase_y[i] = float(i) * 1.3f;
+            m_phase_z[i] = float(i) * 2.1f;
+        }
+
+        m_x.resize(n);
+        m_y.resize(n);
+        m_z.resize(n);
+    }
+
+    int size() const { return int(m_phase_x.size()); }
+
+    // positions a l'instant t, copiees dans lights et dans gpu, la region du storage buffer, si gpu n'est pas nul
+    void update(const float t, const vec3& center, const vec3& amplitude, std::vector<PointLight>& lights, PointLight *gpu){
+        const int n = size();
+        const int block = 1024;
+
+        // un bloc par thread, uniquement s'il y a beaucoup de lumieres
+        #pragma omp parallel for schedule(static) if(n > 4 * block)
+        for(int first = 0; first < n; first += block){
+            int last = std::min(n, first + block);
+            animate(first, last, t, center, amplitude);
+
+            for(int i = first; i < last; i++){
+                lights[i].position = vec3(m_x[i], m_y[i], m_z[i]);
+                if(gpu)
+                    gpu[i] = lights[i];
+            }
+        }
+    }
+
+protected:
+    void animate(const int first, const int last, const float t, const vec3 center, const vec3 amplitude){
+        // pointeurs locaux, sinon gcc ne vectorise pas la boucle
+        const float *__restrict phase_x = m_phase_x.data();
+        const float *__restrict phase_y = m_phase_y.data();
+        const float *__restrict phase_z = m_phase_z.data();
+        float *__restrict x = m_x.data();
+        float *__restrict y = m_y.data();
+        float *__restrict z = m_z.data();
+
+        #pragma omp simd
+        for(int i = first; i < last; i++){
+            x[i] = center.x + amplitude.x * fast_sin(t + phase_x[i]);
+            y[i] = center.y + amplitude.y * fast_cos(t + phase_y[i]);
+            z[i] = center.z + amplitude.z * fast_sin(t + phase_z[i]);
+        }
+    }
+
+    std::vector<float> m_phase_x;
+    std::vector<float> m_phase_y;
+    std::vector<float> m_phase_z;
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+};
+
 class TP : public AppTime
 {
 public:
     // constructeur : donner les dimensions de l'image, et eventuellement la version d'openGL.
-    TP( ) : AppTime(1024, 640) {}
+    TP( const int lights= 500 ) : AppTime(1024, 640, 4, 3), m_lightCount(lights) {}     // openGL 4.3 pour multidraw indirect
     
     // creation des objets de l'application
     int init( )
     {
         ////////////////// Chargement des objets 3d ////////////////////////
-        m_scene= read_mesh("data/rungholt/rungholt.obj");
+        gridCoords = Vector(6,6,6); 
+        // decoupe la scene en cellules, l'indexe et re-ordonne les triangles de chaque cellule pour le cache de sommets, les cellules sont dessinees avec glDrawElements.
+        // le mesh optimise et les cellules sont conserves dans un cache, cf read_mesh_cache( ) : le nom de la variante change avec la grille
+        m_scene= read_mesh_cache("data/rungholt/rungholt.obj", "grid666-optimized", triangleGrid,
+            [this]( Mesh& mesh, std::vector<TriangleGroup>& cells ) {
+                // trie les triangles par matiere, puis par cellule
+                mesh.groups();
+                Point pmin, pmax;
+                mesh.bounds(pmin, pmax);
+                cells = createGrid(mesh, pmin, pmax);
+                return optimize_mesh(mesh, cells);
+            });
        
         if(m_scene.materials().count() == 0)
             return -1;     // pas de matieres, pas d'affichage
@@ -162,14 +305,35 @@ public:
         
         ////////////Création des buffers + configuration des vao //////////
     
-        // trie les triangles par matiere et recupere les groupes de triangles utilisant la meme matiere.
-        m_groupsScene= m_scene.groups();
         Point pmin, pmax;
         m_scene.bounds(pmin, pmax);
-        gridCoords = Vector(6,6,6); 
-        triangleGrid = createGrid(m_scene, pmin, pmax); 
-
-        vaoScene= m_scene.create_buffers( /* texcoods */ true, /* normals */ true, /* color */ false, /* material index */ true );
+        // niveaux de details de chaque cellule, ajoutes dans l'index buffer, les cellules contiennent tous leurs niveaux
+        m_lods = build_lods(m_scene, triangleGrid);
+        // decoupe le niveau 0 de chaque cellule en meshlets, testes individuellement avant de les dessiner
+        std::vector<TriangleGroup> cells = triangleGrid;
+        for (size_t i = 0; i < cells.size(); i++)
+            cells[i].n = m_lods[i].levels[0].n;
+        m_meshlets = build_meshlets(m_scene, cells);
+        m_cellMeshlets.assign(triangleGrid.size() + 1, 0);
+        for (const Meshlet& meshlet : m_meshlets)
+            m_cellMeshlets[meshlet.group + 1]++;
+        for (size_t i = 0; i < triangleGrid.size(); i++)
+            m_cellMeshlets[i + 1] += m_cellMeshlets[i];
+
+        // boites englobantes des cellules, pour eliminer les cellules hors du frustum, sans allocation a chaque image
+        m_cellBVH.build(m_scene, cells);
+        m_visibleCells.reserve(triangleGrid.size());
+
+        glGenBuffers(1, &m_indirectBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, m_meshlets.size() * sizeof(IndirectParam), nullptr, GL_STREAM_DRAW);
+
+        // meme selection des cellules, des niveaux et des meshlets, par un compute shader, et un seul multidraw pour toute la scene
+        if (m_gpuCuller.create(m_scene, cells, m_lods, m_meshlets) < 0)
+            use_gpu_culling = false;
+
+        // sommets compresses, 16 octets par sommet, quantifies dans chaque cellule
+        vaoScene= m_packed.create(m_scene, triangleGrid);
         
         heightMap = HeightField(pmin, pmax); 
 
@@ -308,13 +472,22 @@ public:
         program= read_program("src/shader/textureMaison.glsl");
         program_print_errors(program);
 
-        programHeightMap= read_program("src/shader/textureHeightMap.glsl");
+        programHeightMap= read_program("src/shader/textureHeightMap.glsl", m_packed.definitions().c_str());
         program_print_errors(programHeightMap);
 
-        programGBuffer= read_program("src/shader/gbuffer.glsl");
+        programGBuffer= read_program("src/shader/gbuffer.glsl", m_packed.definitions().c_str());
         program_print_errors(programGBuffer);
+
+        // meme shader, parametres de decodage des cellules en attributs d'instance, pour les draws ecrits par programCull
+        programGBufferIndirect= read_program("src/shader/gbuffer.glsl", m_packed.definitions(true).c_str());
+        program_print_errors(programGBufferIndirect);
+        programCull= read_program("src/shader/indirect_cull.glsl");
+        program_print_errors(programCull);
         
-        program_deffered= read_program("src/shader/program_deffered.glsl");
+        // listes de lumieres par froxel, pour la passe d'eclairage
+        if(m_clusters.create(window_width(), window_height()) < 0)
+            return -1;
+        program_deffered= read_program("src/shader/program_deffered.glsl", m_clusters.definitions().c_str());
         program_print_errors(program_deffered);
         
         /////////////////// etat openGL par defaut ////////////////////////
@@ -341,7 +514,9 @@ public:
         m_orbiter.projection(window_width(), window_height(), 45);
         m_orbiter.lookat(pmin, pmax);
 
-        initLights(500, pmin, pmax ); 
+        initLights(m_lightCount, pmin, pmax ); 
+        if(m_lightBuffer.create(lights.size()) < 0)
+            return -1;
 
         
         std::vector<vec3> pos = m_scene.positions(); 
@@ -354,9 +529,16 @@ public:
     int quit( )
     {
         m_scene.release();
+        m_packed.release();
+        m_clusters.release();
+        m_lightBuffer.release();
+        m_gpuCuller.release();
+        glDeleteBuffers(1, &m_indirectBuffer);
         glDeleteProgram(program);
         glDeleteProgram(programHeightMap);
         glDeleteProgram(programGBuffer);
+        glDeleteProgram(programGBufferIndirect);
+        glDeleteProgram(programCull);
         glDeleteProgram(program_deffered);
         glDeleteTextures(1, &textureHeightMap);
         glDeleteTextures(1, &zbufferHeighMap);
@@ -510,8 +692,12 @@ public:
         
         program_uniform(programHeightMap, "mvpMatrix", mvp);
 
-        // dessiner les triangles du groupe
-        glDrawArrays(GL_TRIANGLES, 0, m_scene.vertex_count());
+        // dessiner les triangles de chaque cellule, niveau de detail 0, avec ses parametres de decodage
+        for(int i= 0; i < int(m_packed.groups().size()); i++)
+        {
+            m_packed.uniforms(programHeightMap, i);
+            m_packed.draw(m_lods[i].levels[0].first, m_lods[i].levels[0].n);
+        }
 
         glBindTexture(GL_TEXTURE_2D, textureHeightMap);
         glGetTexImage(GL_TEXTURE_2D, 0,  GL_RED, GL_FLOAT, heightMap.data());
@@ -524,6 +710,18 @@ public:
     int render( )
     {
         use_camera(); 
+        if(key_state('m')){
+            clear_key_state('m');
+            use_meshlets = !use_meshlets;
+        }
+        if(key_state('l')){
+            clear_key_state('l');
+            use_lods = !use_lods;
+        }
+        if(key_state('g')){
+            clear_key_state('g');
+            use_gpu_culling = !use_gpu_culling && m_gpuCuller.candidate_count() > 0;
+        }
 
         updateLights(heightMap.pmin(), heightMap.pmax());
 
@@ -558,15 +756,23 @@ public:
         // couleur et profondeur par defaut
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
+        MeshletCuller culler(view, projection);
+        // taille en pixels d'une longueur de 1, a une distance de 1 de la camera, pour projeter l'erreur des niveaux de details
+        float pixels_per_unit = window_height() * projection.m[1][1] / 2;
+        // selection sur le gpu : ecrit les draws visibles, dessines par un seul multidraw indirect count
+        if (use_gpu_culling)
+            m_gpuCuller.cull(programCull, culler, pixels_per_unit, use_lods, use_meshlets);
+
+        GLuint programScene = use_gpu_culling ? programGBufferIndirect : programGBuffer;
         glBindVertexArray( vaoScene );
-        glUseProgram( programGBuffer );
+        glUseProgram( programScene );
 
-        program_uniform(programGBuffer, "mvpMatrix", mvp);
-        program_uniform(programGBuffer, "modelMatrix", model);
-        glUniform1f(glGetUniformLocation(programGBuffer, "znear"), znear);
-        glUniform1f(glGetUniformLocation(programGBuffer, "zfar"), zfar);
+        program_uniform(programScene, "mvpMatrix", mvp);
+        program_uniform(programScene, "modelMatrix", model);
+        glUniform1f(glGetUniformLocation(programScene, "znear"), znear);
+        glUniform1f(glGetUniformLocation(programScene, "zfar"), zfar);
 
-        GLint location= glGetUniformLocation(programGBuffer, "diffuse_color");
+        GLint location= glGetUniformLocation(programScene, "diffuse_color");
         glUniform1i(location, 0);   // une seule texture utilisee, 0 dans ce cas
 
         // selectionner la texture :
@@ -576,49 +782,60 @@ public:
         // glDrawArrays(GL_TRIANGLES, 0, m_scene.vertex_count());
 
 
-        vec3 diff = heightMap.pmax() - heightMap.pmin();
-        Point cellSize(
-            diff.x / float(gridCoords(0)),
-            diff.y / float(gridCoords(1)),
-            diff.z / float(gridCoords(2))
-        );
         int nbSommetDessiné = 0; 
         
-        for (const TriangleGroup& group : triangleGrid) {
-
-            // 1. Calculer la bounding box de la cellule correspondante
-            // Ici group.index = numéro de cellule
-            int Nx = (int)gridCoords(0);
-            int Ny = (int)gridCoords(1);
-            int Nz = (int)gridCoords(2);
-
-            int ix = group.index % Nx;
-            int iy = (group.index / Nx) % Ny;
-            int iz = group.index / (Nx * Ny);
-
-            Point pminCell;
-            pminCell.x = heightMap.pmin().x + ix * cellSize.x;
-            pminCell.y = heightMap.pmin().y + iy * cellSize.y;
-            pminCell.z = heightMap.pmin().z + iz * cellSize.z;
-            
-            Point pmaxCell = pminCell + cellSize;
-
-            if(!isVisibleObj(pminCell, pmaxCell) ){
-                    // 2. Tester si la cellule est dans le frustum
-                //std::cerr << "cellule : " << group.index<<" hors frustum" << std::endl;
-                continue; // ignorer ce groupe / cellule
-            }else if (!isVisibleFrustum(pminCell, pmaxCell) ){
-                //std::cerr << "cellule : " << group.index<<" hors frustum" << std::endl;
-                continue; // ignorer ce groupe / cellule
+        m_draws.clear();
+        m_cellDraws.clear();
+
+        // 1. et 2. Cellules qui touchent le frustum, parcours du bvh des boites englobantes des cellules
+        if (use_gpu_culling) {
+            // deja fait par programCull, il ne reste qu'a dessiner
+            m_gpuCuller.draw();
+            m_visibleCells.clear();
+        }
+        else
+            m_cellBVH.cull(culler, m_visibleCells);
+
+        for (int i : m_visibleCells) {
+            // 3. Choisir le niveau de detail de la cellule, erreur projetee inferieure a 1 pixel
+            int level = use_lods ? select_lod(m_lods[i], culler.camera, pixels_per_unit) : 0;
+            const LodLevel& lod = m_lods[i].levels[level];
+
+            // dessiner les triangles de ce niveau
+            // lod.first = premier indice dans l'index buffer
+            // lod.n     = nombre d'indices à dessiner
+            if (!use_meshlets || level > 0) {
+                m_packed.uniforms(programGBuffer, i);
+                m_packed.draw(lod.first, lod.n);
+                nbSommetDessiné+=lod.n; 
+                continue;
             }
 
-            
+            // 4. Eliminer les meshlets de la cellule hors du frustum
+            int first = int(m_draws.size());
+            for (int m = m_cellMeshlets[i]; m < m_cellMeshlets[i + 1]; m++) {
+                const Meshlet& meshlet = m_meshlets[m];
+                // pas de test du cone des normales : les faces arrieres sont dessinees, et le feuillage (alpha test) est visible des 2 cotes
+                if (!culler.visible(meshlet, false))
+                    continue;
 
-            // 3. Dessiner les triangles de ce groupe
-            // group.first = premier sommet dans le VBO
-            // group.n     = nombre de sommets à dessiner
-            glDrawArrays(GL_TRIANGLES, group.first, group.n);
-            nbSommetDessiné+=group.n; 
+                m_draws.push_back({ unsigned(meshlet.n), 1, unsigned(meshlet.first), 0, 0 });
+                nbSommetDessiné+=meshlet.n;
+            }
+            if (int(m_draws.size()) > first)
+                m_cellDraws.push_back({ i, first, int(m_draws.size()) - first });
+        }
+
+        if (use_meshlets && !m_draws.empty()) {
+            // 5. Un multidraw indirect par cellule, avec ses parametres de decodage des sommets
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, m_meshlets.size() * sizeof(IndirectParam), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_draws.size() * sizeof(IndirectParam), m_draws.data());
+
+            for (const CellDraws& cell : m_cellDraws) {
+                m_packed.uniforms(programGBuffer, cell.cell);
+                glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void *) (cell.first * sizeof(IndirectParam)), cell.n, 0);
+            }
         }
 
 
@@ -656,10 +873,13 @@ public:
         glBindTexture(GL_TEXTURE_2D, zBuffer);
         glUniform1i(glGetUniformLocation(program_deffered, "gDepth"), 2);
 
-        glUniform3fv( glGetUniformLocation(program_deffered, "lights"), lights.size(), &lights[0].x );
-        glUniform1ui(glGetUniformLocation(program_deffered, "nbLights"), lights.size());
+        m_clusters.update(lights, view, projection, znear, zfar);
+        m_lightBuffer.bind(0);
+        m_clusters.uniforms(program_deffered);
 
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        // la region des lumieres pourra etre reutilisee apres ce draw
+        m_lightBuffer.fence();
         glBindVertexArray(0);
         
         return 1;
@@ -667,7 +887,7 @@ public:
 
 protected:
     Mesh m_scene;
-    std::vector<TriangleGroup> m_groupsScene;    
+    PackedMesh m_packed;
     GLuint program= 0;
     GLuint vaoScene= 0;
     GLuint texture = 0; 
@@ -683,25 +903,43 @@ protected:
     Image heightMapImage; 
     GLuint quadVAO; 
     GLuint program_deffered= 0;
+    GLuint programGBufferIndirect= 0;
+    GLuint programCull= 0;
 
     Vector gridCoords; 
     std::vector< TriangleGroup > triangleGrid; 
+    BoxBVH m_cellBVH;                           // bvh des boites englobantes des cellules
+    std::vector<int> m_visibleCells;            // cellules qui touchent le frustum
+    std::vector<MeshLod> m_lods;                // niveaux de details de chaque cellule
+    std::vector<Meshlet> m_meshlets;            // meshlets du niveau 0, cellule par cellule
+    std::vector<int> m_cellMeshlets;            // premier meshlet de chaque cellule
+    std::vector<IndirectParam> m_draws;         // draws des meshlets visibles
+    std::vector<CellDraws> m_cellDraws;
+    GLuint m_indirectBuffer = 0;
+    bool use_meshlets = true;
+    bool use_lods = true;
+    IndirectCuller m_gpuCuller;                 // selection des cellules et des meshlets par un compute shader
+    bool use_gpu_culling = true;
 
     HeightField heightMap;
     Camera m_camera;
     Camera m_cameraHeightMap;
     Orbiter m_orbiter; 
-    std::vector<vec3> lights; 
+    std::vector<PointLight> lights; 
+    AnimatedLights m_animation;                 // positions des lumieres, SoA
+    LightBuffer m_lightBuffer;                  // lumieres, pour les shaders, triple buffering
+    LightClusters m_clusters;
 
-    bool use_Camera = true; 
+    bool use_Camera = true;
+    int m_lightCount;                           // nombre de lumieres, cf main( ) 
 
 private: 
     void reload_shader(){
         if(key_state('r'))
         {
             clear_key_state('r');
-            reload_program(program, "src/shader/program_deffered.glsl");
-            program_print_errors(program);
+            reload_program(program_deffered, "src/shader/program_deffered.glsl", m_clusters.definitions().c_str());
+            program_print_errors(program_deffered);
         }
     }
     void use_camera(){
@@ -717,33 +955,35 @@ private:
 
     void initLights(const int& nbLights, const Point& pmin, const Point& pmax){
         std::srand(std::time(nullptr)); 
+        // rayon d'influence fini : chaque lumiere n'eclaire qu'une petite partie de la scene
+        float radius = length(pmax - pmin) / 40;
         for (size_t i =0; i<nbLights; ++i){
             
-            vec3 light; 
-            light.x = pmin.x + std::rand() % int(pmax.x -pmin.x +1); 
-            light.y = pmin.y + std::rand() % int(pmax.y -pmin.y +1); 
-            light.z = pmin.z + std::rand() % int(pmax.z -pmin.z +1);
+            PointLight light; 
+            light.radius = radius; 
+            light.position.x = pmin.x + std::rand() % int(pmax.x -pmin.x +1); 
+            light.position.y = pmin.y + std::rand() % int(pmax.y -pmin.y +1); 
+            light.position.z = pmin.z + std::rand() % int(pmax.z -pmin.z +1);
 
             lights.push_back(light); 
         }
+        m_animation.create(nbLights);
     }
 
     void updateLights(Point pmin, Point pmax){
         float t = global_time() * 0.0001; // temps en secondes
 
-        for (size_t i = 0; i < lights.size(); ++i) {
-            // amplitude = demi-taille de la boîte englobante
-            vec3 amplitude = (pmax - pmin) * 0.5f;
-        
-            // centre = centre de la boîte
-            vec3 center = (pmax + pmin) * 0.5f;
-        
-            // mouvement sinusoïdal indépendant pour chaque lumière
-            lights[i].x = center.x + amplitude.x * std::sin(t + i); 
-            lights[i].y = center.y + amplitude.y * std::cos(t + i*1.3f); 
-            lights[i].z = center.z + amplitude.z * std::sin(t + i*2.1f);
-            
-        }
+        // ecrit directement dans la region du storage buffer utilisee par cette image
+        PointLight *gpu = m_lightBuffer.map(lights.size());
+        if(gpu == nullptr)
+            return;
+
+        // amplitude = demi-taille de la boîte englobante, centre = centre de la boîte
+        vec3 amplitude = (pmax - pmin) * 0.5f;
+        vec3 center = (pmax + pmin) * 0.5f;
+        // mouvement sinusoïdal indépendant pour chaque lumière, la repartition dans les froxels relit lights
+        m_animation.update(t, center, amplitude, lights, gpu);
+        m_lightBuffer.unmap();
     } 
 
     void fbo_print_errors(GLuint fbo){
@@ -811,115 +1051,6 @@ private:
         printf("image réussi\n");
     }
 
-    bool PointInFrustum(vec3 p){
-        vec4 pNdc = worldToNdc(p);
-
-        if (-1 <= pNdc.x && pNdc.x <= 1 &&
-            -1 <= pNdc.y && pNdc.y <= 1 &&
-            -1 <= pNdc.z && pNdc.z <= 1)
-        {
-            return true;
-        }
-        return false;
-    }
-
-    bool allPointsOutsidePlane(const float& A,const float& B, const float& C, const float& D, std::vector<Point> pts){
-        // bool hasPos = false; 
-        // bool hasNeg = false;
-        for (size_t i = 0; i<pts.size(); ++i){
-            Point p = pts[i]; 
-            float s= A*p(0) + B*p(1) + C*p(2) + D; //TODO 0.5 a supp
-            if (s>=0) // A l'interieur ou à la surface du plan
-                return false;//hasPos = true;
-            // else   
-            //     hasNeg = true; 
-            
-            // if( hasPos && hasNeg)
-            //     return false; 
-        }
-        return true;
-    }
-
-    bool isVisibleFrustum (const Point& pmin, const Point& pmax){
-        std::vector<Point> corners;
-        int i = 0;
-        for (int a=0; a<=1; ++a){
-            for (int b=0; b<=1; ++b){
-                for (int c=0; c<=1; ++c){
-                    Point cornerWorld = getCorner(pmin, pmax, a, b, c); 
-                    Point cornerNdc = worldToNdc(cornerWorld); 
-                    corners.push_back(cornerNdc);
-                }
-            }
-        }
-        float p = 1.0; 
-        
-        if (allPointsOutsidePlane(1, 0, 0, p, corners))
-            return false;
-        if (allPointsOutsidePlane(-1, 0, 0, p, corners))
-            return false;
-        if (allPointsOutsidePlane(0, 1, 0, p, corners))
-            return false;
-        if (allPointsOutsidePlane(0, -1, 0, p, corners))
-            return false;
-        if (allPointsOutsidePlane(0, 0, 1, p, corners))
-            return false;
-        if (allPointsOutsidePlane(0, 0, -1, p, corners))
-            return false;
-
-        return true; 
-    }
-
-    bool isVisibleObj (const Point& pmin, const Point& pmax){
-        std::vector<Point> ptsFrustumWorld = getPointFrustumWorld();
-        
-        if (allPointsOutsidePlane(1, 0, 0, -pmin(0), ptsFrustumWorld))
-            return false;
-        if (allPointsOutsidePlane(-1, 0, 0, pmax(0), ptsFrustumWorld))
-            return false;
-        if (allPointsOutsidePlane(0, 1, 0, -pmin(1), ptsFrustumWorld))
-            return false;
-        if (allPointsOutsidePlane(0, -1, 0, pmax(1), ptsFrustumWorld))
-            return false;
-        if (allPointsOutsidePlane(0, 0, 1, -pmin(2), ptsFrustumWorld))
-            return false;
-        if (allPointsOutsidePlane(0, 0, -1, pmax(2), ptsFrustumWorld))
-            return false;
-
-        return true; 
-    }
-
-    Point getCorner(const Point& pmin, const Point& pmax, int a, int b, int c)
-    {
-        return pmin + Vector(a, b, c) * (pmax - pmin);
-    }
-
-
-
-    Point worldToNdc(const Point p){
-        Transform view, projection;
-        if(!use_Camera){ 
-            view= m_camera.view();
-            projection= m_camera.projection();
-        }
-        else{
-            view= m_orbiter.view();
-            projection= m_orbiter.projection();
-        }
-
-        // 1. Combinaison des deux
-        Transform VP = projection * view;
-
-        // 2. Point en coordonnées monde
-        vec4 worldPos = vec4(p);
-
-        // 3. Application de la matrice VP
-        vec4 clipPos = VP(worldPos);
-
-        // 4. Division perspective
-        return Point(clipPos(0)/ clipPos(3), clipPos(1)/ clipPos(3), clipPos(2)/ clipPos(3)) ;
-    }
-
     std::vector< TriangleGroup > createGrid(Mesh& scene, const Point& pmin, const Point& pmax){
         std::vector<unsigned int> indexGrid;
         for(int i = 0; i<scene.triangle_count(); i++){
@@ -949,42 +1080,18 @@ private:
 
         return scene.groups(indexGrid);
     }
-
-    std::vector< Point > getPointFrustumWorld(){
-        std::vector<Point> ptsFrustum; 
-
-        Transform view, projection;
-        if(!use_Camera){ 
-            view= m_camera.view();
-            projection= m_camera.projection();
-        }
-        else{
-            view= m_orbiter.view();
-            projection= m_orbiter.projection();
-        }
-
-        // 1. Combinaison des deux
-        Transform VP = projection * view;
-        Transform invVP = Inverse(VP); 
-
-        float p = 1.0;
-        ptsFrustum.push_back(invVP(Point(-p, -p, -p))); 
-        ptsFrustum.push_back(invVP(Point(-p, -p, p))); 
-        ptsFrustum.push_back(invVP(Point(-p, p, -p))); 
-        ptsFrustum.push_back(invVP(Point(p, -p, -p))); 
-        ptsFrustum.push_back(invVP(Point(-p, p, p))); 
-        ptsFrustum.push_back(invVP(Point(p, -p, p))); 
-        ptsFrustum.push_back(invVP(Point(p, p, p))); 
-        ptsFrustum.push_back(invVP(Point(p, p, -p))); 
-        return ptsFrustum;         
-    }
 };
 
 
 int main( int argc, char **argv )
 {
+    // nombre de lumieres, optionnel : maison [lumieres], 500 par defaut
+    int lights= 500;
+    if(argc > 1)
+        lights= std::max(1, std::atoi(argv[1]));
+
     // il ne reste plus qu'a creer un objet application et la lancer 
-    TP tp;
+    TP tp(lights);
     tp.run();
     
     return 0;
@@ -0,0 +1,546 @@
+
+//! \file bvh.h arbre de boites englobantes / bvh, construction sah et parcours, intersection la plus proche ou n'importe quelle intersection (ombres).
+
+#ifndef _BVH_H
+#define _BVH_H
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cassert>
+
+#include "vec.h"
+#include "mesh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! rayon, intervalle [0 tmax].
+struct Ray
+{
+    Point o;                // origine
+    Vector d;               // direction
+    float tmax;             // position de l'extremite, si elle existe. le rayon est un intervalle [0 tmax]
+
+    Ray( ) : o(), d(), tmax(FLT_MAX) {}
+    //! le rayon est un segment, on connait origine et extremite, et tmax= 1
+    Ray( const Point& origine, const Point& extremite ) : o(origine), d(Vector(origine, extremite)), tmax(1) {}
+    //! le rayon est une demi droite, on connait origine et direction, et tmax= \inf
+    Ray( const Point& origine, const Vector& direction ) : o(origine), d(direction), tmax(FLT_MAX) {}
+    //! le rayon est un intervalle [0 tmax] le long de la direction.
+    Ray( const Point& origine, const Vector& direction, const float _tmax ) : o(origine), d(direction), tmax(_tmax) {}
+
+    //! renvoie le point sur le rayon pour t
+    Point point( const float t ) const { return o + t * d; }
+};
+
+//! intersection rayon / triangle.
+struct Hit
+{
+    float t;            // p(t)= o + td, position du point d'intersection sur le rayon
+    float u, v;         // p(u, v), position du point d'intersection sur le triangle
+    int triangle_id;    // indice du triangle dans le mesh
+
+    Hit( ) : t(FLT_MAX), u(), v(), triangle_id(-1) {}
+    Hit( const float _t, const float _u, const float _v, const int _id ) : t(_t), u(_u), v(_v), triangle_id(_id) {}
+
+    //! renvoie vrai si intersection
+    operator bool ( ) const { return (triangle_id != -1); }
+};
+
+//! intersection avec une boite / un englobant.
+struct BBoxHit
+{
+    float tmin, tmax;
+
+    BBoxHit() : tmin(FLT_MAX), tmax(-FLT_MAX) {}
+    BBoxHit( const float _tmin, const float _tmax ) : tmin(_tmin), tmax(_tmax) {}
+
+    operator bool( ) const { return tmin <= tmax; }
+};
+
+//! boite englobante alignee sur les axes.
+struct BBox
+{
+    Point pmin, pmax;
+
+    //! boite vide, inserer des points ou des boites pour la construire.
+    BBox( ) : pmin(FLT_MAX, FLT_MAX, FLT_MAX), pmax(-FLT_MAX, -FLT_MAX, -FLT_MAX) {}
+
+    BBox( const Point& p ) : pmin(p), pmax(p) {}
+    BBox( const Point& a, const Point& b ) : pmin(min(a, b)), pmax(max(a, b)) {}
+    BBox( const BBox& a, const BBox& b ) : pmin(min(a.pmin, b.pmin)), pmax(max(a.pmax, b.pmax)) {}
+
+    BBox& insert( const Point& p ) { pmin= min(pmin, p); pmax= max(pmax, p); return *this; }
+    BBox& insert( const BBox& box ) { pmin= min(pmin, box.pmin); pmax= max(pmax, box.pmax); return *this; }
+
+    float centroid( const int axis ) const { return (pmin(axis) + pmax(axis)) / 2; }
+    Point centroid( ) const { return (pmin + pmax) / 2; }
+
+    //! aire de la boite, cf construction sah.
+    float area( ) const
+    {
+        Vector d(pmin, pmax);
+        if(d.x < 0 || d.y < 0 || d.z < 0) return 0;     // boite vide
+        return 2 * (d.x * d.y + d.x * d.z + d.y * d.z);
+    }
+
+    //! intersection avec un rayon, entre 0 et htmax. invd= 1 / ray.d.
+    BBoxHit intersect( const Ray& ray, const Vector& invd, const float htmax ) const
+    {
+        Point rmin= pmin;
+        Point rmax= pmax;
+        if(ray.d.x < 0) std::swap(rmin.x, rmax.x);
+        if(ray.d.y < 0) std::swap(rmin.y, rmax.y);
+        if(ray.d.z < 0) std::swap(rmin.z, rmax.z);
+        Vector dmin= (rmin - ray.o) * invd;
+        Vector dmax= (rmax - ray.o) * invd;
+
+        float tmin= std::max(dmin.z, std::max(dmin.y, std::max(dmin.x, 0.f)));
+        float tmax= std::min(dmax.z, std::min(dmax.y, std::min(dmax.x, htmax)));
+        return BBoxHit(tmin, tmax);
+    }
+};
+
+
+//! noeud du bvh. feuille : [begin, end) indices des primitives, stockes en negatif. noeud interne : indices des fils.
+struct Node
+{
+    BBox bounds;
+    int left;
+    int right;
+
+    bool internal( ) const { return right > 0; }                        // renvoie vrai si le noeud est un noeud interne
+    int internal_left( ) const { assert(internal()); return left; }     // renvoie le fils gauche du noeud interne
+    int internal_right( ) const { assert(internal()); return right; }   // renvoie le fils droit
+
+    bool leaf( ) const { return right < 0; }                            // renvoie vrai si le noeud est une feuille
+    int leaf_begin( ) const { assert(leaf()); return -left; }           // renvoie le premier objet de la feuille
+    int leaf_end( ) const { assert(leaf()); return -right; }            // renvoie le dernier objet
+};
+
+//! creation d'un noeud interne.
+inline Node make_node( const BBox& bounds, const int left, const int right )
+{
+    Node node { bounds, left, right };
+    assert(node.internal());    // verifie que c'est bien un noeud...
+    return node;
+}
+
+//! creation d'une feuille.
+inline Node make_leaf( const BBox& bounds, const int begin, const int end )
+{
+    Node node { bounds, -begin, -end };
+    assert(node.leaf());        // verifie que c'est bien une feuille...
+    return node;
+}
+
+
+/*! bvh parametre par le type des primitives, cf Triangle.
+    les primitives doivent fournir :
+    \code
+    BBox bounds( ) const;
+    Hit intersect( const Ray& ray, const float htmax ) const;
+    bool occluded( const Ray& ray, const float htmax ) const;
+    \endcode
+
+    utilisation :
+    \code
+    std::vector<Triangle> triangles= { ... };
+    BVH bvh;
+    bvh.build(triangles);
+
+    if(Hit hit= bvh.intersect(ray))     // intersection la plus proche
+        { ... }
+    if(bvh.occluded(ray))               // n'importe quelle intersection, pour les rayons d'ombre
+        { ... }
+    \endcode
+*/
+template < typename T >
+struct BVHT
+{
+    BVHT( ) : nodes(), primitives(), root(-1) {}
+
+    //! construit un bvh pour l'ensemble de primitives. construction sah, cf "on fast construction of sah-based bounding volume hierarchies", I. Wald, 2007.
+    int build( const std::vector<T>& _primitives )
+    {
+        primitives.clear();
+        nodes.clear();          // efface les noeuds
+        root= -1;
+        if(_primitives.empty())
+            return root;
+
+        // pre-calcule les englobants et les centres des primitives
+        std::vector<Ref> refs;
+        refs.reserve(_primitives.size());
+        for(unsigned i= 0; i < _primitives.size(); i++)
+        {
+            BBox bounds= _primitives[i].bounds();
+            refs.push_back( { bounds, bounds.centroid(), int(i) } );
+        }
+
+        nodes.reserve(2 * _primitives.size());
+
+        // construit l'arbre...
+        root= build(refs, 0, int(refs.size()));
+
+        // re-organise les primitives dans l'ordre des feuilles
+        primitives.reserve(refs.size());
+        for(unsigned i= 0; i < refs.size(); i++)
+            primitives.push_back(_primitives[refs[i].id]);
+
+        return root;
+    }
+
+    //! intersection avec un rayon, entre 0 et htmax. renvoie l'intersection la plus proche.
+    Hit intersect( const Ray& ray, const float htmax ) const
+    {
+        Hit hit;
+        hit.t= htmax;
+        if(root < 0)
+            return hit;
+
+        Vector invd= Vector(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+
+        int stack[stack_size];
+        int top= 0;
+        stack[top++]= root;
+        while(top > 0)
+        {
+            const Node& node= nodes[stack[--top]];
+            if(!node.bounds.intersect(ray, invd, hit.t))
+                continue;
+
+            if(node.leaf())
+            {
+                for(int i= node.leaf_begin(); i < node.leaf_end(); i++)
+                    if(Hit h= primitives[i].intersect(ray, hit.t))
+                        hit= h;
+            }
+            else // if(node.internal())
+            {
+                // visite d'abord le fils le plus proche, le plus loin pourra etre elimine par l'intersection trouvee dans le plus proche...
+                int left= node.internal_left();
+                int right= node.internal_right();
+                BBoxHit hleft= nodes[left].bounds.intersect(ray, invd, hit.t);
+                BBoxHit hright= nodes[right].bounds.intersect(ray, invd, hit.t);
+
+                assert(top +2 <= stack_size);
+                if(hleft && hright)
+                {
+                    if(hleft.tmin < hright.tmin)
+                    {
+                        stack[top++]= right;
+                        stack[top++]= left;
+                    }
+                    else
+                    {
+                        stack[top++]= left;
+                        stack[top++]= right;
+                    }
+                }
+                else if(hleft)
+                    stack[top++]= left;
+                else if(hright)
+                    stack[top++]= right;
+            }
+        }
+
+        return hit;
+    }
+
+    //! intersection avec un rayon, entre 0 et ray.tmax.
+    Hit intersect( const Ray& ray ) const { return intersect(ray, ray.tmax); }
+
+    //! renvoie vrai s'il existe une intersection entre 0 et htmax. le parcours s'arrete sur la premiere intersection trouvee, cf rayons d'ombre.
+    bool occluded( const Ray& ray, const float htmax ) const
+    {
+        if(root < 0)
+            return false;
+
+        Vector invd= Vector(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
+
+        int stack[stack_size];
+        int top= 0;
+        stack[top++]= root;
+        while(top > 0)
+        {
+            const Node& node= nodes[stack[--top]];
+            if(!node.bounds.intersect(ray, invd, htmax))
+                continue;
+
+            if(node.leaf())
+            {
+                for(int i= node.leaf_begin(); i < node.leaf_end(); i++)
+                    if(primitives[i].occluded(ray, htmax))
+                        return true;
+            }
+            else
+            {
+                assert(top +2 <= stack_size);
+                stack[top++]= node.internal_right();
+                stack[top++]= node.internal_left();
+            }
+        }
+
+        return false;
+    }
+
+    //! renvoie vrai s'il existe une intersection entre 0 et ray.tmax.
+    bool occluded( const Ray& ray ) const { return occluded(ray, ray.tmax); }
+
+    //! renvoie le nombre de noeuds.
+    int node_count( ) const { return int(nodes.size()); }
+    //! renvoie l'englobant de l'arbre.
+    BBox bounds( ) const { return (root < 0) ? BBox() : nodes[root].bounds; }
+
+protected:
+    //! primitive pendant la construction : englobant, centre et indice.
+    struct Ref
+    {
+        BBox bounds;
+        Point centroid;
+        int id;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<T> primitives;
+    int root;
+
+    // cout relatif du parcours d'un noeud par rapport au test d'intersection d'une primitive.
+    static constexpr float traversal_cost= 1;
+    static constexpr int bin_count= 16;
+    static constexpr int leaf_size= 4;      // nombre max de primitives dans une feuille, si la repartition sah n'est pas interessante
+    static constexpr int stack_size= 128;   // profondeur max du parcours
+
+    int build( std::vector<Ref>& refs, const int begin, const int end )
+    {
+        BBox bounds;
+        BBox cbounds;
+        for(int i= begin; i < end; i++)
+        {
+            bounds.insert(refs[i].bounds);
+            cbounds.insert(refs[i].centroid);
+        }
+
+        int n= end - begin;
+        if(n < 2)
+            return leaf(bounds, begin, end);
+
+        // evalue le cout sah des repartitions sur les 3 axes, par intervalles / bins
+        float best_cost= FLT_MAX;
+        int best_axis= -1;
+        int best_bin= -1;
+        for(int axis= 0; axis < 3; axis++)
+        {
+            float extent= cbounds.pmax(axis) - cbounds.pmin(axis);
+            if(extent <= 0)
+                continue;   // toutes les primitives sont au meme endroit sur cet axe...
+
+            int counts[bin_count]= { };
+            BBox boxes[bin_count];
+            float scale= bin_count / extent;
+            for(int i= begin; i < end; i++)
+            {
+                int b= std::min(bin_count -1, int((refs[i].centroid(axis) - cbounds.pmin(axis)) * scale));
+                counts[b]++;
+                boxes[b].insert(refs[i].bounds);
+            }
+
+            // aires et nombres de primitives a droite de chaque coupe
+            float right_area[bin_count];
+            int right_count[bin_count];
+            {
+                BBox box;
+                int count= 0;
+                for(int b= bin_count -1; b > 0; b--)
+                {
+                    box.insert(boxes[b]);
+                    count+= counts[b];
+                    right_area[b]= box.area();
+                    right_count[b]= count;
+                }
+            }
+
+            // balaye les coupes de gauche a droite, coupe entre b-1 et b
+            BBox box;
+            int count= 0;
+            for(int b= 1; b < bin_count; b++)
+            {
+                box.insert(boxes[b -1]);
+                count+= counts[b -1];
+                if(count == 0 || right_count[b] == 0)
+                    continue;
+
+                float cost= count * box.area() + right_count[b] * right_area[b];
+                if(cost < best_cost)
+                {
+                    best_cost= cost;
+                    best_axis= axis;
+                    best_bin= b;
+                }
+            }
+        }
+
+        // compare avec le cout d'une feuille
+        float area= bounds.area();
+        if(area > 0)
+            best_cost= traversal_cost + best_cost / area;
+        if(best_axis < 0 || (n <= leaf_size && best_cost >= float(n)))
+        {
+            if(n <= leaf_size)
+                return leaf(bounds, begin, end);
+
+            // pas de repartition sah valide, toutes les primitives ont le meme centre...
+            // forcer quand meme un decoupage en 2 ensembles
+            int m= (begin + end) / 2;
+            return node(bounds, refs, begin, m, end);
+        }
+
+        // repartit les primitives
+        int axis= best_axis;
+        float pmin= cbounds.pmin(axis);
+        float scale= bin_count / (cbounds.pmax(axis) - cbounds.pmin(axis));
+        int cut= best_bin;
+        Ref *pm= std::partition(refs.data() + begin, refs.data() + end,
+            [axis, pmin, scale, cut]( const Ref& ref )
+            {
+                int b= std::min(bin_count -1, int((ref.centroid(axis) - pmin) * scale));
+                return b < cut;
+            }
+        );
+        int m= int(std::distance(refs.data(), pm));
+
+        // la repartition peut echouer, cf precision numerique, forcer quand meme un decoupage en 2 ensembles
+        if(m == begin || m == end)
+            m= (begin + end) / 2;
+
+        return node(bounds, refs, begin, m, end);
+    }
+
+    // construit les fils et le noeud interne, renvoie son indice
+    int node( const BBox& bounds, std::vector<Ref>& refs, const int begin, const int m, const int end )
+    {
+        assert(m != begin);
+        assert(m != end);
+
+        // construire le fils gauche, les primitives se trouvent dans [begin .. m)
+        int left= build(refs, begin, m);
+        // on recommence pour le fils droit, les primitives se trouvent dans [m .. end)
+        int right= build(refs, m, end);
+
+        // construire le noeud et renvoyer son indice
+        int index= int(nodes.size());
+        nodes.push_back( make_node(bounds, left, right) );
+        return index;
+    }
+
+    // insere une feuille et renvoie son indice
+    int leaf( const BBox& bounds, const int begin, const int end )
+    {
+        int index= int(nodes.size());
+        nodes.push_back( make_leaf(bounds, begin, end) );
+        return index;
+    }
+};
+
+
+//! triangle pour le bvh, cf fonctions bounds() et intersect().
+struct Triangle
+{
+    Point p;            // sommet a du triangle
+    Vector e1, e2;      // aretes ab, ac du triangle
+    int id;             // indice du triangle
+
+    Triangle( const TriangleData& data, const int _id ) : p(data.a), e1(Vector(data.a, data.b)), e2(Vector(data.a, data.c)), id(_id) {}
+
+    /*! calcule l'intersection ray/triangle
+        cf "fast, minimum storage ray-triangle intersection"
+
+        renvoie faux s'il n'y a pas d'intersection valide (une intersection peut exister mais peut ne pas se trouver dans l'intervalle [0 htmax] du rayon.)
+        renvoie vrai + les coordonnees barycentriques (u, v) du point d'intersection + sa position le long du rayon (t).
+        convention barycentrique : p(u, v)= (1 - u - v) * a + u * b + v * c
+    */
+    Hit intersect( const Ray &ray, const float htmax ) const
+    {
+        Vector pvec= cross(ray.d, e2);
+        float det= dot(e1, pvec);
+
+        float inv_det= 1 / det;
+        Vector tvec(p, ray.o);
+
+        // comparaisons "positives" : les triangles degeneres, det == 0 et u, v, t == nan, ne sont jamais intersectes
+        float u= dot(tvec, pvec) * inv_det;
+        if(!(u >= 0 && u <= 1)) return Hit();           // pas d'intersection
+
+        Vector qvec= cross(tvec, e1);
+        float v= dot(ray.d, qvec) * inv_det;
+        if(!(v >= 0 && u + v <= 1)) return Hit();       // pas d'intersection
+
+        float t= dot(e2, qvec) * inv_det;
+        if(!(t >= 0 && t <= htmax)) return Hit();       // pas d'intersection
+
+        return Hit(t, u, v, id);                // p(u, v)= (1 - u - v) * a + u * b + v * c
+    }
+
+    //! renvoie vrai s'il existe une intersection valide, entre 0 et htmax. meme test que intersect(), sans construire le Hit, cf rayons d'ombre.
+    bool occluded( const Ray &ray, const float htmax ) const
+    {
+        Vector pvec= cross(ray.d, e2);
+        float det= dot(e1, pvec);
+
+        float inv_det= 1 / det;
+        Vector tvec(p, ray.o);
+
+        float u= dot(tvec, pvec) * inv_det;
+        if(!(u >= 0 && u <= 1)) return false;
+
+        Vector qvec= cross(tvec, e1);
+        float v= dot(ray.d, qvec) * inv_det;
+        if(!(v >= 0 && u + v <= 1)) return false;
+
+        float t= dot(e2, qvec) * inv_det;
+        return (t >= 0 && t <= htmax);
+    }
+
+    //! englobant du triangle.
+    BBox bounds( ) const
+    {
+        BBox box(p);
+        return box.insert(p+e1).insert(p+e2);
+    }
+
+    //! aire du triangle.
+    float area( ) const { return 0.5f * length(cross(e1, e2)); }
+};
+
+typedef BVHT<Triangle> BVH;
+
+
+//! intersection la plus proche avec un ensemble de primitives, sans bvh, entre 0 et htmax.
+template < typename T >
+Hit intersect( const std::vector<T>& primitives, const Ray& ray, const float htmax )
+{
+    Hit hit;
+    hit.t= htmax;
+    for(unsigned i= 0; i < primitives.size(); i++)
+        if(Hit h= primitives[i].intersect(ray, hit.t))
+            hit= h;
+
+    return hit;
+}
+
+//! renvoie vrai s'il existe une intersection avec un ensemble de primitives, sans bvh, entre 0 et htmax. s'arrete sur la premiere intersection.
+template < typename T >
+bool occluded( const std::vector<T>& primitives, const Ray& ray, const float htmax )
+{
+    for(unsigned i= 0; i < primitives.size(); i++)
+        if(primitives[i].occluded(ray, htmax))
+            return true;
+
+    return false;
+}
+
+///@}
+#endif
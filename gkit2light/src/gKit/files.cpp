@@ -1,11 +1,15 @@
 
 #ifndef _MSC_VER
     #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
 #else
     #include <sys/types.h>
     #include <sys/stat.h>
 #endif
 
+#include <cstdio>
 #include <string>
 #include <algorithm>
 
@@ -115,3 +119,82 @@ std::string relative_filename( const std::string& filename, const std::string& p
     
     return filename.substr(i);
 }
+
+
+int MappedFile::open( const std::string& filename )
+{
+    close();
+    
+#ifndef _MSC_VER
+    int fd= ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return -1;
+    
+    struct stat info;
+    if(fstat(fd, &info) < 0 || !S_ISREG(info.st_mode))
+    {
+        ::close(fd);
+        return -1;
+    }
+    
+    m_size= size_t(info.st_size);
+    if(m_size == 0)
+    {
+        // mmap n'accepte pas les fichiers vides...
+        ::close(fd);
+        m_data= "";
+        return 0;
+    }
+    
+    void *data= mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);        // la projection reste valide
+    if(data != MAP_FAILED)
+    {
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        m_data= (const char *) data;
+        m_mapped= true;
+        return 0;
+    }
+#endif
+    
+    // pas de mmap, charge le fichier
+    FILE *in= fopen(filename.c_str(), "rb");
+    if(in == nullptr)
+        return -1;
+    
+    fseek(in, 0, SEEK_END);
+    long size= ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if(size < 0)
+    {
+        fclose(in);
+        return -1;
+    }
+    
+    m_buffer.resize(size_t(size));
+    size_t n= fread(m_buffer.data(), 1, m_buffer.size(), in);
+    fclose(in);
+    if(n != m_buffer.size())
+    {
+        m_buffer.clear();
+        return -1;
+    }
+    
+    m_size= m_buffer.size();
+    m_data= m_buffer.empty() ? "" : m_buffer.data();
+    return 0;
+}
+
+void MappedFile::close( )
+{
+#ifndef _MSC_VER
+    if(m_mapped)
+        munmap((void *) m_data, m_size);
+#endif
+    
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_data= nullptr;
+    m_size= 0;
+    m_mapped= false;
+}
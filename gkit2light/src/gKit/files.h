@@ -3,6 +3,7 @@
 #define _FILES_H
 
 #include <string>
+#include <vector>
 
 //! verifie l'existance d'un fichier.
 bool exists( const std::string& filename );
@@ -27,4 +28,42 @@ std::string normalize_filename( const std::string& filename );
 */
 std::string relative_filename( const std::string& filename, const std::string& path );
 
+
+/*! contenu d'un fichier, en lecture seule. le fichier est projete en memoire (mmap) si possible, sinon il est charge completement.
+    \code
+    MappedFile file("data/bigguy.obj");
+    if(file.data() == nullptr)
+        return "erreur";
+    
+    const char *begin= file.data();
+    const char *end= file.data() + file.size();
+    \endcode
+ */
+class MappedFile
+{
+public:
+    MappedFile( ) : m_data(nullptr), m_size(0), m_buffer(), m_mapped(false) {}
+    MappedFile( const std::string& filename ) : m_data(nullptr), m_size(0), m_buffer(), m_mapped(false) { open(filename); }
+    ~MappedFile( ) { close(); }
+    
+    //! ouvre un fichier. renvoie -1 en cas d'erreur.
+    int open( const std::string& filename );
+    //! ferme le fichier.
+    void close( );
+    
+    //! renvoie le contenu du fichier, ou nullptr.
+    const char *data( ) const { return m_data; }
+    //! renvoie la taille du fichier, en octets.
+    size_t size( ) const { return m_size; }
+    
+protected:
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator= ( const MappedFile& ) = delete;
+    
+    const char *m_data;
+    size_t m_size;
+    std::vector<char> m_buffer;     // contenu du fichier, s'il n'est pas projete en memoire
+    bool m_mapped;
+};
+
 #endif
@@ -0,0 +1,339 @@
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define GK_SSE 1
+#endif
+
+#include "frustum.h"
+
+
+Frustum::Frustum( const Transform& view, const Transform& projection )
+{
+    Transform m= projection * view;
+    for(int i= 0; i < 3; i++)
+    {
+        // -w < x, y, z < w
+        planes[2*i]= vec4(m.m[3][0] + m.m[i][0], m.m[3][1] + m.m[i][1], m.m[3][2] + m.m[i][2], m.m[3][3] + m.m[i][3]);
+        planes[2*i +1]= vec4(m.m[3][0] - m.m[i][0], m.m[3][1] - m.m[i][1], m.m[3][2] - m.m[i][2], m.m[3][3] - m.m[i][3]);
+    }
+
+    for(int i= 0; i < 6; i++)
+    {
+        float l= length(Vector(planes[i].x, planes[i].y, planes[i].z));
+        planes[i]= vec4(planes[i].x / l, planes[i].y / l, planes[i].z / l, planes[i].w / l);
+    }
+
+    camera= Inverse(view)(Point(0, 0, 0));
+}
+
+bool Frustum::visible( const Point& center, const float radius ) const
+{
+    for(int i= 0; i < 6; i++)
+        if(planes[i].x * center.x + planes[i].y * center.y + planes[i].z * center.z + planes[i].w < -radius)
+            return false;
+    return true;
+}
+
+bool Frustum::visible( const Point& pmin, const Point& pmax ) const
+{
+    for(int i= 0; i < 6; i++)
+    {
+        // p-vertex : le sommet le plus loin dans la direction de la normale, la boite est en dehors s'il est derriere le plan
+        float x= (planes[i].x >= 0) ? pmax.x : pmin.x;
+        float y= (planes[i].y >= 0) ? pmax.y : pmin.y;
+        float z= (planes[i].z >= 0) ? pmax.z : pmin.z;
+        if(planes[i].x * x + planes[i].y * y + planes[i].z * z + planes[i].w < 0)
+            return false;
+    }
+    return true;
+}
+
+
+namespace {
+
+// boite vide, jamais visible : le p-vertex est toujours tres loin derriere chaque plan
+const float empty_min= 1e30f;
+const float empty_max= -1e30f;
+
+// classe les 8 boites d'un noeud par rapport a un plan : bits des boites en dehors, et des boites coupees par le plan.
+// version scalaire, meme test que Frustum::visible( ).
+inline void classify_scalar( const BoxNode& node, const vec4& plane, unsigned& outside, unsigned& straddle )
+{
+    // p-vertex et n-vertex, les memes coordonnees pour les 8 boites
+    const float *px= (plane.x >= 0) ? node.max_x : node.min_x;
+    const float *py= (plane.y >= 0) ? node.max_y : node.min_y;
+    const float *pz= (plane.z >= 0) ? node.max_z : node.min_z;
+    const float *nx= (plane.x >= 0) ? node.min_x : node.max_x;
+    const float *ny= (plane.y >= 0) ? node.min_y : node.max_y;
+    const float *nz= (plane.z >= 0) ? node.min_z : node.max_z;
+
+    outside= 0;
+    straddle= 0;
+    for(int i= 0; i < 8; i++)
+    {
+        float p= plane.x * px[i] + plane.y * py[i] + plane.z * pz[i] + plane.w;
+        float n= plane.x * nx[i] + plane.y * ny[i] + plane.z * nz[i] + plane.w;
+        if(p < 0)
+            outside|= 1u << i;
+        else if(n < 0)
+            straddle|= 1u << i;
+    }
+}
+
+#ifdef GK_SSE
+// version sse, 2 x 4 boites
+inline void classify_sse( const BoxNode& node, const vec4& plane, unsigned& outside, unsigned& straddle )
+{
+    const float *px= (plane.x >= 0) ? node.max_x : node.min_x;
+    const float *py= (plane.y >= 0) ? node.max_y : node.min_y;
+    const float *pz= (plane.z >= 0) ? node.max_z : node.min_z;
+    const float *nx= (plane.x >= 0) ? node.min_x : node.max_x;
+    const float *ny= (plane.y >= 0) ? node.min_y : node.max_y;
+    const float *nz= (plane.z >= 0) ? node.min_z : node.max_z;
+
+    __m128 a= _mm_set1_ps(plane.x), b= _mm_set1_ps(plane.y), c= _mm_set1_ps(plane.z), d= _mm_set1_ps(plane.w);
+    __m128 zero= _mm_setzero_ps();
+
+    outside= 0;
+    straddle= 0;
+    for(int i= 0; i < 8; i+= 4)
+    {
+        __m128 p= _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(px +i)), _mm_mul_ps(b, _mm_loadu_ps(py +i))), _mm_mul_ps(c, _mm_loadu_ps(pz +i))), d);
+        __m128 n= _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(nx +i)), _mm_mul_ps(b, _mm_loadu_ps(ny +i))), _mm_mul_ps(c, _mm_loadu_ps(nz +i))), d);
+        unsigned out= unsigned(_mm_movemask_ps(_mm_cmplt_ps(p, zero)));
+        unsigned cut= unsigned(_mm_movemask_ps(_mm_cmplt_ps(n, zero)));
+        outside|= out << i;
+        straddle|= (cut & ~out) << i;
+    }
+}
+#endif
+
+#ifdef __AVX2__
+// version avx2, 8 boites
+inline void classify_avx2( const BoxNode& node, const vec4& plane, unsigned& outside, unsigned& straddle )
+{
+    const float *px= (plane.x >= 0) ? node.max_x : node.min_x;
+    const float *py= (plane.y >= 0) ? node.max_y : node.min_y;
+    const float *pz= (plane.z >= 0) ? node.max_z : node.min_z;
+    const float *nx= (plane.x >= 0) ? node.min_x : node.max_x;
+    const float *ny= (plane.y >= 0) ? node.min_y : node.max_y;
+    const float *nz= (plane.z >= 0) ? node.min_z : node.max_z;
+
+    __m256 a= _mm256_set1_ps(plane.x), b= _mm256_set1_ps(plane.y), c= _mm256_set1_ps(plane.z), d= _mm256_set1_ps(plane.w);
+    __m256 zero= _mm256_setzero_ps();
+
+    __m256 p= _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(px)), _mm256_mul_ps(b, _mm256_loadu_ps(py))), _mm256_mul_ps(c, _mm256_loadu_ps(pz))), d);
+    __m256 n= _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(nx)), _mm256_mul_ps(b, _mm256_loadu_ps(ny))), _mm256_mul_ps(c, _mm256_loadu_ps(nz))), d);
+    outside= unsigned(_mm256_movemask_ps(_mm256_cmp_ps(p, zero, _CMP_LT_OQ)));
+    straddle= unsigned(_mm256_movemask_ps(_mm256_cmp_ps(n, zero, _CMP_LT_OQ))) & ~outside;
+}
+#endif
+
+// meilleure version disponible a la compilation : avx2, sse ou scalaire.
+inline void classify( const BoxNode& node, const vec4& plane, unsigned& outside, unsigned& straddle )
+{
+#if defined(__AVX2__)
+    classify_avx2(node, plane, outside, straddle);
+#elif defined(GK_SSE)
+    classify_sse(node, plane, outside, straddle);
+#else
+    classify_scalar(node, plane, outside, straddle);
+#endif
+}
+
+}
+
+
+void BoxBVH::build( const Mesh& mesh, const std::vector<TriangleGroup>& groups )
+{
+    const std::vector<vec3>& positions= mesh.positions();
+    const std::vector<unsigned>& indices= mesh.indices();
+
+    std::vector<Point> pmin(groups.size());
+    std::vector<Point> pmax(groups.size());
+    for(unsigned g= 0; g < groups.size(); g++)
+    {
+        Point bmin(empty_min, empty_min, empty_min);
+        Point bmax(empty_max, empty_max, empty_max);
+        for(int i= groups[g].first; i < groups[g].first + groups[g].n; i++)
+        {
+            Point p= Point(positions[indices.empty() ? i : indices[i]]);
+            bmin= min(bmin, p);
+            bmax= max(bmax, p);
+        }
+
+        pmin[g]= bmin;
+        pmax[g]= bmax;
+    }
+
+    build(pmin, pmax);
+}
+
+void BoxBVH::build( const std::vector<Point>& pmin, const std::vector<Point>& pmax )
+{
+    assert(pmin.size() == pmax.size());
+    m_nodes.clear();
+    m_count= int(pmin.size());
+    m_depth= 0;
+    if(m_count == 0)
+        return;
+
+    std::vector<int> ids(m_count);
+    std::vector<Point> centers(m_count);
+    for(int i= 0; i < m_count; i++)
+    {
+        ids[i]= i;
+        centers[i]= center(pmin[i], pmax[i]);
+    }
+
+    m_nodes.reserve(m_count / 4 + 1);
+    build_node(ids, centers, pmin, pmax, 0, m_count, 1);
+}
+
+int BoxBVH::build_node( std::vector<int>& ids, const std::vector<Point>& centers, const std::vector<Point>& pmin, const std::vector<Point>& pmax, const int begin, const int end, const int depth )
+{
+    m_depth= std::max(m_depth, depth);
+
+    // decoupe les boites en 8 parts, 3 fois en 2, sur l'axe le plus etendu des centres
+    int parts[9];
+    int count= 0;
+    if(end - begin <= 8)
+    {
+        for(int i= begin; i <= end; i++)
+            parts[count++]= i;
+        count--;
+    }
+    else
+    {
+        parts[0]= begin;
+        parts[1]= end;
+        count= 1;
+        for(int k= 0; k < 3; k++)
+        {
+            int split[9];
+            int n= 0;
+            for(int i= 0; i < count; i++)
+            {
+                int b= parts[i];
+                int e= parts[i +1];
+                split[n++]= b;
+                if(e - b < 2)
+                    continue;
+
+                Point cmin= centers[ids[b]];
+                Point cmax= centers[ids[b]];
+                for(int j= b; j < e; j++)
+                {
+                    cmin= min(cmin, centers[ids[j]]);
+                    cmax= max(cmax, centers[ids[j]]);
+                }
+
+                Vector extent= cmax - cmin;
+                int axis= (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z) ? 1 : 2;
+                int m= (b + e) / 2;
+                std::nth_element(ids.begin() + b, ids.begin() + m, ids.begin() + e,
+                    [&]( const int a, const int c ) { return centers[a](axis) < centers[c](axis); });
+                split[n++]= m;
+            }
+
+            split[n]= end;
+            std::copy(split, split + n +1, parts);
+            count= n;
+        }
+    }
+
+    int index= int(m_nodes.size());
+    m_nodes.push_back(BoxNode());
+    m_nodes[index].count= count;
+
+    for(int k= 0; k < 8; k++)
+    {
+        Point bmin(empty_min, empty_min, empty_min);
+        Point bmax(empty_max, empty_max, empty_max);
+        int child= 0;
+        if(k < count)
+        {
+            int b= parts[k];
+            int e= parts[k +1];
+            for(int i= b; i < e; i++)
+            {
+                bmin= min(bmin, pmin[ids[i]]);
+                bmax= max(bmax, pmax[ids[i]]);
+            }
+
+            // une seule boite : feuille, sinon un autre noeud
+            child= (e - b == 1) ? -(ids[b] +1) : build_node(ids, centers, pmin, pmax, b, e, depth +1);
+        }
+
+        // m_nodes est modifie par build_node( ), pas de reference sur le noeud...
+        BoxNode& node= m_nodes[index];
+        node.min_x[k]= bmin.x; node.min_y[k]= bmin.y; node.min_z[k]= bmin.z;
+        node.max_x[k]= bmax.x; node.max_y[k]= bmax.y; node.max_z[k]= bmax.z;
+        node.child[k]= child;
+    }
+
+    return index;
+}
+
+
+void BoxBVH::cull( const Frustum& frustum, std::vector<int>& visible ) const
+{
+    visible.clear();
+    if(m_nodes.empty())
+        return;
+
+    // pile : noeud + plans qui coupent encore le noeud, au plus 7 freres en attente par niveau
+    struct Entry
+    {
+        int node;
+        unsigned planes;
+    };
+    const int max_depth= 32;
+    Entry stack[7 * max_depth + 1];
+    assert(m_depth <= max_depth);
+
+    int top= 0;
+    stack[top++]= { 0, 0x3fu };
+    while(top > 0)
+    {
+        Entry entry= stack[--top];
+        const BoxNode& node= m_nodes[entry.node];
+
+        // teste les 8 boites avec chaque plan qui coupe encore le noeud
+        unsigned outside= 0;
+        unsigned planes[8]= { 0, 0, 0, 0, 0, 0, 0, 0 };     // plans qui coupent chaque boite
+        for(int p= 0; p < 6; p++)
+        {
+            if((entry.planes & (1u << p)) == 0)
+                continue;
+
+            unsigned out, cut;
+            classify(node, frustum.planes[p], out, cut);
+            outside|= out;
+            for(int i= 0; i < 8; i++)
+                planes[i]|= ((cut >> i) & 1u) << p;
+        }
+
+        // parcours les fils visibles dans l'ordre, derniers empiles, premiers depiles
+        unsigned used= (1u << node.count) -1;
+        unsigned children= used & ~outside;
+        for(int i= node.count -1; i >= 0; i--)
+        {
+            if((children & (1u << i)) == 0)
+                continue;
+
+            int child= node.child[i];
+            if(child < 0)
+                visible.push_back(-child -1);
+            else
+                stack[top++]= { child, planes[i] };
+        }
+    }
+}
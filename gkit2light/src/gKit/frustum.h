@@ -0,0 +1,89 @@
+
+#ifndef _FRUSTUM_H
+#define _FRUSTUM_H
+
+#include <vector>
+
+#include "vec.h"
+#include "mat.h"
+#include "mesh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! elimination des objets en dehors du frustum d'une camera : plans du frustum, test des boites englobantes, et bvh de boites, teste par paquets de 8.
+
+//! frustum d'une camera, 6 plans dans le repere du monde.
+struct Frustum
+{
+    Frustum( ) : camera() {}
+    //! construit les 6 plans du frustum, cf "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix", G. Gribb, K. Hartmann, 2001.
+    Frustum( const Transform& view, const Transform& projection );
+
+    //! renvoie vrai si la sphere touche le frustum.
+    bool visible( const Point& center, const float radius ) const;
+    /*! renvoie vrai si la boite touche le frustum. test p-vertex / n-vertex : le sommet de la boite le plus loin dans la direction de la normale de chaque plan.
+        les boites proches des coins du frustum peuvent etre visibles sans le toucher.
+     */
+    bool visible( const Point& pmin, const Point& pmax ) const;
+
+    vec4 planes[6];         //!< plans du frustum, repere du monde, normales vers l'interieur.
+    Point camera;           //!< position de la camera, repere du monde.
+};
+
+
+//! noeud du bvh : 8 boites, organisation SoA. fils : indice d'un noeud, ou -(indice de la boite +1). les fils inutilises ont une boite vide, elle n'est jamais visible.
+struct BoxNode
+{
+    float min_x[8], min_y[8], min_z[8];
+    float max_x[8], max_y[8], max_z[8];
+    int child[8];
+    int count;              //!< nombre de fils utilises, les premiers.
+};
+
+/*! bvh de boites englobantes, 8 fils par noeud, pour eliminer rapidement les objets en dehors du frustum.
+    les 8 boites d'un noeud sont testees en meme temps avec chaque plan du frustum (avx2, sse ou scalaire), les plans qui contiennent entierement une boite ne sont plus testes dans ses fils,
+    et les fils d'une boite entierement dans le frustum sont visibles, sans autre test.
+
+    utilisation :
+    \code
+    BoxBVH bvh;
+    bvh.build(mesh, groups);        // une boite par groupe de triangles
+
+    std::vector<int> visible;
+    // a chaque image
+    bvh.cull(Frustum(view, projection), visible);
+    for(int id : visible)
+        { ... }
+    \endcode
+ */
+class BoxBVH
+{
+public:
+    BoxBVH( ) : m_nodes(), m_count(0), m_depth(0) {}
+
+    //! construit le bvh des boites [pmin[i] pmax[i]].
+    void build( const std::vector<Point>& pmin, const std::vector<Point>& pmax );
+    //! construit le bvh des boites englobantes des groupes de triangles d'un mesh indexe, cf Mesh::groups( ).
+    void build( const Mesh& mesh, const std::vector<TriangleGroup>& groups );
+
+    /*! remplace le contenu de visible par les indices des boites qui touchent le frustum. pas d'allocation, si visible a deja la capacite necessaire.
+        meme resultat que Frustum::visible( ) pour chaque boite.
+     */
+    void cull( const Frustum& frustum, std::vector<int>& visible ) const;
+
+    //! renvoie le nombre de boites.
+    int size( ) const { return m_count; }
+
+protected:
+    int build_node( std::vector<int>& ids, const std::vector<Point>& centers, const std::vector<Point>& pmin, const std::vector<Point>& pmax, const int begin, const int end, const int depth );
+
+    std::vector<BoxNode> m_nodes;
+    int m_count;
+    int m_depth;
+};
+
+///@}
+#endif
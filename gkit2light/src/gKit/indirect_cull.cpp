@@ -0,0 +1,194 @@
+
+#include <cstdio>
+#include <algorithm>
+
+#include "indirect_cull.h"
+
+
+#ifndef NO_GLEW
+namespace {
+
+// meme organisation que dans src/shader/indirect_cull.glsl, std430.
+struct CellData
+{
+    vec4 pmin;          // w : nombre de niveaux de details
+    vec4 pmax;
+    vec4 sphere;        // sphere englobante des niveaux de details, cf MeshLod
+    vec4 errors;        // erreur de chaque niveau
+};
+
+struct CandidateData
+{
+    vec4 sphere;        // sphere englobante du meshlet
+    unsigned first;
+    unsigned count;
+    unsigned cell;
+    unsigned level;     // niveau de details, + candidate_meshlet pour les meshlets du niveau 0
+};
+
+const unsigned candidate_meshlet= 0x100;
+const int max_levels= 4;
+
+// meme organisation que les parametres de glMultiDrawElementsIndirect( )
+struct DrawData
+{
+    unsigned index_count;
+    unsigned instance_count;
+    unsigned first_index;
+    unsigned vertex_base;
+    unsigned instance_base;
+};
+
+// bindings des storage buffers, cf src/shader/indirect_cull.glsl
+enum { CELL_BINDING= 4, CANDIDATE_BINDING= 5, DRAW_BINDING= 6, COUNT_BINDING= 7 };
+
+}
+
+
+int IndirectCuller::create( const Mesh& mesh, const std::vector<TriangleGroup>& cells, const std::vector<MeshLod>& lods, const std::vector<Meshlet>& meshlets )
+{
+    if(GLEW_ARB_indirect_parameters == 0)
+    {
+        printf("[error] indirect culling: GL_ARB_indirect_parameters not supported...\n");
+        return -1;
+    }
+
+    const std::vector<vec3>& positions= mesh.positions();
+    const std::vector<unsigned>& indices= mesh.indices();
+
+    // englobants et niveaux de details des cellules
+    std::vector<CellData> cell_data(cells.size());
+    std::vector<CandidateData> candidates;
+    for(unsigned c= 0; c < cells.size(); c++)
+    {
+        Point pmin= Point(positions[indices[cells[c].first]]);
+        Point pmax= pmin;
+        for(int i= cells[c].first; i < cells[c].first + cells[c].n; i++)
+        {
+            pmin= min(pmin, Point(positions[indices[i]]));
+            pmax= max(pmax, Point(positions[indices[i]]));
+        }
+
+        const MeshLod& lod= lods[c];
+        int levels= std::min(int(lod.levels.size()), max_levels);
+        if(int(lod.levels.size()) > max_levels)
+            printf("[warning] indirect culling: cell %u, %d levels, only %d used...\n", c, int(lod.levels.size()), max_levels);
+
+        CellData& data= cell_data[c];
+        data.pmin= vec4(pmin, float(levels));
+        data.pmax= vec4(pmax, 0);
+        data.sphere= vec4(lod.center, lod.radius);
+        float errors[max_levels]= { 0, 0, 0, 0 };
+        for(int l= 0; l < levels; l++)
+            errors[l]= lod.levels[l].error;
+        data.errors= vec4(errors[0], errors[1], errors[2], errors[3]);
+
+        // niveau 0 complet, et niveaux simplifies
+        for(int l= 0; l < levels; l++)
+            candidates.push_back( { vec4(lod.center, lod.radius),
+                unsigned(lod.levels[l].first), unsigned(lod.levels[l].n), c, unsigned(l) } );
+    }
+
+    // meshlets du niveau 0, sans le cone des normales : les faces arrieres sont dessinees, cf MeshletCuller::visible_cone( )
+    for(const Meshlet& meshlet : meshlets)
+        candidates.push_back( { vec4(meshlet.center, meshlet.radius),
+            unsigned(meshlet.first), unsigned(meshlet.n), unsigned(meshlet.group), candidate_meshlet } );
+
+    m_candidate_count= int(candidates.size());
+
+    glGenBuffers(1, &m_cell_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_cell_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, cell_data.size() * sizeof(CellData), cell_data.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_candidate_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_candidate_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, candidates.size() * sizeof(CandidateData), candidates.data(), GL_STATIC_DRAW);
+
+    // parametres des draws visibles, ecrits par le compute shader, au pire tous les candidats
+    glGenBuffers(1, &m_draw_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_draw_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(1, m_candidate_count) * sizeof(DrawData), nullptr, GL_DYNAMIC_COPY);
+
+    // nombre de draws visibles
+    unsigned zero= 0;
+    glGenBuffers(1, &m_count_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_count_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned), &zero, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    printf("indirect culling: %d cells, %d candidate draws, %dKB\n", int(cells.size()), m_candidate_count,
+        int((cell_data.size() * sizeof(CellData) + candidates.size() * (sizeof(CandidateData) + sizeof(DrawData))) / 1024));
+    return 0;
+}
+
+void IndirectCuller::release( )
+{
+    if(m_cell_buffer)
+        glDeleteBuffers(1, &m_cell_buffer);
+    if(m_candidate_buffer)
+        glDeleteBuffers(1, &m_candidate_buffer);
+    if(m_draw_buffer)
+        glDeleteBuffers(1, &m_draw_buffer);
+    if(m_count_buffer)
+        glDeleteBuffers(1, &m_count_buffer);
+
+    m_cell_buffer= 0;
+    m_candidate_buffer= 0;
+    m_draw_buffer= 0;
+    m_count_buffer= 0;
+    m_candidate_count= 0;
+}
+
+void IndirectCuller::cull( const GLuint program, const Frustum& frustum, const float pixels_per_unit, const bool use_lods, const bool use_meshlets )
+{
+    if(m_candidate_count == 0)
+        return;
+
+    // remet le compteur a 0
+    unsigned zero= 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_count_buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CELL_BINDING, m_cell_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CANDIDATE_BINDING, m_candidate_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BINDING, m_draw_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, m_count_buffer);
+
+    glUseProgram(program);
+    glUniform4fv(glGetUniformLocation(program, "planes"), 6, &frustum.planes[0].x);
+    glUniform3f(glGetUniformLocation(program, "camera"), frustum.camera.x, frustum.camera.y, frustum.camera.z);
+    glUniform1f(glGetUniformLocation(program, "pixels_per_unit"), pixels_per_unit);
+    glUniform1ui(glGetUniformLocation(program, "use_lods"), use_lods ? 1 : 0);
+    glUniform1ui(glGetUniformLocation(program, "use_meshlets"), use_meshlets ? 1 : 0);
+
+    // 1 thread par candidat
+    glDispatchCompute((m_candidate_count + 255) / 256, 1, 1);
+
+    // les draws et le compteur sont relus par le multidraw
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+void IndirectCuller::draw( ) const
+{
+    if(m_candidate_count == 0)
+        return;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_draw_buffer);
+    glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_count_buffer);
+    glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, /* indirect */ 0, /* draw count */ 0, /* max draw count */ m_candidate_count, /* stride */ 0);
+    glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+}
+
+#else
+// pas de compute shaders, ni de GL_ARB_indirect_parameters, openGL 4.1 sur mac os
+int IndirectCuller::create( const Mesh&, const std::vector<TriangleGroup>&, const std::vector<MeshLod>&, const std::vector<Meshlet>& )
+{
+    printf("[error] indirect culling: openGL 4.3 and GL_ARB_indirect_parameters not supported...\n");
+    return -1;
+}
+
+void IndirectCuller::release( ) {}
+void IndirectCuller::cull( const GLuint, const Frustum&, const float, const bool, const bool ) {}
+void IndirectCuller::draw( ) const {}
+#endif
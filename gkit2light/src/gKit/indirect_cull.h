@@ -0,0 +1,70 @@
+
+#ifndef _INDIRECT_CULL_H
+#define _INDIRECT_CULL_H
+
+#include <vector>
+
+#include "glcore.h"
+#include "vec.h"
+#include "mesh.h"
+#include "meshlet.h"
+#include "mesh_simplify.h"
+#include "frustum.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! elimination des cellules et des meshlets invisibles par un compute shader, et affichage des draws visibles par un seul multidraw indirect count.
+
+/*! draws candidats des cellules d'un mesh indexe : chaque niveau de details simplifie de chaque cellule, le niveau 0 complet, et chaque meshlet du niveau 0.
+    un compute shader teste les candidats, cf src/shader/indirect_cull.glsl : boite englobante de la cellule avec le frustum, choix du niveau de details, et sphere englobante des meshlets.
+    les draws visibles sont ecrits dans un buffer de parametres de glMultiDrawElementsIndirect( ), avec leur nombre, instance_base est l'indice de la cellule, cf PackedMesh::definitions(true).
+    l'application n'a plus qu'un seul draw a faire, quelque soit le nombre de cellules et de meshlets visibles. necessite GL_ARB_indirect_parameters.
+
+    \code
+    IndirectCuller culler;
+    culler.create(mesh, cells, lods, meshlets);
+    GLuint program_cull= read_program("src/shader/indirect_cull.glsl");
+
+    // a chaque image
+    culler.cull(program_cull, Frustum(view, projection), pixels_per_unit, true, true);
+    glBindVertexArray(packed.vao());
+    glUseProgram(program);      // cf PackedMesh::definitions(true)
+    culler.draw();
+    \endcode
+ */
+class IndirectCuller
+{
+public:
+    IndirectCuller( ) : m_candidate_count(0), m_cell_buffer(0), m_candidate_buffer(0), m_draw_buffer(0), m_count_buffer(0) {}
+
+    /*! construit les buffers. cells : niveau 0 de chaque cellule, lods : niveaux de details de chaque cellule, cf build_lods( ), meshlets : meshlets du niveau 0, cf build_meshlets( ).
+        renvoie -1 si GL_ARB_indirect_parameters n'est pas disponible, ou sans glew (mac os, openGL 4.1).
+     */
+    int create( const Mesh& mesh, const std::vector<TriangleGroup>& cells, const std::vector<MeshLod>& lods, const std::vector<Meshlet>& meshlets );
+    //! detruit les buffers.
+    void release( );
+
+    /*! teste les candidats et ecrit les draws visibles. program : shader program compile a partir de src/shader/indirect_cull.glsl.
+        pixels_per_unit : cf select_lod( ). use_lods : choisit le niveau de chaque cellule, sinon niveau 0. use_meshlets : teste les meshlets du niveau 0, sinon dessine le niveau 0 complet.
+     */
+    void cull( const GLuint program, const Frustum& frustum, const float pixels_per_unit, const bool use_lods, const bool use_meshlets );
+    //! dessine les draws visibles, un seul glMultiDrawElementsIndirectCount( ). le vao et le shader program doivent etre selectionnes.
+    void draw( ) const;
+
+    //! renvoie le nombre de draws candidats.
+    int candidate_count( ) const { return m_candidate_count; }
+
+protected:
+    int m_candidate_count;
+
+    GLuint m_cell_buffer;
+    GLuint m_candidate_buffer;
+    GLuint m_draw_buffer;
+    GLuint m_count_buffer;
+};
+
+///@}
+#endif
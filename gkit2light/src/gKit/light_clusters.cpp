@@ -0,0 +1,406 @@
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "light_clusters.h"
+
+
+#ifdef GL_VERSION_4_4
+int LightBuffer::create( const int capacity )
+{
+    // le contexte demande par l'application peut etre plus ancien que openGL 4.4
+    if(GLEW_VERSION_4_4 == 0 && GLEW_ARB_buffer_storage == 0)
+    {
+        printf("[error] light buffer: openGL 4.4 / GL_ARB_buffer_storage not supported...\n");
+        return -1;
+    }
+
+    // les regions doivent respecter l'alignement des bindings
+    GLint alignment= 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_alignment= std::max(GLint(1), alignment);
+
+    m_region= 0;
+    m_count= 0;
+    for(int i= 0; i < 3; i++)
+        m_fences[i]= 0;
+
+    return allocate(capacity);
+}
+
+int LightBuffer::allocate( const int capacity )
+{
+    m_capacity= std::max(1, capacity);
+    m_region_size= (m_capacity * sizeof(PointLight) + m_alignment -1) / m_alignment * m_alignment;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, 3 * m_region_size, nullptr, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT);
+
+    // map persistant : le pointeur reste valide tant que le buffer existe
+    m_data= (char *) glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, 3 * m_region_size,
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if(m_data == nullptr)
+    {
+        printf("[error] light buffer: map %dKB...\n", int(3 * m_region_size / 1024));
+        return -1;
+    }
+
+    printf("light buffer: %d lights, 3x %dKB\n", m_capacity, int(m_region_size / 1024));
+    return 0;
+}
+
+void LightBuffer::release( )
+{
+    for(int i= 0; i < 3; i++)
+    {
+        if(m_fences[i])
+            glDeleteSync(m_fences[i]);
+        m_fences[i]= 0;
+    }
+
+    if(m_buffer)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    m_buffer= 0;
+    m_data= nullptr;
+    m_capacity= 0;
+    m_count= 0;
+}
+
+void LightBuffer::wait( const int region )
+{
+    if(m_fences[region] == 0)
+        return;
+
+    // attend que le gpu termine les draws qui lisent la region
+    GLenum status= glClientWaitSync(m_fences[region], 0, 0);
+    while(status == GL_TIMEOUT_EXPIRED)
+        status= glClientWaitSync(m_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);    // 1ms
+
+    glDeleteSync(m_fences[region]);
+    m_fences[region]= 0;
+}
+
+PointLight *LightBuffer::map( const int count )
+{
+    if(count > m_capacity)
+    {
+        // agrandit le buffer, apres la fin des draws qui utilisent l'ancien
+        for(int i= 0; i < 3; i++)
+            wait(i);
+
+        int capacity= std::max(count, 2 * m_capacity);
+        release();
+        if(allocate(capacity) < 0)
+            return nullptr;
+    }
+
+    wait(m_region);
+    m_count= count;
+    return (PointLight *) (m_data + m_region * m_region_size);
+}
+
+void LightBuffer::unmap( )
+{
+    if(m_count == 0)
+        return;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffer);
+    glFlushMappedBufferRange(GL_SHADER_STORAGE_BUFFER, m_region * m_region_size, m_count * sizeof(PointLight));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // rend les ecritures visibles par les prochains draws
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+}
+
+void LightBuffer::bind( const GLuint binding ) const
+{
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, m_buffer, m_region * m_region_size, m_region_size);
+}
+
+void LightBuffer::fence( )
+{
+    if(m_fences[m_region])
+        glDeleteSync(m_fences[m_region]);
+    m_fences[m_region]= glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_region= (m_region + 1) % 3;
+}
+
+#else
+// pas de storage buffers, ni de buffers persistants, openGL 4.1 sur mac os
+int LightBuffer::create( const int )
+{
+    printf("[error] light buffer: openGL 4.4 persistent storage buffers not supported...\n");
+    return -1;
+}
+
+int LightBuffer::allocate( const int ) { return -1; }
+void LightBuffer::release( ) {}
+void LightBuffer::wait( const int ) {}
+PointLight *LightBuffer::map( const int ) { return nullptr; }
+void LightBuffer::unmap( ) {}
+void LightBuffer::bind( const GLuint ) const {}
+void LightBuffer::fence( ) {}
+#endif
+
+
+int LightClusters::create( const int width, const int height, const int tile, const int slices )
+{
+    m_width= width;
+    m_height= height;
+    m_tile= tile;
+    m_grid_x= (width + tile -1) / tile;
+    m_grid_y= (height + tile -1) / tile;
+    m_grid_z= slices;
+
+    m_clusters.assign(2 * cluster_count(), 0);
+    m_lists.assign(cluster_count(), std::vector<unsigned>());
+
+#ifdef GL_VERSION_4_3
+    glGenBuffers(1, &m_cluster_buffer);
+    glGenBuffers(1, &m_index_buffer);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_cluster_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_clusters.size() * sizeof(unsigned), m_clusters.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    printf("light clusters: %dx%dx%d, %d froxels\n", m_grid_x, m_grid_y, m_grid_z, cluster_count());
+    return 0;
+#else
+    // pas de storage buffers, openGL 4.1 sur mac os. les listes sont quand meme construites par update( )
+    printf("[error] light clusters: openGL 4.3 storage buffers not supported...\n");
+    return -1;
+#endif
+}
+
+void LightClusters::release( )
+{
+    if(m_cluster_buffer)
+        glDeleteBuffers(1, &m_cluster_buffer);
+    if(m_index_buffer)
+        glDeleteBuffers(1, &m_index_buffer);
+
+    m_cluster_buffer= 0;
+    m_index_buffer= 0;
+    m_index_buffer_size= 0;
+}
+
+
+namespace {
+
+// tranches touchees par une lumiere, + sphere dans le repere camera.
+struct LightBounds
+{
+    Point center;
+    float radius;
+    int z0, z1;
+};
+
+int clamp_index( const float v, const int n )
+{
+    if(v < 0) return 0;
+    if(v >= float(n)) return n -1;
+    return int(v);
+}
+
+}
+
+
+int LightClusters::cluster( const float x, const float y, const float z ) const
+{
+    int tx= clamp_index(x / m_tile, m_grid_x);
+    int ty= clamp_index(y / m_tile, m_grid_y);
+    int tz= clamp_index(std::log(z / m_znear) / std::log(m_zfar / m_znear) * m_grid_z, m_grid_z);
+    return tx + m_grid_x * (ty + m_grid_y * tz);
+}
+
+void LightClusters::update( const std::vector<PointLight>& lights, const Transform& view, const Transform& projection, const float znear, const float zfar )
+{
+    m_znear= znear;
+    m_zfar= zfar;
+
+    const float px= projection.m[0][0];
+    const float py= projection.m[1][1];
+    const float slice_scale= m_grid_z / std::log(zfar / znear);
+    auto slice= [&]( const float d ) { return clamp_index(std::log(d / znear) * slice_scale, m_grid_z); };
+    // ndc -> tuile
+    auto tile_x= [&]( const float x ) { return clamp_index((x * 0.5f + 0.5f) * m_width / m_tile, m_grid_x); };
+    auto tile_y= [&]( const float y ) { return clamp_index((y * 0.5f + 0.5f) * m_height / m_tile, m_grid_y); };
+
+    // 1. tranches touchees par chaque lumiere
+    const int n= int(lights.size());
+    std::vector<LightBounds> bounds(n);
+    #pragma omp parallel for
+    for(int i= 0; i < n; i++)
+    {
+        LightBounds& b= bounds[i];
+        b.center= view(Point(lights[i].position));
+        b.radius= lights[i].radius;
+        b.z0= 1; b.z1= 0;       // invisible, par defaut
+
+        // camera orientee vers -z
+        float d= -b.center.z;
+        float r= b.radius;
+        if(d + r < znear || d - r > zfar)
+            continue;
+
+        b.z0= slice(std::max(d - r, znear));
+        b.z1= slice(std::min(d + r, zfar));
+    }
+
+    // 2. lumieres de chaque tranche, dans l'ordre
+    if(int(m_slices.size()) != m_grid_z)
+        m_slices.resize(m_grid_z);
+    for(int z= 0; z < m_grid_z; z++)
+        m_slices[z].clear();
+    for(int i= 0; i < n; i++)
+        for(int z= bounds[i].z0; z <= bounds[i].z1; z++)
+            m_slices[z].push_back(i);
+
+    // 3. teste chaque lumiere de la tranche avec la boite englobante des froxels, une tranche par thread
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int z= 0; z < m_grid_z; z++)
+    {
+        for(int k= 0; k < m_grid_x * m_grid_y; k++)
+            m_lists[k + m_grid_x * m_grid_y * z].clear();
+
+        float d0= znear * std::exp(float(z) / slice_scale);
+        float d1= znear * std::exp(float(z +1) / slice_scale);
+
+        // limites des tuiles dans la tranche, repere camera : x = ndc * d / px
+        std::vector<float> xmin(m_grid_x), xmax(m_grid_x);
+        for(int x= 0; x < m_grid_x; x++)
+        {
+            float nx0= float(x * m_tile) / m_width * 2 - 1;
+            float nx1= float((x +1) * m_tile) / m_width * 2 - 1;
+            xmin[x]= std::min(nx0 * d0, nx0 * d1) / px;
+            xmax[x]= std::max(nx1 * d0, nx1 * d1) / px;
+        }
+        std::vector<float> ymin(m_grid_y), ymax(m_grid_y);
+        for(int y= 0; y < m_grid_y; y++)
+        {
+            float ny0= float(y * m_tile) / m_height * 2 - 1;
+            float ny1= float((y +1) * m_tile) / m_height * 2 - 1;
+            ymin[y]= std::min(ny0 * d0, ny0 * d1) / py;
+            ymax[y]= std::max(ny1 * d0, ny1 * d1) / py;
+        }
+
+        for(unsigned l= 0; l < m_slices[z].size(); l++)
+        {
+            unsigned id= m_slices[z][l];
+            const Point& c= bounds[id].center;
+            const float r= bounds[id].radius;
+            const float d= -c.z;
+
+            // partie de la sphere dans la tranche : profondeurs [t0 t1], rayon max de la section rs
+            float t0= std::max(d - r, d0);
+            float t1= std::min(d + r, d1);
+            float tc= std::min(std::max(d, t0), t1);
+            float rs= std::sqrt(std::max(0.f, r*r - (tc - d)*(tc - d)));
+
+            // projection de la boite englobante, x / t est extremal sur les coins
+            int x0= tile_x(px * std::min((c.x - rs) / t0, (c.x - rs) / t1));
+            int x1= tile_x(px * std::max((c.x + rs) / t0, (c.x + rs) / t1));
+            int y0= tile_y(py * std::min((c.y - rs) / t0, (c.y - rs) / t1));
+            int y1= tile_y(py * std::max((c.y + rs) / t0, (c.y + rs) / t1));
+
+            float dz= std::max(0.f, std::max(d0 - d, d - d1));
+            for(int y= y0; y <= y1; y++)
+            {
+                float dy= std::max(0.f, std::max(ymin[y] - c.y, c.y - ymax[y]));
+                for(int x= x0; x <= x1; x++)
+                {
+                    float dx= std::max(0.f, std::max(xmin[x] - c.x, c.x - xmax[x]));
+
+                    // distance de la sphere a la boite du froxel
+                    if(dx*dx + dy*dy + dz*dz <= r*r)
+                        m_lists[x + m_grid_x * (y + m_grid_y * z)].push_back(id);
+                }
+            }
+        }
+    }
+
+    // 4. concatene les listes
+    unsigned count= 0;
+    for(int c= 0; c < cluster_count(); c++)
+    {
+        m_clusters[2*c]= count;
+        m_clusters[2*c +1]= unsigned(m_lists[c].size());
+        count+= unsigned(m_lists[c].size());
+    }
+
+    m_indices.resize(count);
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(int c= 0; c < cluster_count(); c++)
+        std::copy(m_lists[c].begin(), m_lists[c].end(), m_indices.begin() + m_clusters[2*c]);
+
+    // transfere les buffers
+    if(m_cluster_buffer == 0)
+        return;
+
+#ifdef GL_VERSION_4_3
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_cluster_buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_clusters.size() * sizeof(unsigned), m_clusters.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_index_buffer);
+    m_index_buffer_size= std::max(size_t(1), m_indices.size()) * sizeof(unsigned);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_index_buffer_size, m_indices.empty() ? nullptr : m_indices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+#endif
+}
+
+
+std::string LightClusters::definitions( ) const
+{
+    // les storage buffers sont declares par le fragment shader, cf LightClusters
+    return std::string(
+        "#define LIGHT_CLUSTERS\n"
+        "struct Light { vec4 position; vec4 color; };\n"     // position.w : rayon, color.a : intensite
+        "uniform uvec3 cluster_grid;\n"
+        "uniform float cluster_tile;\n"
+        "uniform float cluster_znear;\n"
+        "uniform float cluster_zfar;\n"
+        "// depth : profondeur du pixel dans le zbuffer, [0 1]\n"
+        "uint cluster_index( const in vec2 fragcoord, const in float depth )\n"
+        "{\n"
+        "    float z= 2.0 * depth - 1.0;\n"
+        "    float d= 2.0 * cluster_znear * cluster_zfar / (cluster_zfar + cluster_znear - z * (cluster_zfar - cluster_znear));\n"
+        "    float slice= log(d / cluster_znear) / log(cluster_zfar / cluster_znear) * float(cluster_grid.z);\n"
+        "    uvec3 c= uvec3(uvec2(max(fragcoord / cluster_tile, vec2(0))), uint(max(slice, 0.0)));\n"
+        "    c= min(c, cluster_grid - 1u);\n"
+        "    return c.x + cluster_grid.x * (c.y + cluster_grid.y * c.z);\n"
+        "}\n");
+}
+
+void LightClusters::uniforms( const GLuint program ) const
+{
+#ifdef GL_VERSION_4_3
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_cluster_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_index_buffer);
+#endif
+
+    // les uniforms inutilises par le shader sont ignores
+    GLint location= glGetUniformLocation(program, "cluster_grid");
+    if(location >= 0) glUniform3ui(location, m_grid_x, m_grid_y, m_grid_z);
+    location= glGetUniformLocation(program, "cluster_tile");
+    if(location >= 0) glUniform1f(location, float(m_tile));
+    location= glGetUniformLocation(program, "cluster_znear");
+    if(location >= 0) glUniform1f(location, m_znear);
+    location= glGetUniformLocation(program, "cluster_zfar");
+    if(location >= 0) glUniform1f(location, m_zfar);
+}
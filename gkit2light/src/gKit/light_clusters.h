@@ -0,0 +1,173 @@
+
+#ifndef _LIGHT_CLUSTERS_H
+#define _LIGHT_CLUSTERS_H
+
+#include <string>
+#include <vector>
+
+#include "glcore.h"
+#include "vec.h"
+#include "mat.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! eclairage par froxels / clusters : chaque pixel n'evalue que les lumieres proches.
+
+//! lumiere ponctuelle, avec un rayon d'influence fini. meme organisation que dans les shaders, 2 vec4, cf LightClusters::definitions( ) et LightBuffer.
+struct PointLight
+{
+    vec3 position;
+    float radius;           //!< rayon d'influence, la lumiere n'eclaire rien au dela.
+    vec3 color;
+    float intensity;
+
+    PointLight( ) : position(), radius(1), color(1, 1, 1), intensity(1) {}
+    PointLight( const vec3& p, const float r, const vec3& c= vec3(1, 1, 1), const float i= 1 ) : position(p), radius(r), color(c), intensity(i) {}
+};
+
+
+/*! stockage des lumieres pour les shaders : storage buffer, map persistant, 3 regions utilisees a tour de role (triple buffering).
+    l'application ecrit directement les lumieres de l'image dans la region courante, pendant que le gpu lit encore les regions des images precedentes.
+    un fence par region evite d'ecrire dans une region que le gpu n'a pas fini de lire, le buffer est agrandi au besoin, le nombre de lumieres n'est pas limite.
+    \code
+    LightBuffer buffer;
+    buffer.create(1024);
+
+    // a chaque image
+    PointLight *lights= buffer.map(n);
+    for(int i= 0; i < n; i++)
+        lights[i]= { ... };     // uniquement des ecritures, ne pas relire le contenu du buffer
+    buffer.unmap();
+
+    buffer.bind(0);             // layout(std430, binding= 0) readonly buffer clusterLights { Light lights[]; };
+    glDraw( ... );
+    buffer.fence();             // apres le dernier draw qui utilise les lumieres
+    \endcode
+ */
+class LightBuffer
+{
+public:
+    LightBuffer( ) : m_buffer(0), m_data(nullptr), m_capacity(0), m_region_size(0), m_alignment(0), m_region(0), m_count(0), m_fences() {}
+
+    //! cree le buffer, pour capacity lumieres. renvoie -1 sans openGL 4.4 ou GL_ARB_buffer_storage.
+    int create( const int capacity );
+    //! detruit le buffer.
+    void release( );
+
+    //! renvoie la region courante, pour ecrire count lumieres. attend, si necessaire, que le gpu termine les draws qui utilisent encore cette region. agrandit le buffer si count depasse la capacite.
+    PointLight *map( const int count );
+    //! termine les ecritures dans la region courante.
+    void unmap( );
+    //! selectionne la region courante sur un binding de storage buffer.
+    void bind( const GLuint binding ) const;
+    //! insere le fence de la region courante, apres les draws qui l'utilisent, et passe a la region suivante.
+    void fence( );
+
+    //! renvoie le nombre de lumieres de la region courante.
+    int count( ) const { return m_count; }
+    //! renvoie le nombre max de lumieres, avant d'agrandir le buffer.
+    int capacity( ) const { return m_capacity; }
+
+protected:
+    int allocate( const int capacity );
+    void wait( const int region );
+
+    GLuint m_buffer;
+    char *m_data;
+    int m_capacity;
+    size_t m_region_size;
+    size_t m_alignment;
+    int m_region;
+    int m_count;
+    GLsync m_fences[3];
+};
+
+
+/*! repartit des lumieres ponctuelles dans les froxels du frustum d'une camera : tuiles de l'image x tranches de profondeur, reparties exponentiellement entre znear et zfar.
+    cf "Clustered Deferred and Forward Shading", O. Olsson, M. Billeter, U. Assarsson, 2012.
+
+    les listes de lumieres sont construites sur le cpu, a chaque image, et transferees dans 2 storage buffers : premier indice + nombre de lumieres par froxel, indices des lumieres.
+    les lumieres sont fournies par un LightBuffer, sur le binding 0. les listes sont selectionnees sur les bindings 1 et 2 par uniforms( ). les buffers sont declares par le fragment shader (certaines implementations n'acceptent pas de storage buffers dans les vertex shaders) :
+    \code
+    LightBuffer buffer;
+    buffer.create(lights.size());
+    LightClusters clusters;
+    clusters.create(window_width(), window_height());
+    GLuint program= read_program("shader.glsl", clusters.definitions().c_str());
+
+    // a chaque image
+    std::copy(lights.begin(), lights.end(), buffer.map(lights.size()));
+    buffer.unmap();
+    clusters.update(lights, view, projection, znear, zfar);
+    glUseProgram(program);
+    buffer.bind(0);
+    clusters.uniforms(program);
+    glDraw( ... );
+    buffer.fence();
+
+    // shader.glsl, openGL 4.3, fragment shader
+    layout(std430, binding= 0) readonly buffer clusterLights { Light lights[]; };
+    layout(std430, binding= 1) readonly buffer clusterRanges { uvec2 clusters[]; };
+    layout(std430, binding= 2) readonly buffer clusterIndices { uint light_indices[]; };
+
+    uvec2 cluster= clusters[cluster_index(gl_FragCoord.xy, depth)];
+    for(uint i= 0u; i < cluster.y; i++)
+    {
+        Light light= lights[light_indices[cluster.x + i]];
+        ...
+    }
+    \endcode
+ */
+class LightClusters
+{
+public:
+    LightClusters( ) : m_width(0), m_height(0), m_tile(0), m_grid_x(0), m_grid_y(0), m_grid_z(0), m_znear(0), m_zfar(0),
+        m_clusters(), m_indices(), m_lists(), m_slices(), m_cluster_buffer(0), m_index_buffer(0), m_index_buffer_size(0) {}
+
+    //! construit les buffers, pour une image de width x height pixels, decoupee en tuiles de tile x tile pixels, et slices tranches de profondeur. renvoie -1 sans openGL 4.3.
+    int create( const int width, const int height, const int tile= 64, const int slices= 24 );
+    //! detruit les buffers.
+    void release( );
+
+    //! repartit les lumieres dans les froxels de la camera, et transfere les listes. znear, zfar : parametres de la projection perspective.
+    void update( const std::vector<PointLight>& lights, const Transform& view, const Transform& projection, const float znear, const float zfar );
+
+    //! renvoie le source glsl a passer a read_program( ) : structure Light, uniforms de la grille, et cluster_index( ).
+    std::string definitions( ) const;
+    //! selectionne les storage buffers et transmet les parametres de la grille au shader program en cours d'utilisation.
+    void uniforms( const GLuint program ) const;
+
+    //! renvoie l'indice du froxel qui contient le pixel (x, y), a la distance z de la camera.
+    int cluster( const float x, const float y, const float z ) const;
+    //! renvoie le nombre de froxels.
+    int cluster_count( ) const { return m_grid_x * m_grid_y * m_grid_z; }
+    //! renvoie le premier indice et le nombre de lumieres de chaque froxel, cf indices( ).
+    const std::vector<unsigned>& clusters( ) const { return m_clusters; }
+    //! renvoie les indices des lumieres de tous les froxels.
+    const std::vector<unsigned>& indices( ) const { return m_indices; }
+
+protected:
+    int m_width;
+    int m_height;
+    int m_tile;
+    int m_grid_x;
+    int m_grid_y;
+    int m_grid_z;
+    float m_znear;
+    float m_zfar;
+
+    std::vector<unsigned> m_clusters;
+    std::vector<unsigned> m_indices;
+    std::vector< std::vector<unsigned> > m_lists;
+    std::vector< std::vector<unsigned> > m_slices;
+
+    GLuint m_cluster_buffer;
+    GLuint m_index_buffer;
+    size_t m_index_buffer_size;
+};
+
+///@}
+#endif
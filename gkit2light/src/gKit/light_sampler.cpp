@@ -0,0 +1,150 @@
+
+#include <cassert>
+#include <algorithm>
+
+#include "light_sampler.h"
+
+
+int LightSampler::build( const Mesh& mesh )
+{
+    std::vector<int> ids;
+    std::vector<float> weights;
+    for(int i= 0; i < mesh.triangle_count(); i++)
+    {
+        const Material& material= mesh.triangle_material(i);
+        float power= material.emission.power();
+        if(power <= 0)
+            continue;
+
+        const TriangleData& triangle= mesh.triangle(i);
+        float area= length(cross(Point(triangle.b) - Point(triangle.a), Point(triangle.c) - Point(triangle.a))) / 2;
+
+        ids.push_back(i);
+        weights.push_back(area * power);
+    }
+
+    return build(ids, weights);
+}
+
+int LightSampler::build( const std::vector<int>& ids, const std::vector<float>& weights )
+{
+    assert(ids.size() == weights.size());
+
+    m_prob.clear();
+    m_alias.clear();
+    m_cdf.clear();
+    m_ids.clear();
+    m_pdfs.clear();
+    m_total= 0;
+
+    // ignore les sources de poids nul, elles ne seront jamais choisies
+    double total= 0;
+    int max_id= -1;
+    for(unsigned i= 0; i < ids.size(); i++)
+    {
+        if(weights[i] <= 0)
+            continue;
+
+        m_ids.push_back(ids[i]);
+        total= total + weights[i];
+        max_id= std::max(max_id, ids[i]);
+    }
+
+    int n= int(m_ids.size());
+    if(n == 0)
+        return 0;
+
+    m_total= float(total);
+
+    // probabilite de chaque source et fonction de repartition
+    std::vector<double> p;
+    p.reserve(n);
+    m_cdf.reserve(n);
+    m_pdfs.assign(max_id +1, 0.f);
+
+    double cumul= 0;
+    for(unsigned i= 0; i < ids.size(); i++)
+    {
+        if(weights[i] <= 0)
+            continue;
+
+        double pi= weights[i] / total;
+        p.push_back(pi);
+        m_pdfs[ids[i]]= float(pi);
+
+        cumul= cumul + pi;
+        m_cdf.push_back(float(cumul));
+    }
+    m_cdf.back()= 1;    // arrondis...
+
+    // table d'alias, cf "Darts, Dice, and Coins", K. Schwarz
+    // https://www.keithschwarz.com/darts-dice-coins/
+    m_prob.assign(n, 1.f);
+    m_alias.resize(n);
+
+    std::vector<double> q(n);
+    std::vector<int> small;
+    std::vector<int> large;
+    small.reserve(n);
+    large.reserve(n);
+    for(int i= 0; i < n; i++)
+    {
+        q[i]= p[i] * n;
+        m_alias[i]= i;
+
+        if(q[i] < 1)
+            small.push_back(i);
+        else
+            large.push_back(i);
+    }
+
+    while(!small.empty() && !large.empty())
+    {
+        int s= small.back(); small.pop_back();
+        int l= large.back(); large.pop_back();
+
+        // complete la case s avec la source l
+        m_prob[s]= float(q[s]);
+        m_alias[s]= l;
+
+        q[l]= (q[l] + q[s]) - 1;
+        if(q[l] < 1)
+            small.push_back(l);
+        else
+            large.push_back(l);
+    }
+    // les cases restantes sont pleines, a cause des arrondis, prob= 1 et alias= i
+
+    return n;
+}
+
+
+LightSample LightSampler::sample( const float u ) const
+{
+    int n= int(m_ids.size());
+    if(n == 0)
+        return { -1, 0 };
+
+    // choisit une case, puis la source de la case ou son alias
+    float x= u * n;
+    int i= std::min(int(x), n -1);
+    float v= x - i;
+
+    int k= (v < m_prob[i]) ? i : m_alias[i];
+    int id= m_ids[k];
+    return { id, m_pdfs[id] };
+}
+
+LightSample LightSampler::sample_cdf( const float u ) const
+{
+    int n= int(m_ids.size());
+    if(n == 0)
+        return { -1, 0 };
+
+    // premiere source telle que u < cdf
+    int k= int(std::upper_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin());
+    k= std::min(k, n -1);
+
+    int id= m_ids[k];
+    return { id, m_pdfs[id] };
+}
@@ -0,0 +1,82 @@
+#ifndef _LIGHT_SAMPLER_H
+#define _LIGHT_SAMPLER_H
+
+#include <vector>
+
+#include "mesh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! choix d'une source de lumiere parmi les triangles emissifs d'un mesh, proportionnellement a leur aire et a leur puissance.
+
+//! source choisie par LightSampler::sample( ).
+struct LightSample
+{
+    int triangle_id;    //!< indice du triangle emissif dans le mesh, -1 si aucune source.
+    float pdf;          //!< probabilite d'avoir choisi ce triangle. la densite d'un point choisi uniformement sur le triangle est pdf / aire du triangle.
+
+    //! renvoie vrai si une source est choisie.
+    operator bool( ) const { return (triangle_id != -1); }
+};
+
+
+/*! choisit les triangles emissifs d'un mesh proportionnellement a aire * puissance emise.
+    sample( ) utilise une table d'alias (Walker / Vose) : temps constant, quel que soit le nombre de sources.
+    sample_cdf( ) utilise une recherche dichotomique dans la fonction de repartition : log(n), mais conserve l'ordre des nombres aleatoires,
+    interessant avec des echantillons stratifies ou des suites a faible discrepance.
+
+    \code
+    LightSampler lights;
+    lights.build(mesh);
+
+    if(LightSample s= lights.sample(u))
+    {
+        const TriangleData& triangle= mesh.triangle(s.triangle_id);
+        ...
+    }
+    \endcode
+ */
+class LightSampler
+{
+public:
+    LightSampler( ) : m_prob(), m_alias(), m_cdf(), m_ids(), m_pdfs(), m_total(0) {}
+
+    //! construit les tables a partir des triangles emissifs du mesh, material.emission != 0. renvoie le nombre de sources.
+    int build( const Mesh& mesh );
+    //! construit les tables pour des sources quelconques, ids[i] est l'indice du triangle, weights[i] son poids. les poids nuls sont ignores. renvoie le nombre de sources.
+    int build( const std::vector<int>& ids, const std::vector<float>& weights );
+
+    //! choisit une source, u est un nombre aleatoire uniforme entre 0 et 1. table d'alias, temps constant.
+    LightSample sample( const float u ) const;
+    //! choisit une source, u est un nombre aleatoire uniforme entre 0 et 1. recherche dans la fonction de repartition.
+    LightSample sample_cdf( const float u ) const;
+
+    //! renvoie la probabilite de choisir le triangle triangle_id, 0 si ce n'est pas une source. meme resultat que LightSample::pdf, cf strategie MIS.
+    float pdf( const int triangle_id ) const
+    {
+        if(triangle_id < 0 || triangle_id >= int(m_pdfs.size()))
+            return 0;
+        return m_pdfs[triangle_id];
+    }
+
+    //! renvoie le nombre de sources.
+    int size( ) const { return int(m_ids.size()); }
+    //! renvoie l'indice du triangle de la source i.
+    int triangle_id( const int i ) const { return m_ids[i]; }
+    //! renvoie la somme des poids des sources.
+    float total( ) const { return m_total; }
+
+protected:
+    std::vector<float> m_prob;      // table d'alias : probabilite de garder la case
+    std::vector<int> m_alias;       // table d'alias : autre source de la case
+    std::vector<float> m_cdf;       // fonction de repartition
+    std::vector<int> m_ids;         // indice des triangles
+    std::vector<float> m_pdfs;      // probabilite de chaque triangle, indexe par triangle_id
+    float m_total;
+};
+
+///@}
+#endif
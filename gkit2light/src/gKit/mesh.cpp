@@ -2,8 +2,13 @@
 #include <cstdio>
 #include <cassert>
 #include <string>
+#include <cstdint>
 #include <algorithm>
 
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
 #include "vec.h"
 #include "mesh.h"
 
@@ -60,6 +65,28 @@ Mesh::Mesh( const GLenum primitives, const std::vector<vec3>& positions,
         m_colors= colors;
 }
 
+Mesh::Mesh( const GLenum primitives, std::vector<vec3>&& positions, std::vector<unsigned>&& indices ) : 
+    m_positions(std::move(positions)), m_texcoords(), m_normals(), m_colors(), m_indices(std::move(indices)), 
+    m_color(White()), m_primitives(primitives), m_vao(0), m_buffer(0), m_index_buffer(0), m_vertex_buffer_size(0), m_index_buffer_size(0), m_update_buffers(true)
+{}
+
+Mesh::Mesh( const GLenum primitives, std::vector<vec3>&& positions, 
+    std::vector<vec2>&& texcoords, 
+    std::vector<vec3>&& normals, 
+    std::vector<vec4>&& colors, 
+    std::vector<unsigned>&& indices ) : 
+        m_positions(std::move(positions)), m_texcoords(), m_normals(), m_colors(), m_indices(std::move(indices)), 
+        m_color(White()), m_primitives(primitives), m_vao(0), m_buffer(0), m_index_buffer(0), m_vertex_buffer_size(0), m_index_buffer_size(0), m_update_buffers(true)
+{
+    // n'initialise les autres attributs que s'ils sont definis
+    if(texcoords.size() > 0 && texcoords.size() == m_positions.size()) 
+        m_texcoords= std::move(texcoords);
+    if(normals.size() > 0 && normals.size() == m_positions.size())
+        m_normals= std::move(normals);
+    if(colors.size() > 0 && colors.size() == m_positions.size())
+        m_colors= std::move(colors);
+}
+
 
 void Mesh::release( )
 {
@@ -175,6 +202,92 @@ void Mesh::vertex( const unsigned int id, const vec3& p )
     m_positions[id]= p;
 }
 
+// insere des blocs de sommets / d'indices
+Mesh& Mesh::reserve( const int vertex_count, const int index_count, const bool use_texcoord, const bool use_normal, const bool use_color )
+{
+    m_positions.reserve(vertex_count);
+    if(use_texcoord) m_texcoords.reserve(vertex_count);
+    if(use_normal) m_normals.reserve(vertex_count);
+    if(use_color) m_colors.reserve(vertex_count);
+    
+    m_indices.reserve(index_count);
+    if(m_primitives == GL_TRIANGLES)
+        m_triangle_materials.reserve((index_count > 0 ? index_count : vertex_count) / 3);
+    return *this;
+}
+
+// complete un attribut pour les sommets [0 n) : valeur par defaut pour les sommets precedents, puis les valeurs de data, ou la derniere valeur
+template < typename T >
+static void append_attribute( std::vector<T>& attribute, const size_t first, const int n, const T *data )
+{
+    if(data == nullptr)
+    {
+        if(attribute.size() > 0 && attribute.size() == first)
+            attribute.resize(first + n, attribute.back());
+        return;
+    }
+    
+    if(attribute.size() < first)
+        attribute.resize(first, T());
+    attribute.resize(first);
+    attribute.insert(attribute.end(), data, data + n);
+}
+
+unsigned int Mesh::vertices( const int n, const vec3 *positions, const vec2 *texcoords, const vec3 *normals, const vec4 *colors )
+{
+    unsigned int first= m_positions.size();
+    if(n <= 0)
+        return first;
+    
+    m_update_buffers= true;
+    append_attribute(m_texcoords, first, n, texcoords);
+    append_attribute(m_normals, first, n, normals);
+    append_attribute(m_colors, first, n, colors);
+    m_positions.insert(m_positions.end(), positions, positions + n);
+    
+    // copie la matiere courante, uniquement si elle est definie
+    if(m_triangle_materials.size() > 0 && int(m_triangle_materials.size()) < triangle_count())
+        m_triangle_materials.resize(triangle_count(), m_triangle_materials.back());
+    
+    // construction de l'index buffer pour les strip
+    switch(m_primitives)
+    {
+        case GL_LINE_STRIP:
+        case GL_LINE_LOOP:
+        case GL_TRIANGLE_STRIP:
+        case GL_TRIANGLE_FAN:
+            for(int i= 0; i < n; i++)
+                m_indices.push_back(first + i);
+            break;
+        default:
+            break;
+    }
+    
+    return first;
+}
+
+Mesh& Mesh::indices( const int n, const unsigned int *indices )
+{
+    if(n <= 0)
+        return *this;
+    
+    m_update_buffers= true;
+    m_indices.insert(m_indices.end(), indices, indices + n);
+    
+    // copie la matiere courante, uniquement si elle est definie
+    if(m_triangle_materials.size() > 0 && int(m_triangle_materials.size()) < triangle_count())
+        m_triangle_materials.resize(triangle_count(), m_triangle_materials.back());
+    return *this;
+}
+
+Mesh& Mesh::indices( std::vector<unsigned int>&& indices )
+{
+    m_update_buffers= true;
+    m_indices= std::move(indices);
+    return *this;
+}
+
+
 void Mesh::clear( )
 {
     m_update_buffers= true;
@@ -289,6 +402,21 @@ const std::vector<unsigned int>& Mesh::material_indices( ) const
     return m_triangle_materials;
 }
 
+Mesh& Mesh::material_indices( const int n, const unsigned int *ids )
+{
+    if(n > 0)
+        m_triangle_materials.insert(m_triangle_materials.end(), ids, ids + n);
+    m_update_buffers= true;
+    return *this;
+}
+
+Mesh& Mesh::material_indices( std::vector<unsigned int>&& ids )
+{
+    m_triangle_materials= std::move(ids);
+    m_update_buffers= true;
+    return *this;
+}
+
 int Mesh::triangle_material_index( const unsigned int id ) const
 {
     assert((size_t) id < m_triangle_materials.size());
@@ -307,6 +435,71 @@ std::vector<TriangleGroup> Mesh::groups( )
     return groups(m_triangle_materials);
 }
 
+// copie les sommets des triangles dans l'ordre de remap.
+template < typename T >
+static
+void scatter_triangles( const std::vector<int>& remap, std::vector<T>& attribute )
+{
+    const int n= int(remap.size());
+    std::vector<T> tmp(3*n);
+    #pragma omp parallel for
+    for(int i= 0; i < n; i++)
+    {
+        tmp[3*i]= attribute[3*remap[i]];
+        tmp[3*i+1]= attribute[3*remap[i]+1];
+        tmp[3*i+2]= attribute[3*remap[i]+2];
+    }
+    
+    std::swap(attribute, tmp);
+}
+
+// une passe du tri des triangles par propriete : tri par denombrement, sur 16 bits de (propriete - kmin), a partir du bit shift.
+// chaque thread compte les cles d'un bloc contigu de triangles, les places sont distribuees par valeur, puis par bloc, dans l'ordre : le tri est stable.
+static
+void sort_triangles_pass( const std::vector<unsigned int>& keys, const unsigned int kmin, const int shift, const int buckets,
+    const std::vector<int>& in, std::vector<int>& out, std::vector<int>& counts )
+{
+    const int n= int(in.size());
+    int threads= 1;
+#ifdef _OPENMP
+    if(n >= 65536)
+        threads= omp_get_max_threads();
+#endif
+    counts.assign(size_t(threads) * buckets, 0);
+    
+    #pragma omp parallel num_threads(threads)
+    {
+        int thread= 0;
+        int count_threads= 1;
+    #ifdef _OPENMP
+        thread= omp_get_thread_num();
+        count_threads= omp_get_num_threads();
+    #endif
+        int begin= int(int64_t(n) * thread / count_threads);
+        int end= int(int64_t(n) * (thread +1) / count_threads);
+        int *count= counts.data() + size_t(thread) * buckets;
+        
+        for(int i= begin; i < end; i++)
+            count[((keys[in[i]] - kmin) >> shift) & 0xffff]++;
+        
+        #pragma omp barrier
+        #pragma omp single
+        {
+            int offset= 0;
+            for(int b= 0; b < buckets; b++)
+            for(int t= 0; t < count_threads; t++)
+            {
+                int c= counts[size_t(t) * buckets + b];
+                counts[size_t(t) * buckets + b]= offset;
+                offset+= c;
+            }
+        }
+        
+        for(int i= begin; i < end; i++)
+            out[count[((keys[in[i]] - kmin) >> shift) & 0xffff]++]= in[i];
+    }
+}
+
 std::vector<TriangleGroup> Mesh::groups( const std::vector<unsigned int>& triangle_properties )
 {
     if(m_primitives != GL_TRIANGLES)
@@ -321,114 +514,93 @@ std::vector<TriangleGroup> Mesh::groups( const std::vector<unsigned int>& triang
             return { {0, 0, int(m_positions.size())} };
     }
     
-    // trie les triangles
-    std::vector<int> remap(triangle_count());
-    for(unsigned i= 0; i < remap.size(); i++)
+    // trie les triangles, tri stable par denombrement, en O(n), cf sort_triangles_pass( ).
+    // 1 passe si les proprietes sont comprises dans un intervalle de 2^16 valeurs, 2 passes sinon (radix sort).
+    const int n= triangle_count();
+    unsigned int kmin= triangle_properties[0];
+    unsigned int kmax= triangle_properties[0];
+    for(int i= 0; i < n; i++)
+    {
+        kmin= std::min(kmin, triangle_properties[i]);
+        kmax= std::max(kmax, triangle_properties[i]);
+    }
+    
+    std::vector<int> remap(n);
+    for(int i= 0; i < n; i++)
         remap[i]= i;
-
-    struct triangle_sort
+    
+    if(kmin != kmax)
     {
-        const std::vector<unsigned int>& properties;
-        
-        triangle_sort( const std::vector<unsigned int>& _properties ) : properties(_properties) {}
-        
-        bool operator() ( const int& a, const int& b ) const
+        std::vector<int> tmp(n);
+        std::vector<int> counts;
+        const unsigned int range= kmax - kmin;
+        for(int shift= 0; shift < 32 && (range >> shift) > 0; shift+= 16)
         {
-            return properties[a] < properties[b];
+            int buckets= int(std::min(range >> shift, 0xffffu)) +1;
+            sort_triangles_pass(triangle_properties, kmin, shift, buckets, remap, tmp, counts);
+            std::swap(remap, tmp);
         }
-    };
-    
-    std::stable_sort(remap.begin(), remap.end(), triangle_sort(triangle_properties));
+    }
     
-    // re-organise les triangles, et construit les groupes
+    // construit les groupes
     std::vector<TriangleGroup> groups;
-    if(m_indices.size())
     {
         int first= 0;
         int property_id= triangle_properties[remap[0]];
-        
-        // re-organise l'index buffer...
-        std::vector<unsigned int> indices;
-        std::vector<unsigned int> material_indices;
-        for(unsigned i= 0; i < remap.size(); i++)
+        for(int i= 0; i < n; i++)
         {
             int id= triangle_properties[remap[i]];
             if(id != property_id)
             {
-                groups.push_back( {property_id, first, int(3*i) - first} );
+                groups.push_back( {property_id, first, 3*i - first} );
                 first= 3*i;
                 property_id= id;
             }
-            
-            indices.push_back(m_indices[3*remap[i]]);
-            indices.push_back(m_indices[3*remap[i]+1]);
-            indices.push_back(m_indices[3*remap[i]+2]);
-            
-            material_indices.push_back(m_triangle_materials[remap[i]]);
         }
         
         // dernier groupe
-        groups.push_back( {property_id, first, int(3 * remap.size()) - first} );
+        groups.push_back( {property_id, first, 3*n - first} );
+    }
+    
+    // re-organise les triangles, chaque attribut est copie en parallele
+    std::vector<unsigned int> material_indices;
+    if(has_material_index())
+    {
+        material_indices.resize(n);
+        #pragma omp parallel for
+        for(int i= 0; i < n; i++)
+            material_indices[i]= m_triangle_materials[remap[i]];
+    }
+    
+    if(m_indices.size())
+    {
+        // re-organise l'index buffer...
+        std::vector<unsigned int> indices(3*n);
+        #pragma omp parallel for
+        for(int i= 0; i < n; i++)
+        {
+            indices[3*i]= m_indices[3*remap[i]];
+            indices[3*i+1]= m_indices[3*remap[i]+1];
+            indices[3*i+2]= m_indices[3*remap[i]+2];
+        }
         
         std::swap(m_indices, indices);
-        std::swap(m_triangle_materials, material_indices);
     }
     else
     {
-        int first= 0;
-        int property_id= triangle_properties[remap[0]];
-        
         // re-organise les attributs !!
-        std::vector<vec3> positions;
-        std::vector<vec2> texcoords;
-        std::vector<vec3> normals;
-        std::vector<vec4> colors;
-        std::vector<unsigned int> material_indices;
-        for(unsigned i= 0; i < remap.size(); i++)
-        {
-            int id= triangle_properties[remap[i]];
-            if(id != property_id)
-            {
-                groups.push_back( {property_id, first, int(3*i) - first} );
-                first= 3*i;
-                property_id= id;
-            }
-            
-            positions.push_back(m_positions[3*remap[i]]);
-            positions.push_back(m_positions[3*remap[i]+1]);
-            positions.push_back(m_positions[3*remap[i]+2]);
-            if(has_texcoord())
-            {
-                texcoords.push_back(m_texcoords[3*remap[i]]);
-                texcoords.push_back(m_texcoords[3*remap[i]+1]);
-                texcoords.push_back(m_texcoords[3*remap[i]+2]);
-            }
-            if(has_normal())
-            {
-                normals.push_back(m_normals[3*remap[i]]);
-                normals.push_back(m_normals[3*remap[i]+1]);
-                normals.push_back(m_normals[3*remap[i]+2]);
-            }
-            if(has_color())
-            {
-                colors.push_back(m_colors[3*remap[i]]);
-                colors.push_back(m_colors[3*remap[i]+1]);
-                colors.push_back(m_colors[3*remap[i]+2]);
-            }
-            
-            material_indices.push_back(m_triangle_materials[remap[i]]);
-        }
-        
-        // dernier groupe
-        groups.push_back( {property_id, first, int(3 * remap.size()) - first} );
-        
-        std::swap(m_positions, positions);
-        std::swap(m_texcoords, texcoords);
-        std::swap(m_normals, normals);
-        std::swap(m_colors, colors);
-        std::swap(m_triangle_materials, material_indices);
+        scatter_triangles(remap, m_positions);
+        if(has_texcoord())
+            scatter_triangles(remap, m_texcoords);
+        if(has_normal())
+            scatter_triangles(remap, m_normals);
+        if(has_color())
+            scatter_triangles(remap, m_colors);
     }
     
+    if(has_material_index())
+        std::swap(m_triangle_materials, material_indices);
+    
     return groups;
 }
 
@@ -135,6 +135,22 @@ public:
         const std::vector<vec4>& colors, 
         const std::vector<unsigned>& indices );
     
+    /*! constructeur. a partir d'un ensemble de positions indexees, deplacees dans le mesh, sans copie.
+    \code
+    std::vector<vec3> positions;
+    std::vector<unsigned> indices;
+    ...
+    Mesh mesh(GL_TRIANGLES, std::move(positions), std::move(indices));
+    \endcode
+    */
+    Mesh( const GLenum primitives, std::vector<vec3>&& positions, std::vector<unsigned>&& indices );
+    //! constructeur. a partir d'un ensemble de positions + attributs indexes, deplaces dans le mesh, sans copie. les attributs qui ne sont pas definis pour tous les sommets sont ignores.
+    Mesh( const GLenum primitives, std::vector<vec3>&& positions, 
+        std::vector<vec2>&& texcoords, 
+        std::vector<vec3>&& normals, 
+        std::vector<vec4>&& colors, 
+        std::vector<unsigned>&& indices );
+    
     //! detruit les objets openGL.
     void release( );
     //@}
@@ -243,6 +259,27 @@ public:
     void vertex( const unsigned int id, const float x, const float y, const float z ) { vertex(id, vec3(x, y, z)); }
     //@}
     
+    //! \name construction par blocs, sans inserer les sommets un par un.
+    //@{
+    //! reserve la place pour vertex_count sommets, index_count indices et les attributs utilises, evite de re-allouer les tableaux pendant la construction.
+    Mesh& reserve( const int vertex_count, const int index_count= 0, const bool use_texcoord= false, const bool use_normal= false, const bool use_color= false );
+    
+    /*! insere n sommets et leurs attributs, si les tableaux ne sont pas nuls. renvoie l'indice du premier sommet.
+    un attribut absent est complete avec la derniere valeur, comme vertex( ), un nouvel attribut est complete avec une valeur par defaut pour les sommets precedents.
+    \code
+    Mesh mesh(GL_TRIANGLES);
+    mesh.reserve(positions.size(), indices.size(), true, true);
+    unsigned first= mesh.vertices(positions.size(), positions.data(), texcoords.data(), normals.data());
+    mesh.indices(indices.size(), indices.data());
+    \endcode
+    */
+    unsigned int vertices( const int n, const vec3 *positions, const vec2 *texcoords= nullptr, const vec3 *normals= nullptr, const vec4 *colors= nullptr );
+    //! ajoute n indices de sommets, cf index( ).
+    Mesh& indices( const int n, const unsigned int *indices );
+    //! remplace l'index buffer, deplace dans le mesh, sans copie.
+    Mesh& indices( std::vector<unsigned int>&& indices );
+    //@}
+    
     //! \name description des matieres.
     //@{
     //! renvoie la description des matieres.
@@ -254,6 +291,10 @@ public:
     
     //! renvoie les indices des matieres des triangles.
     const std::vector<unsigned int>& material_indices( ) const;
+    //! ajoute les matieres de n triangles, cf material( ).
+    Mesh& material_indices( const int n, const unsigned int *ids );
+    //! remplace les matieres des triangles, deplacees dans le mesh, sans copie.
+    Mesh& material_indices( std::vector<unsigned int>&& ids );
     
     //! definit la matiere du prochain triangle. id est l'indice d'une matiere ajoutee dans materials(), cf la classe Materials. ne fonctionne que pour les primitives GL_TRIANGLES, indexees ou pas.
     Mesh& material( const unsigned int id );
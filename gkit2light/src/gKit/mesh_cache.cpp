@@ -0,0 +1,432 @@
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <type_traits>
+
+#include "files.h"
+#include "wavefront_parallel.h"
+#include "mesh_cache.h"
+
+
+namespace {
+
+const char cache_magic[8]= { 'g', 'k', 'm', 'e', 's', 'h', 0, 2 };     // 'gkmesh' + version
+
+// entete du cache, suivi des dependances, des matieres, des attributs et des groupes, alignes sur 16 octets.
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t primitives;
+    uint32_t positions;
+    uint32_t texcoords;
+    uint32_t normals;
+    uint32_t colors;
+    uint32_t indices;
+    uint32_t triangle_materials;
+    uint32_t dependencies;
+    uint32_t materials;
+    uint32_t textures;
+    uint32_t groups;
+    int32_t default_material;
+    float color[4];
+};
+
+static_assert(std::is_trivially_copyable<Material>::value, "Material is copied as raw bytes");
+static_assert(std::is_trivially_copyable<TriangleGroup>::value, "TriangleGroup is copied as raw bytes");
+static_assert(sizeof(vec3) == 3*sizeof(float) && sizeof(vec2) == 2*sizeof(float) && sizeof(vec4) == 4*sizeof(float), "attributes are copied as raw bytes");
+
+
+// construit le contenu du cache
+struct Writer
+{
+    std::vector<char> data;
+
+    void write( const void *p, const size_t size )
+    {
+        data.insert(data.end(), (const char *) p, (const char *) p + size);
+    }
+
+    void write( const std::string& s )
+    {
+        uint32_t length= uint32_t(s.size());
+        write(&length, sizeof(length));
+        write(s.data(), s.size());
+    }
+
+    template < typename T >
+    void write_array( const std::vector<T>& v )
+    {
+        // aligne le debut du tableau
+        data.resize((data.size() + 15) & ~size_t(15), 0);
+        if(!v.empty())
+            write(v.data(), v.size() * sizeof(T));
+    }
+};
+
+// relit le contenu du cache, verifie qu'il ne deborde pas
+struct Reader
+{
+    const char *begin;
+    const char *end;
+    const char *p;
+    bool error;
+
+    Reader( const char *_begin, const size_t size ) : begin(_begin), end(_begin + size), p(_begin), error(false) {}
+
+    bool read( void *data, const size_t size )
+    {
+        if(error || size_t(end - p) < size)
+        {
+            error= true;
+            return false;
+        }
+
+        memcpy(data, p, size);
+        p+= size;
+        return true;
+    }
+
+    std::string read_string( )
+    {
+        uint32_t length= 0;
+        if(!read(&length, sizeof(length)) || size_t(end - p) < length)
+        {
+            error= true;
+            return std::string();
+        }
+
+        std::string s(p, p + length);
+        p+= length;
+        return s;
+    }
+
+    // copie un tableau, en une fois
+    template < typename T >
+    void read_array( std::vector<T>& v, const size_t n )
+    {
+        p= begin + ((p - begin + 15) & ~size_t(15));
+        if(error || p > end || size_t(end - p) / sizeof(T) < n)
+        {
+            error= true;
+            return;
+        }
+
+        v.resize(n);
+        if(n > 0)
+            memcpy(v.data(), p, n * sizeof(T));
+        p+= n * sizeof(T);
+    }
+};
+
+
+// fichiers de matieres utilises par un fichier .obj, cf read_mesh( )
+std::vector<std::string> materials_filenames( const char *filename )
+{
+    std::vector<std::string> filenames;
+
+    MappedFile file;
+    if(file.open(filename) < 0)
+        return filenames;
+
+    const char *line= file.data();
+    const char *end= file.data() + file.size();
+    while(line < end)
+    {
+        const char *eol= (const char *) memchr(line, '\n', end - line);
+        if(eol == nullptr)
+            eol= end;
+
+        const char *p= line;
+        while(p < eol && (*p == ' ' || *p == '\t'))
+            p++;
+
+        if(eol - p > 6 && strncmp(p, "mtllib", 6) == 0)
+        {
+            p+= 6;
+            while(p < eol && (*p == ' ' || *p == '\t'))
+                p++;
+
+            const char *e= p;
+            while(e < eol && *e != '\r')
+                e++;
+
+            std::string name(p, e);
+            if(!name.empty())
+            {
+                if(name[0] != '/' && name[1] != ':')   // windows c:\ pour les chemins complets...
+                    filenames.push_back(normalize_filename(pathname(filename) + name));
+                else
+                    filenames.push_back(name);
+            }
+        }
+
+        line= eol +1;
+    }
+
+    return filenames;
+}
+
+}   // namespace
+
+
+std::string mesh_cache_filename( const std::string& filename )
+{
+    return filename + ".mesh";
+}
+
+std::string mesh_cache_filename( const std::string& filename, const std::string& variant )
+{
+    return filename + "." + variant + ".mesh";
+}
+
+
+int write_mesh_cache( const std::string& cache_filename, const Mesh& mesh, const std::vector<std::string>& dependencies )
+{
+    return write_mesh_cache(cache_filename, mesh, std::vector<TriangleGroup>(), dependencies);
+}
+
+int write_mesh_cache( const std::string& cache_filename, const Mesh& mesh, const std::vector<TriangleGroup>& groups, const std::vector<std::string>& dependencies )
+{
+    const Materials& materials= mesh.materials();
+
+    CacheHeader header;
+    memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.primitives= uint32_t(mesh.primitives());
+    header.positions= uint32_t(mesh.positions().size());
+    header.texcoords= uint32_t(mesh.texcoords().size());
+    header.normals= uint32_t(mesh.normals().size());
+    header.colors= uint32_t(mesh.colors().size());
+    header.indices= uint32_t(mesh.indices().size());
+    header.triangle_materials= uint32_t(mesh.material_indices().size());
+    header.dependencies= uint32_t(dependencies.size());
+    header.materials= uint32_t(materials.count());
+    header.textures= uint32_t(materials.filename_count());
+    header.groups= uint32_t(groups.size());
+    header.default_material= materials.default_material_id;
+    Color color= mesh.default_color();
+    header.color[0]= color.r;
+    header.color[1]= color.g;
+    header.color[2]= color.b;
+    header.color[3]= color.a;
+
+    Writer writer;
+    writer.write(&header, sizeof(header));
+
+    // date de modification des fichiers utilises pour construire le mesh
+    for(unsigned i= 0; i < dependencies.size(); i++)
+    {
+        uint64_t time= timestamp(dependencies[i]);
+        writer.write(&time, sizeof(time));
+        writer.write(dependencies[i]);
+    }
+
+    // matieres et textures
+    for(int i= 0; i < materials.count(); i++)
+        writer.write(materials.names[i]);
+    for(int i= 0; i < materials.filename_count(); i++)
+        writer.write(materials.texture_filenames[i]);
+    writer.write_array(materials.materials);
+
+    // attributs
+    writer.write_array(mesh.positions());
+    writer.write_array(mesh.texcoords());
+    writer.write_array(mesh.normals());
+    writer.write_array(mesh.colors());
+    writer.write_array(mesh.indices());
+    writer.write_array(mesh.material_indices());
+    writer.write_array(groups);
+
+    // ecrit un fichier temporaire, puis le renomme : un autre processus ne peut pas lire un cache incomplet
+    std::string tmp= cache_filename + ".tmp";
+    FILE *out= fopen(tmp.c_str(), "wb");
+    if(out == nullptr)
+    {
+        printf("[error] writing mesh cache '%s'...\n", cache_filename.c_str());
+        return -1;
+    }
+
+    bool error= (fwrite(writer.data.data(), 1, writer.data.size(), out) != writer.data.size());
+    error= (fclose(out) != 0) || error;
+    if(error || std::rename(tmp.c_str(), cache_filename.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        printf("[error] writing mesh cache '%s'...\n", cache_filename.c_str());
+        return -1;
+    }
+
+    printf("writing mesh cache '%s': %d KB\n", cache_filename.c_str(), int(writer.data.size() / 1024));
+    return 0;
+}
+
+
+Mesh read_mesh_cache_file( const std::string& cache_filename )
+{
+    std::vector<TriangleGroup> groups;
+    return read_mesh_cache_file(cache_filename, groups);
+}
+
+Mesh read_mesh_cache_file( const std::string& cache_filename, std::vector<TriangleGroup>& groups )
+{
+    groups.clear();
+
+    MappedFile file;
+    if(file.open(cache_filename) < 0)
+        return Mesh();
+
+    Reader reader(file.data(), file.size());
+    CacheHeader header;
+    if(!reader.read(&header, sizeof(header)) || memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0)
+    {
+        printf("[error] mesh cache '%s': bad format...\n", cache_filename.c_str());
+        return Mesh();
+    }
+
+    // verifie que les fichiers utilises pour construire le mesh n'ont pas change
+    for(unsigned i= 0; i < header.dependencies; i++)
+    {
+        uint64_t time= 0;
+        reader.read(&time, sizeof(time));
+        std::string filename= reader.read_string();
+        if(reader.error)
+            break;
+
+        if(timestamp(filename) != time)
+        {
+            printf("mesh cache '%s': '%s' was modified...\n", cache_filename.c_str(), filename.c_str());
+            return Mesh();
+        }
+    }
+
+    Materials materials;
+    for(unsigned i= 0; i < header.materials; i++)
+        materials.names.push_back(reader.read_string());
+    for(unsigned i= 0; i < header.textures; i++)
+        materials.texture_filenames.push_back(reader.read_string());
+    reader.read_array(materials.materials, header.materials);
+    materials.default_material_id= header.default_material;
+
+    std::vector<vec3> positions;
+    std::vector<vec2> texcoords;
+    std::vector<vec3> normals;
+    std::vector<vec4> colors;
+    std::vector<unsigned> indices;
+    std::vector<unsigned> triangle_materials;
+    reader.read_array(positions, header.positions);
+    reader.read_array(texcoords, header.texcoords);
+    reader.read_array(normals, header.normals);
+    reader.read_array(colors, header.colors);
+    reader.read_array(indices, header.indices);
+    reader.read_array(triangle_materials, header.triangle_materials);
+    reader.read_array(groups, header.groups);
+
+    if(reader.error || (header.default_material >= int(header.materials)))
+    {
+        printf("[error] mesh cache '%s': truncated file...\n", cache_filename.c_str());
+        return Mesh();
+    }
+
+    for(unsigned i= 0; i < triangle_materials.size(); i++)
+        if(triangle_materials[i] >= header.materials)
+        {
+            printf("[error] mesh cache '%s': bad material index...\n", cache_filename.c_str());
+            return Mesh();
+        }
+
+    // les groupes designent des indices, ou des sommets si le mesh n'est pas indexe
+    unsigned count= header.indices ? header.indices : header.positions;
+    for(unsigned i= 0; i < groups.size(); i++)
+        if(groups[i].first < 0 || groups[i].n < 0 || unsigned(groups[i].first) + unsigned(groups[i].n) > count)
+        {
+            printf("[error] mesh cache '%s': bad group...\n", cache_filename.c_str());
+            groups.clear();
+            return Mesh();
+        }
+
+    Mesh mesh(GLenum(header.primitives), std::move(positions), std::move(texcoords), std::move(normals), std::move(colors), std::move(indices));
+    mesh.default_color(Color(header.color[0], header.color[1], header.color[2], header.color[3]));
+    mesh.materials(materials);
+    mesh.material_indices(std::move(triangle_materials));
+
+    return mesh;
+}
+
+
+Mesh read_mesh_cache( const char *filename )
+{
+    std::string cache_filename= mesh_cache_filename(filename);
+    if(exists(cache_filename) && timestamp(cache_filename) >= timestamp(filename))
+    {
+        auto start= std::chrono::high_resolution_clock::now();
+        Mesh mesh= read_mesh_cache_file(cache_filename);
+        auto stop= std::chrono::high_resolution_clock::now();
+
+        if(mesh.vertex_count() > 0)
+        {
+            int ms= int(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+            printf("mesh '%s': cache '%s' %dms, %d positions %s %s\n", filename, cache_filename.c_str(), ms,
+                mesh.vertex_count(), mesh.has_texcoord() ? "texcoord" : "", mesh.has_normal() ? "normal" : "");
+            return mesh;
+        }
+    }
+
+    // pas de cache, ou cache perime : charge le fichier .obj et reconstruit le cache
+    Mesh mesh= read_mesh_parallel(filename);
+    if(mesh.vertex_count() == 0)
+        return mesh;
+
+    std::vector<std::string> dependencies;
+    dependencies.push_back(filename);
+    std::vector<std::string> mtl= materials_filenames(filename);
+    dependencies.insert(dependencies.end(), mtl.begin(), mtl.end());
+
+    write_mesh_cache(cache_filename, mesh, dependencies);
+    return mesh;
+}
+
+
+Mesh read_mesh_cache( const char *filename, const std::string& variant, std::vector<TriangleGroup>& groups, const std::function<Mesh (Mesh&, std::vector<TriangleGroup>&)>& build )
+{
+    std::string cache_filename= mesh_cache_filename(filename, variant);
+    if(exists(cache_filename) && timestamp(cache_filename) >= timestamp(filename))
+    {
+        auto start= std::chrono::high_resolution_clock::now();
+        Mesh mesh= read_mesh_cache_file(cache_filename, groups);
+        auto stop= std::chrono::high_resolution_clock::now();
+
+        if(mesh.vertex_count() > 0)
+        {
+            int ms= int(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+            printf("mesh '%s': cache '%s' %dms, %d positions, %d groups\n", filename, cache_filename.c_str(), ms, mesh.vertex_count(), int(groups.size()));
+            return mesh;
+        }
+    }
+
+    // pas de cache, ou cache perime : construit la variante a partir du mesh, et l'ecrit avec ses groupes
+    groups.clear();
+    Mesh source= read_mesh_cache(filename);
+    if(source.vertex_count() == 0)
+        return source;
+
+    auto start= std::chrono::high_resolution_clock::now();
+    Mesh mesh= build(source, groups);
+    auto stop= std::chrono::high_resolution_clock::now();
+    source.release();
+    if(mesh.vertex_count() == 0)
+        return mesh;
+
+    int ms= int(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+    printf("mesh '%s': variant '%s' %dms\n", filename, variant.c_str(), ms);
+
+    std::vector<std::string> dependencies;
+    dependencies.push_back(filename);
+    std::vector<std::string> mtl= materials_filenames(filename);
+    dependencies.insert(dependencies.end(), mtl.begin(), mtl.end());
+
+    write_mesh_cache(cache_filename, mesh, groups, dependencies);
+    return mesh;
+}
@@ -0,0 +1,58 @@
+
+#ifndef _MESH_CACHE_H
+#define _MESH_CACHE_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "mesh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! cache binaire des fichiers wavefront .obj : evite d'analyser le fichier texte (et les matieres) a chaque execution.
+
+/*! charge un fichier wavefront .obj, en utilisant le cache binaire s'il existe et s'il est a jour, cf mesh_cache_filename( ).
+    sinon charge le fichier avec read_mesh_parallel( ) et ecrit le cache, qui sera utilise par les prochaines executions.
+    le cache est invalide si la date de modification du fichier .obj ou d'un fichier de matieres .mtl a change, cf timestamp( ).
+
+    le resultat est identique a read_mesh( ) : triangles non indexes, matieres et textures. a detruire avec Mesh::release( ).
+ */
+Mesh read_mesh_cache( const char *filename );
+
+/*! charge une variante d'un fichier wavefront .obj, construite par build( ) : mesh indexe et optimise, par exemple, avec ses groupes de triangles.
+    utilise le cache binaire de la variante s'il existe et s'il est a jour, cf mesh_cache_filename(filename, variant). sinon charge le fichier avec read_mesh_cache( ),
+    appelle build(mesh, groups) et ecrit le cache de la variante, avec les groupes. variant doit changer avec les parametres de build( ).
+
+    \code
+    std::vector<TriangleGroup> groups;
+    Mesh mesh= read_mesh_cache("data/rungholt/rungholt.obj", "optimized", groups,
+        []( Mesh& mesh, std::vector<TriangleGroup>& groups ) { groups= mesh.groups(); return optimize_mesh(mesh, groups); } );
+    \endcode
+ */
+Mesh read_mesh_cache( const char *filename, const std::string& variant, std::vector<TriangleGroup>& groups, const std::function<Mesh (Mesh&, std::vector<TriangleGroup>&)>& build );
+
+//! renvoie le nom du cache binaire d'un fichier .obj, dans le meme repertoire : "data/cornell.obj" -> "data/cornell.obj.mesh".
+std::string mesh_cache_filename( const std::string& filename );
+//! renvoie le nom du cache binaire d'une variante d'un fichier .obj : "data/cornell.obj", "optimized" -> "data/cornell.obj.optimized.mesh".
+std::string mesh_cache_filename( const std::string& filename, const std::string& variant );
+
+/*! ecrit le cache binaire d'un mesh. dependencies, les fichiers utilises pour construire le mesh (le .obj et ses .mtl), leur date de modification est conservee dans le cache.
+    renvoie -1 en cas d'erreur.
+ */
+int write_mesh_cache( const std::string& cache_filename, const Mesh& mesh, const std::vector<std::string>& dependencies );
+//! ecrit le cache binaire d'un mesh et de ses groupes de triangles, cf Mesh::groups( ). renvoie -1 en cas d'erreur.
+int write_mesh_cache( const std::string& cache_filename, const Mesh& mesh, const std::vector<TriangleGroup>& groups, const std::vector<std::string>& dependencies );
+
+/*! relit un cache binaire, ecrit par write_mesh_cache( ). le fichier est projete en memoire, chaque attribut est copie en une seule fois.
+    renvoie un mesh vide si le cache n'existe pas, s'il est incorrect ou si une de ses dependances a ete modifiee.
+ */
+Mesh read_mesh_cache_file( const std::string& cache_filename );
+//! relit un cache binaire et ses groupes de triangles, ecrit par write_mesh_cache( ). groups est vide si le cache ne contient pas de groupes.
+Mesh read_mesh_cache_file( const std::string& cache_filename, std::vector<TriangleGroup>& groups );
+
+///@}
+#endif
@@ -0,0 +1,424 @@
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include "vec.h"
+#include "mesh_optimize.h"
+
+
+VertexCacheStats vertex_cache_stats( const std::vector<unsigned>& indices, const int vertex_count, const int cache_size )
+{
+    // cache fifo : un sommet est dans le cache s'il a ete transforme parmi les cache_size derniers sommets transformes
+    std::vector<int> cache_time(vertex_count, -cache_size -1);
+    int time= 0;
+    for(unsigned i= 0; i < indices.size(); i++)
+    {
+        unsigned v= indices[i];
+        if(time - cache_time[v] > cache_size)
+        {
+            cache_time[v]= time;
+            time++;
+        }
+    }
+
+    VertexCacheStats stats;
+    stats.transformed= time;
+    stats.acmr= indices.size() ? float(time) / float(indices.size() / 3) : 0;
+    stats.atvr= vertex_count ? float(time) / float(vertex_count) : 0;
+    return stats;
+}
+
+
+std::vector<int> optimize_vertex_cache( const unsigned *indices, const int triangle_count, const int cache_size, std::vector<int>& clusters )
+{
+    std::vector<int> order;
+    clusters.clear();
+    if(triangle_count == 0)
+        return order;
+
+    // numerote les sommets des triangles, de 0 a vertex_count
+    std::vector<unsigned> vertices(indices, indices + 3*triangle_count);
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    int vertex_count= int(vertices.size());
+
+    std::vector<int> triangles(3*triangle_count);
+    for(int i= 0; i < 3*triangle_count; i++)
+        triangles[i]= int(std::lower_bound(vertices.begin(), vertices.end(), indices[i]) - vertices.begin());
+
+    // triangles adjacents a chaque sommet, et nombre de triangles pas encore places
+    std::vector<int> live(vertex_count, 0);
+    for(int i= 0; i < 3*triangle_count; i++)
+        live[triangles[i]]++;
+
+    std::vector<int> offsets(vertex_count +1, 0);
+    for(int v= 0; v < vertex_count; v++)
+        offsets[v+1]= offsets[v] + live[v];
+
+    std::vector<int> adjacency(3*triangle_count);
+    {
+        std::vector<int> next(offsets.begin(), offsets.end() -1);
+        for(int i= 0; i < 3*triangle_count; i++)
+            adjacency[next[triangles[i]]++]= i / 3;
+    }
+
+    std::vector<int> cache_time(vertex_count, 0);
+    std::vector<char> emitted(triangle_count, 0);
+    std::vector<int> dead_end;
+    std::vector<int> candidates;
+    order.reserve(triangle_count);
+
+    int time= cache_size +1;
+    int cursor= 0;
+    int fan= 0;         // place les triangles autour de ce sommet
+    clusters.push_back(0);
+    while(fan >= 0)
+    {
+        candidates.clear();
+        for(int i= offsets[fan]; i < offsets[fan+1]; i++)
+        {
+            int t= adjacency[i];
+            if(emitted[t])
+                continue;
+
+            emitted[t]= 1;
+            order.push_back(t);
+            for(int k= 0; k < 3; k++)
+            {
+                int v= triangles[3*t + k];
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+
+                if(time - cache_time[v] > cache_size)
+                {
+                    cache_time[v]= time;
+                    time++;
+                }
+            }
+        }
+
+        // prochain sommet : le plus ancien dans le cache qui y sera encore apres avoir place ses triangles
+        int next= -1;
+        int next_priority= -1;
+        for(unsigned i= 0; i < candidates.size(); i++)
+        {
+            int v= candidates[i];
+            if(live[v] == 0)
+                continue;
+
+            int priority= 0;
+            if(time - cache_time[v] + 2*live[v] <= cache_size)
+                priority= time - cache_time[v];
+
+            if(priority > next_priority)
+            {
+                next_priority= priority;
+                next= v;
+            }
+        }
+
+        // impasse : un sommet utilise recemment, ou le prochain sommet qui n'a pas ete traite
+        while(next < 0 && !dead_end.empty())
+        {
+            int v= dead_end.back();
+            dead_end.pop_back();
+            if(live[v] > 0)
+                next= v;
+        }
+
+        for(; next < 0 && cursor < vertex_count; cursor++)
+        {
+            if(live[cursor] > 0)
+                next= cursor;
+        }
+
+        // le sommet n'est plus dans le cache, commence un nouveau groupe de triangles
+        if(next >= 0 && time - cache_time[next] > cache_size && int(order.size()) > clusters.back())
+            clusters.push_back(int(order.size()));
+
+        fan= next;
+    }
+
+    assert(int(order.size()) == triangle_count);
+    return order;
+}
+
+
+void optimize_overdraw( const unsigned *indices, const std::vector<vec3>& positions, std::vector<int>& order, const std::vector<int>& clusters )
+{
+    int cluster_count= int(clusters.size());
+    if(cluster_count < 2)
+        return;
+
+    // normale et centre de chaque groupe de triangles, ponderes par l'aire des triangles
+    std::vector<Vector> normals(cluster_count);
+    std::vector<Point> centers(cluster_count);
+    Vector center;
+    float area= 0;
+    for(int c= 0; c < cluster_count; c++)
+    {
+        int begin= clusters[c];
+        int end= (c +1 < cluster_count) ? clusters[c+1] : int(order.size());
+
+        Vector n;
+        Vector p;
+        float cluster_area= 0;
+        for(int i= begin; i < end; i++)
+        {
+            int t= order[i];
+            Point a= Point(positions[indices[3*t]]);
+            Point b= Point(positions[indices[3*t +1]]);
+            Point d= Point(positions[indices[3*t +2]]);
+
+            Vector ng= cross(b - a, d - a);
+            float w= length(ng) / 2;
+            n= n + ng;
+            p= p + w * (Vector(a) + Vector(b) + Vector(d)) / 3;
+            cluster_area+= w;
+        }
+
+        normals[c]= n;
+        centers[c]= Point(cluster_area > 0 ? p / cluster_area : p);
+        center= center + p;
+        area+= cluster_area;
+    }
+
+    if(area > 0)
+        center= center / area;
+
+    // dessine d'abord les groupes orientes vers l'exterieur de l'objet
+    std::vector<float> keys(cluster_count);
+    for(int c= 0; c < cluster_count; c++)
+    {
+        float l= length(normals[c]);
+        keys[c]= (l > 0) ? dot(centers[c] - Point(center), normals[c] / l) : 0;
+    }
+
+    std::vector<int> sorted(cluster_count);
+    for(int c= 0; c < cluster_count; c++)
+        sorted[c]= c;
+
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [&]( const int a, const int b ) { return keys[a] > keys[b]; });
+
+    std::vector<int> tmp;
+    tmp.reserve(order.size());
+    for(int i= 0; i < cluster_count; i++)
+    {
+        int c= sorted[i];
+        int begin= clusters[c];
+        int end= (c +1 < cluster_count) ? clusters[c+1] : int(order.size());
+        tmp.insert(tmp.end(), order.begin() + begin, order.begin() + end);
+    }
+
+    std::swap(order, tmp);
+}
+
+
+namespace {
+
+// indexe les sommets d'un mesh non indexe : partage les sommets qui ont les memes attributs et la meme matiere
+struct VertexIndexer
+{
+    const Mesh& mesh;
+    std::vector<int> slots;
+    std::vector<unsigned> vertices;     // indice du premier sommet identique dans le mesh
+    uint32_t mask;
+
+    VertexIndexer( const Mesh& _mesh ) : mesh(_mesh), slots(), vertices(), mask(0)
+    {
+        size_t size= 16;
+        while(size < 2 * size_t(mesh.vertex_count()))
+            size= size * 2;
+
+        slots.assign(size, -1);
+        mask= uint32_t(size -1);
+    }
+
+    unsigned material( const unsigned v ) const
+    {
+        return mesh.has_material_index() ? mesh.material_indices()[v / 3] : 0;
+    }
+
+    bool equal( const unsigned a, const unsigned b ) const
+    {
+        if(memcmp(&mesh.positions()[a], &mesh.positions()[b], sizeof(vec3)) != 0)
+            return false;
+        if(mesh.has_texcoord() && memcmp(&mesh.texcoords()[a], &mesh.texcoords()[b], sizeof(vec2)) != 0)
+            return false;
+        if(mesh.has_normal() && memcmp(&mesh.normals()[a], &mesh.normals()[b], sizeof(vec3)) != 0)
+            return false;
+        if(mesh.has_color() && memcmp(&mesh.colors()[a], &mesh.colors()[b], sizeof(vec4)) != 0)
+            return false;
+        return material(a) == material(b);
+    }
+
+    static uint32_t hash( uint32_t h, const void *data, const size_t size )
+    {
+        // fnv1a
+        const unsigned char *p= (const unsigned char *) data;
+        for(size_t i= 0; i < size; i++)
+            h= (h ^ p[i]) * 16777619u;
+        return h;
+    }
+
+    uint32_t hash( const unsigned v ) const
+    {
+        uint32_t h= 2166136261u;
+        h= hash(h, &mesh.positions()[v], sizeof(vec3));
+        if(mesh.has_texcoord()) h= hash(h, &mesh.texcoords()[v], sizeof(vec2));
+        if(mesh.has_normal()) h= hash(h, &mesh.normals()[v], sizeof(vec3));
+        if(mesh.has_color()) h= hash(h, &mesh.colors()[v], sizeof(vec4));
+        unsigned m= material(v);
+        return hash(h, &m, sizeof(m));
+    }
+
+    // renvoie l'indice du sommet
+    unsigned insert( const unsigned v )
+    {
+        for(uint32_t slot= hash(v) & mask; ; slot= (slot +1) & mask)
+        {
+            int id= slots[slot];
+            if(id < 0)
+            {
+                slots[slot]= int(vertices.size());
+                vertices.push_back(v);
+                return unsigned(vertices.size() -1);
+            }
+
+            if(equal(vertices[id], v))
+                return unsigned(id);
+        }
+    }
+};
+
+void print_stats( const char *name, const std::vector<unsigned>& indices, const int vertex_count, const int cache_size )
+{
+    VertexCacheStats stats= vertex_cache_stats(indices, vertex_count, cache_size);
+    printf("  %-12s acmr %.3f atvr %.3f, %d transformed vertices\n", name, stats.acmr, stats.atvr, stats.transformed);
+}
+
+}   // namespace
+
+
+Mesh optimize_mesh( const Mesh& mesh, const std::vector<TriangleGroup>& groups, const bool overdraw, const int cache_size )
+{
+    if(mesh.primitives() != GL_TRIANGLES || mesh.triangle_count() == 0)
+        return mesh;
+
+    std::vector<vec3> positions;
+    std::vector<vec2> texcoords;
+    std::vector<vec3> normals;
+    std::vector<vec4> colors;
+    std::vector<unsigned> indices;
+    std::vector<unsigned> materials;
+    if(mesh.has_material_index())
+        materials= mesh.material_indices();
+
+    printf("optimize mesh: %d triangles, %d groups, cache %d\n", mesh.triangle_count(), int(groups.size()), cache_size);
+    if(mesh.index_count() > 0)
+    {
+        positions= mesh.positions();
+        if(mesh.has_texcoord()) texcoords= mesh.texcoords();
+        if(mesh.has_normal()) normals= mesh.normals();
+        if(mesh.has_color()) colors= mesh.colors();
+        indices= mesh.indices();
+    }
+    else
+    {
+        // indexe les sommets
+        VertexIndexer indexer(mesh);
+        indices.resize(mesh.vertex_count());
+        for(int i= 0; i < mesh.vertex_count(); i++)
+            indices[i]= indexer.insert(i);
+
+        for(unsigned i= 0; i < indexer.vertices.size(); i++)
+        {
+            unsigned v= indexer.vertices[i];
+            positions.push_back(mesh.positions()[v]);
+            if(mesh.has_texcoord()) texcoords.push_back(mesh.texcoords()[v]);
+            if(mesh.has_normal()) normals.push_back(mesh.normals()[v]);
+            if(mesh.has_color()) colors.push_back(mesh.colors()[v]);
+        }
+
+        printf("  %-12s acmr 3.000 atvr %.3f, %d vertices\n", "arrays", float(mesh.vertex_count()) / float(positions.size()), mesh.vertex_count());
+    }
+
+    print_stats("before", indices, int(positions.size()), cache_size);
+
+    // re-ordonne les triangles de chaque groupe
+    std::vector<int> clusters;
+    std::vector<unsigned> group_indices;
+    std::vector<unsigned> group_materials;
+    for(unsigned g= 0; g < groups.size(); g++)
+    {
+        int first= groups[g].first / 3;
+        int count= groups[g].n / 3;
+        if(count < 2 || 3*size_t(first + count) > indices.size())
+            continue;
+
+        std::vector<int> order= optimize_vertex_cache(indices.data() + 3*first, count, cache_size, clusters);
+        if(overdraw)
+            optimize_overdraw(indices.data() + 3*first, positions, order, clusters);
+
+        group_indices.assign(indices.begin() + 3*first, indices.begin() + 3*(first + count));
+        for(int i= 0; i < count; i++)
+        {
+            int t= order[i];
+            indices[3*(first + i)]= group_indices[3*t];
+            indices[3*(first + i) +1]= group_indices[3*t +1];
+            indices[3*(first + i) +2]= group_indices[3*t +2];
+        }
+
+        if(!materials.empty())
+        {
+            group_materials.assign(materials.begin() + first, materials.begin() + first + count);
+            for(int i= 0; i < count; i++)
+                materials[first + i]= group_materials[order[i]];
+        }
+    }
+
+    print_stats("optimized", indices, int(positions.size()), cache_size);
+
+    // re-numerote les sommets dans l'ordre d'utilisation, les attributs sont lus dans l'ordre
+    std::vector<int> remap(positions.size(), -1);
+    std::vector<unsigned> vertices;
+    vertices.reserve(positions.size());
+    for(unsigned i= 0; i < indices.size(); i++)
+    {
+        unsigned v= indices[i];
+        if(remap[v] < 0)
+        {
+            remap[v]= int(vertices.size());
+            vertices.push_back(v);
+        }
+
+        indices[i]= unsigned(remap[v]);
+    }
+
+    std::vector<vec3> fetch_positions(vertices.size());
+    std::vector<vec2> fetch_texcoords(texcoords.empty() ? 0 : vertices.size());
+    std::vector<vec3> fetch_normals(normals.empty() ? 0 : vertices.size());
+    std::vector<vec4> fetch_colors(colors.empty() ? 0 : vertices.size());
+    for(unsigned i= 0; i < vertices.size(); i++)
+    {
+        unsigned v= vertices[i];
+        fetch_positions[i]= positions[v];
+        if(!texcoords.empty()) fetch_texcoords[i]= texcoords[v];
+        if(!normals.empty()) fetch_normals[i]= normals[v];
+        if(!colors.empty()) fetch_colors[i]= colors[v];
+    }
+
+    printf("  %d indices, %d vertices\n", int(indices.size()), int(vertices.size()));
+
+    Mesh data(GL_TRIANGLES, std::move(fetch_positions), std::move(fetch_texcoords), std::move(fetch_normals), std::move(fetch_colors), std::move(indices));
+    data.default_color(mesh.default_color());
+    data.materials(mesh.materials());
+    data.material_indices(std::move(materials));
+    return data;
+}
@@ -0,0 +1,48 @@
+
+#ifndef _MESH_OPTIMIZE_H
+#define _MESH_OPTIMIZE_H
+
+#include <vector>
+
+#include "mesh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! re-organise les triangles et les sommets d'un mesh pour le cache de sommets transformes, l'overdraw et la lecture des attributs.
+
+//! statistiques du cache de sommets transformes.
+struct VertexCacheStats
+{
+    float acmr;         //!< nombre moyen de sommets transformes par triangle, entre 0.5 et 3.
+    float atvr;         //!< nombre moyen de transformations par sommet, 1 au mieux.
+    int transformed;    //!< nombre de sommets transformes.
+};
+
+/*! simule un cache fifo de sommets transformes, de cache_size sommets, pour un index buffer. vertex_count, nombre de sommets references par les indices.
+    un mesh non indexe transforme tous les sommets de tous les triangles, acmr= 3.
+ */
+VertexCacheStats vertex_cache_stats( const std::vector<unsigned>& indices, const int vertex_count, const int cache_size= 16 );
+
+/*! re-ordonne les triangles de l'index buffer, pour le cache de sommets, cf "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", Sander, Nehab, Barczak, 2007, tipsify.
+    renvoie le nouvel ordre des triangles, triangle_count triangles a partir de indices.
+    clusters : premier triangle (dans le nouvel ordre) de chaque groupe de triangles voisins, le cache est vide au debut de chaque groupe.
+ */
+std::vector<int> optimize_vertex_cache( const unsigned *indices, const int triangle_count, const int cache_size, std::vector<int>& clusters );
+
+/*! re-ordonne les groupes de triangles produits par optimize_vertex_cache( ), pour reduire l'overdraw, quelque soit le point de vue : les groupes orientes vers l'exterieur de l'objet sont dessines en premier.
+    order, l'ordre des triangles renvoye par optimize_vertex_cache( ), est modifie.
+ */
+void optimize_overdraw( const unsigned *indices, const std::vector<vec3>& positions, std::vector<int>& order, const std::vector<int>& clusters );
+
+/*! construit un mesh indexe, optimise pour le cache de sommets, triangle par triangle a l'interieur de chaque groupe (cf Mesh::groups( )),
+    les sommets sont re-numerotes dans l'ordre d'utilisation par l'index buffer. overdraw : re-ordonne aussi les triangles pour reduire l'overdraw.
+    les groupes restent valides, mais ils designent des indices : utiliser glDrawElements( ) au lieu de glDrawArrays( ).
+    un mesh non indexe est d'abord indexe : les sommets identiques (tous les attributs et la matiere) sont partages.
+ */
+Mesh optimize_mesh( const Mesh& mesh, const std::vector<TriangleGroup>& groups, const bool overdraw= true, const int cache_size= 16 );
+
+///@}
+#endif
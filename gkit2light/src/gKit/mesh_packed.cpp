@@ -0,0 +1,504 @@
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "mesh_packed.h"
+
+
+unsigned short float_to_half( const float f )
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+
+    uint32_t sign= (x >> 16) & 0x8000;
+    uint32_t a= x & 0x7fffffff;
+    if(a >= 0x7f800000)
+        // inf ou nan
+        return sign | ((a > 0x7f800000) ? 0x7e00 : 0x7c00);
+    if(a >= 0x47800000)
+        // trop grand, inf
+        return sign | 0x7c00;
+
+    if(a < 0x38800000)
+    {
+        // denormalise, ou 0
+        if(a < 0x33000000)
+            return sign;
+
+        uint32_t m= (a & 0x007fffff) | 0x00800000;
+        int shift= 126 - int(a >> 23);
+        uint32_t h= m >> shift;
+        uint32_t r= m & ((1u << shift) -1);
+        uint32_t half= 1u << (shift -1);
+        if(r > half || (r == half && (h & 1)))
+            h++;
+        return sign | h;
+    }
+
+    // normalise, change le biais de l'exposant, arrondi au plus proche, pair en cas d'egalite
+    uint32_t h= (a - 0x38000000) >> 13;
+    uint32_t r= a & 0x1fff;
+    if(r > 0x1000 || (r == 0x1000 && (h & 1)))
+        h++;
+    return sign | h;
+}
+
+float half_to_float( const unsigned short h )
+{
+    uint32_t sign= uint32_t(h & 0x8000) << 16;
+    uint32_t e= (h >> 10) & 0x1f;
+    uint32_t m= h & 0x3ff;
+
+    uint32_t x;
+    if(e == 0x1f)
+        x= sign | 0x7f800000 | (m << 13);
+    else if(e > 0)
+        x= sign | ((e + 112) << 23) | (m << 13);
+    else if(m == 0)
+        x= sign;
+    else
+    {
+        // denormalise
+        e= 113;
+        while((m & 0x400) == 0)
+        {
+            m= m << 1;
+            e--;
+        }
+        x= sign | (e << 23) | ((m & 0x3ff) << 13);
+    }
+
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+static
+short snorm16( const float v )
+{
+    return short(std::round(std::min(1.f, std::max(-1.f, v)) * 32767.f));
+}
+
+void encode_octahedral( const Vector& n, short& x, short& y )
+{
+    float l= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if(l == 0)
+    {
+        x= 0;
+        y= 0;
+        return;
+    }
+
+    float px= n.x / l;
+    float py= n.y / l;
+    if(n.z < 0)
+    {
+        // replie l'hemisphere inferieur sur les coins du carre
+        float fx= (1 - std::abs(py)) * (px >= 0 ? 1 : -1);
+        float fy= (1 - std::abs(px)) * (py >= 0 ? 1 : -1);
+        px= fx;
+        py= fy;
+    }
+
+    x= snorm16(px);
+    y= snorm16(py);
+}
+
+Vector decode_octahedral( const short x, const short y )
+{
+    // meme calcul que decode_normal( ) dans les shaders, cf PackedMesh::definitions( )
+    float ex= std::max(-1.f, x / 32767.f);
+    float ey= std::max(-1.f, y / 32767.f);
+    Vector n(ex, ey, 1 - std::abs(ex) - std::abs(ey));
+    float t= std::max(-n.z, 0.f);
+    n.x+= (n.x >= 0) ? -t : t;
+    n.y+= (n.y >= 0) ? -t : t;
+    return normalize(n);
+}
+
+
+int VertexFormat::texcoord_offset( ) const
+{
+    return (position == POSITION_FLOAT) ? 12 : 8;
+}
+
+int VertexFormat::normal_offset( ) const
+{
+    if(!use_texcoord)
+        return texcoord_offset();
+    return texcoord_offset() + ((texcoord == TEXCOORD_FLOAT) ? 8 : 4);
+}
+
+int VertexFormat::material_offset( ) const
+{
+    // indice de matiere dans la 4ieme composante de la position
+    if(position == POSITION_UNORM16)
+        return 6;
+
+    if(!use_normal)
+        return normal_offset();
+    return normal_offset() + ((normal == NORMAL_FLOAT) ? 12 : 4);
+}
+
+int VertexFormat::stride( ) const
+{
+    int size= (use_normal) ? normal_offset() + ((normal == NORMAL_FLOAT) ? 12 : 4) : normal_offset();
+    if(use_material_index && position == POSITION_FLOAT)
+        size+= 4;       // 1 octet + alignement
+    return size;
+}
+
+
+GLuint PackedMesh::create( const Mesh& mesh, const std::vector<TriangleGroup>& groups, const VertexFormat& _format )
+{
+    if(m_vao)
+        // c'est deja fait...
+        return m_vao;
+    if(mesh.primitives() != GL_TRIANGLES || mesh.triangle_count() == 0)
+        return 0;
+
+    m_format= _format;
+    m_format.use_texcoord= m_format.use_texcoord && mesh.has_texcoord();
+    m_format.use_normal= m_format.use_normal && mesh.has_normal();
+    m_format.use_material_index= m_format.use_material_index && mesh.has_material_index();
+    const VertexFormat& format= m_format;
+
+    // indices des sommets
+    std::vector<unsigned> indices= mesh.indices();
+    if(indices.empty())
+    {
+        indices.resize(mesh.vertex_count());
+        for(unsigned i= 0; i < indices.size(); i++)
+            indices[i]= i;
+    }
+
+    // indice de matiere de chaque sommet, cf Mesh::create_buffers( )
+    std::vector<unsigned> materials;
+    if(format.use_material_index)
+    {
+        materials.resize(mesh.vertex_count(), 0);
+        for(int i= 0; i < mesh.triangle_count(); i++)
+        {
+            materials[indices[3*i]]= mesh.material_indices()[i];
+            materials[indices[3*i +1]]= mesh.material_indices()[i];
+            materials[indices[3*i +2]]= mesh.material_indices()[i];
+        }
+    }
+
+    m_groups.clear();
+    if(groups.empty())
+        m_groups.push_back( PackedGroup(0, 0, int(indices.size())) );
+    else
+        for(unsigned i= 0; i < groups.size(); i++)
+            m_groups.push_back( PackedGroup(groups[i].index, groups[i].first, groups[i].n) );
+
+    const std::vector<vec3>& positions= mesh.positions();
+    const std::vector<vec2>& texcoords= mesh.texcoords();
+    const std::vector<vec3>& normals= mesh.normals();
+
+    // englobant de chaque groupe, les positions sont quantifiees avec le meme pas, sur la meme grille
+    std::vector<double> qmin(3*m_groups.size(), 0);
+    double step= 1;
+    if(format.position == VertexFormat::POSITION_UNORM16)
+    {
+        std::vector<Point> bounds(m_groups.size());
+        float extent= 0;
+        for(unsigned g= 0; g < m_groups.size(); g++)
+        {
+            if(m_groups[g].n == 0)
+                continue;
+
+            Point pmin= Point(positions[indices[m_groups[g].first]]);
+            Point pmax= pmin;
+            for(int i= m_groups[g].first; i < m_groups[g].first + m_groups[g].n; i++)
+            {
+                pmin= min(pmin, Point(positions[indices[i]]));
+                pmax= max(pmax, Point(positions[indices[i]]));
+            }
+
+            extent= std::max(extent, std::max(pmax.x - pmin.x, std::max(pmax.y - pmin.y, pmax.z - pmin.z)));
+            bounds[g]= pmin;
+        }
+
+        // 65533 : les arrondis ne depassent pas 65535
+        step= (extent > 0) ? double(extent) / 65533 : 1;
+        for(unsigned g= 0; g < m_groups.size(); g++)
+        {
+            qmin[3*g]= std::floor(bounds[g].x / step);
+            qmin[3*g +1]= std::floor(bounds[g].y / step);
+            qmin[3*g +2]= std::floor(bounds[g].z / step);
+            m_groups[g].position_min= vec3(qmin[3*g] * step, qmin[3*g +1] * step, qmin[3*g +2] * step);
+            m_groups[g].position_scale= vec3(step * 65535, step * 65535, step * 65535);
+        }
+    }
+
+    for(unsigned g= 0; g < m_groups.size(); g++)
+    {
+        if(m_groups[g].n > 0 && format.use_texcoord && format.texcoord == VertexFormat::TEXCOORD_UNORM16)
+        {
+            vec2 tmin= texcoords[indices[m_groups[g].first]];
+            vec2 tmax= tmin;
+            for(int i= m_groups[g].first; i < m_groups[g].first + m_groups[g].n; i++)
+            {
+                const vec2& t= texcoords[indices[i]];
+                tmin= vec2(std::min(tmin.x, t.x), std::min(tmin.y, t.y));
+                tmax= vec2(std::max(tmax.x, t.x), std::max(tmax.y, t.y));
+            }
+
+            m_groups[g].texcoord_min= tmin;
+            m_groups[g].texcoord_scale= vec2(tmax.x > tmin.x ? tmax.x - tmin.x : 1, tmax.y > tmin.y ? tmax.y - tmin.y : 1);
+        }
+    }
+
+    // duplique les sommets partages par plusieurs groupes, et construit l'index buffer
+    std::vector<int> remap(mesh.vertex_count(), -1);
+    std::vector<unsigned> vertices;             // sommet du mesh
+    std::vector<unsigned> vertex_groups;        // groupe du sommet
+    std::vector<unsigned> packed_indices(indices.size());
+    int duplicates= 0;
+    for(unsigned g= 0; g < m_groups.size(); g++)
+    {
+        int begin= int(vertices.size());
+        for(int i= m_groups[g].first; i < m_groups[g].first + m_groups[g].n; i++)
+        {
+            unsigned v= indices[i];
+            if(remap[v] < begin)
+            {
+                if(remap[v] >= 0)
+                    duplicates++;
+                remap[v]= int(vertices.size());
+                vertices.push_back(v);
+                vertex_groups.push_back(g);
+            }
+
+            packed_indices[i]= unsigned(remap[v]);
+        }
+    }
+
+    // encode les sommets
+    const int stride= format.stride();
+    std::vector<unsigned char> data(size_t(stride) * vertices.size(), 0);
+    for(unsigned i= 0; i < vertices.size(); i++)
+    {
+        unsigned v= vertices[i];
+        const PackedGroup& group= m_groups[vertex_groups[i]];
+        unsigned char *vertex= data.data() + size_t(stride) * i;
+
+        if(format.position == VertexFormat::POSITION_FLOAT)
+            memcpy(vertex + format.position_offset(), &positions[v], sizeof(vec3));
+        else
+        {
+            const double *q= &qmin[3*vertex_groups[i]];
+            uint16_t p[4];
+            p[0]= uint16_t(std::llround(positions[v].x / step) - (long long) q[0]);
+            p[1]= uint16_t(std::llround(positions[v].y / step) - (long long) q[1]);
+            p[2]= uint16_t(std::llround(positions[v].z / step) - (long long) q[2]);
+            p[3]= format.use_material_index ? uint16_t(materials[v]) : 0;
+            memcpy(vertex + format.position_offset(), p, sizeof(p));
+        }
+
+        if(format.use_texcoord)
+        {
+            const vec2& t= texcoords[v];
+            if(format.texcoord == VertexFormat::TEXCOORD_FLOAT)
+                memcpy(vertex + format.texcoord_offset(), &t, sizeof(vec2));
+            else
+            {
+                uint16_t p[2];
+                if(format.texcoord == VertexFormat::TEXCOORD_HALF)
+                {
+                    p[0]= float_to_half(t.x);
+                    p[1]= float_to_half(t.y);
+                }
+                else
+                {
+                    p[0]= uint16_t(std::round(std::min(1.f, std::max(0.f, (t.x - group.texcoord_min.x) / group.texcoord_scale.x)) * 65535));
+                    p[1]= uint16_t(std::round(std::min(1.f, std::max(0.f, (t.y - group.texcoord_min.y) / group.texcoord_scale.y)) * 65535));
+                }
+                memcpy(vertex + format.texcoord_offset(), p, sizeof(p));
+            }
+        }
+
+        if(format.use_normal)
+        {
+            if(format.normal == VertexFormat::NORMAL_FLOAT)
+                memcpy(vertex + format.normal_offset(), &normals[v], sizeof(vec3));
+            else
+            {
+                short p[2];
+                encode_octahedral(Vector(normals[v]), p[0], p[1]);
+                memcpy(vertex + format.normal_offset(), p, sizeof(p));
+            }
+        }
+
+        if(format.use_material_index && format.position == VertexFormat::POSITION_FLOAT)
+            vertex[format.material_offset()]= (unsigned char) materials[v];
+    }
+
+    m_vertex_count= int(vertices.size());
+    m_index_count= int(packed_indices.size());
+    m_vertex_buffer_size= data.size();
+
+    // buffers et format de sommet
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &m_index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed_indices.size() * sizeof(unsigned), packed_indices.data(), GL_STATIC_DRAW);
+
+    if(format.position == VertexFormat::POSITION_FLOAT)
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (const void *) size_t(format.position_offset()));
+    else
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void *) size_t(format.position_offset()));
+    glEnableVertexAttribArray(0);
+
+    if(format.use_texcoord)
+    {
+        if(format.texcoord == VertexFormat::TEXCOORD_FLOAT)
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (const void *) size_t(format.texcoord_offset()));
+        else if(format.texcoord == VertexFormat::TEXCOORD_HALF)
+            glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, (const void *) size_t(format.texcoord_offset()));
+        else
+            glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (const void *) size_t(format.texcoord_offset()));
+        glEnableVertexAttribArray(1);
+    }
+
+    if(format.use_normal)
+    {
+        if(format.normal == VertexFormat::NORMAL_FLOAT)
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (const void *) size_t(format.normal_offset()));
+        else
+            glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (const void *) size_t(format.normal_offset()));
+        glEnableVertexAttribArray(2);
+    }
+
+    if(format.use_material_index)
+    {
+        if(format.position == VertexFormat::POSITION_FLOAT)
+            glVertexAttribIPointer(4, 1, GL_UNSIGNED_BYTE, stride, (const void *) size_t(format.material_offset()));
+        else
+            glVertexAttribIPointer(4, 1, GL_UNSIGNED_SHORT, stride, (const void *) size_t(format.material_offset()));
+        glEnableVertexAttribArray(4);
+    }
+
+    // parametres de decodage de chaque groupe, attributs d'instance, pour les draws indirects, cf definitions(true)
+    std::vector<float> params;
+    for(const PackedGroup& group : m_groups)
+    {
+        const float p[]= {
+            group.position_min.x, group.position_min.y, group.position_min.z,
+            group.position_scale.x, group.position_scale.y, group.position_scale.z,
+            group.texcoord_min.x, group.texcoord_min.y, group.texcoord_scale.x, group.texcoord_scale.y };
+        params.insert(params.end(), p, p + 10);
+    }
+
+    glGenBuffers(1, &m_group_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_group_buffer);
+    glBufferData(GL_ARRAY_BUFFER, params.size() * sizeof(float), params.data(), GL_STATIC_DRAW);
+
+    const int group_stride= 10 * sizeof(float);
+    glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, group_stride, (const void *) 0);
+    glVertexAttribDivisor(5, 1);
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, group_stride, (const void *) (3 * sizeof(float)));
+    glVertexAttribDivisor(6, 1);
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, group_stride, (const void *) (6 * sizeof(float)));
+    glVertexAttribDivisor(7, 1);
+    glEnableVertexAttribArray(7);
+
+    glBindVertexArray(0);
+
+    printf("packed mesh: %d vertices (%d duplicates), %d bytes/vertex, %dKB (mesh %dKB)\n",
+        m_vertex_count, duplicates, stride, int(m_vertex_buffer_size / 1024), int((mesh.vertex_buffer_size() + mesh.texcoord_buffer_size() + mesh.normal_buffer_size() + mesh.vertex_count()) / 1024));
+    return m_vao;
+}
+
+void PackedMesh::release( )
+{
+    if(m_index_buffer)
+        glDeleteBuffers(1, &m_index_buffer);
+    if(m_buffer)
+        glDeleteBuffers(1, &m_buffer);
+    if(m_group_buffer)
+        glDeleteBuffers(1, &m_group_buffer);
+    if(m_vao)
+        glDeleteVertexArrays(1, &m_vao);
+
+    m_index_buffer= 0;
+    m_buffer= 0;
+    m_group_buffer= 0;
+    m_vao= 0;
+}
+
+
+std::string PackedMesh::definitions( const bool indirect ) const
+{
+    std::string source;
+    source.append("#define PACKED_VERTEX\n");
+    source.append("#define PACKED_POSITION vec3\n");
+    source.append("#define PACKED_TEXCOORD vec2\n");
+    source.append((m_format.normal == VertexFormat::NORMAL_OCTAHEDRAL) ? "#define PACKED_NORMAL vec2\n" : "#define PACKED_NORMAL vec3\n");
+
+    if(indirect)
+        // attributs d'instance, declares par PACKED_GROUP dans le vertex shader, et decodage par des macros : les autres shaders ne les utilisent pas
+        source.append(
+            "#define PACKED_INDIRECT\n"
+            "#define PACKED_GROUP layout(location= 5) in vec3 packed_position_min; layout(location= 6) in vec3 packed_position_scale; layout(location= 7) in vec4 packed_texcoord_transform;\n"
+            "#define decode_position(p) (packed_position_min + (p) * packed_position_scale)\n"
+            "#define decode_texcoord(t) (packed_texcoord_transform.xy + (t) * packed_texcoord_transform.zw)\n");
+    else
+        source.append(
+            "uniform vec3 packed_position_min;\n"
+            "uniform vec3 packed_position_scale;\n"
+            "uniform vec2 packed_texcoord_min;\n"
+            "uniform vec2 packed_texcoord_scale;\n"
+            "vec3 decode_position( const in vec3 p ) { return packed_position_min + p * packed_position_scale; }\n"
+            "vec2 decode_texcoord( const in vec2 t ) { return packed_texcoord_min + t * packed_texcoord_scale; }\n");
+
+    source.append(
+        "vec3 decode_normal( const in vec3 n ) { return n; }\n"
+        "vec3 decode_normal( const in vec2 e )\n"
+        "{\n"
+        "    vec3 n= vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+        "    float t= max(-n.z, 0.0);\n"
+        "    n.x+= (n.x >= 0.0) ? -t : t;\n"
+        "    n.y+= (n.y >= 0.0) ? -t : t;\n"
+        "    return normalize(n);\n"
+        "}\n");
+    return source;
+}
+
+void PackedMesh::uniforms( const GLuint program, const int group ) const
+{
+    // les uniforms inutilises par le shader sont ignores
+    const PackedGroup& g= m_groups[group];
+    GLint location= glGetUniformLocation(program, "packed_position_min");
+    if(location >= 0) glUniform3f(location, g.position_min.x, g.position_min.y, g.position_min.z);
+    location= glGetUniformLocation(program, "packed_position_scale");
+    if(location >= 0) glUniform3f(location, g.position_scale.x, g.position_scale.y, g.position_scale.z);
+    location= glGetUniformLocation(program, "packed_texcoord_min");
+    if(location >= 0) glUniform2f(location, g.texcoord_min.x, g.texcoord_min.y);
+    location= glGetUniformLocation(program, "packed_texcoord_scale");
+    if(location >= 0) glUniform2f(location, g.texcoord_scale.x, g.texcoord_scale.y);
+}
+
+void PackedMesh::draw( const int group ) const
+{
+    const PackedGroup& g= m_groups[group];
+    glDrawElements(GL_TRIANGLES, g.n, GL_UNSIGNED_INT, (const void *) (size_t(g.first) * sizeof(unsigned)));
+}
+
+void PackedMesh::draw( const int first, const int n ) const
+{
+    glDrawElements(GL_TRIANGLES, n, GL_UNSIGNED_INT, (const void *) (size_t(first) * sizeof(unsigned)));
+}
@@ -0,0 +1,172 @@
+
+#ifndef _MESH_PACKED_H
+#define _MESH_PACKED_H
+
+#include <string>
+#include <vector>
+
+#include "glcore.h"
+#include "vec.h"
+#include "mesh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! sommets compresses / quantifies, entrelaces dans un seul buffer. + decodage dans les shaders.
+
+/*! format des sommets d'un PackedMesh. les attributs sont entrelaces, dans l'ordre position, texcoord, normale, indice de matiere.
+    - position : 3 float, ou 3 unorm16, quantifiee dans la boite englobante de chaque groupe de triangles,
+    - texcoord : 2 float, 2 half float, ou 2 unorm16 dans les limites des texcoords de chaque groupe,
+    - normale : 3 float, ou 2 snorm16, encodage octaedrique,
+    - indice de matiere : dans la 4ieme composante de la position unorm16, ou 1 octet (+ alignement).
+
+    le format par defaut utilise 16 octets par sommet, au lieu de 33.
+ */
+struct VertexFormat
+{
+    enum Position { POSITION_FLOAT, POSITION_UNORM16 };
+    enum Texcoord { TEXCOORD_FLOAT, TEXCOORD_HALF, TEXCOORD_UNORM16 };
+    enum Normal { NORMAL_FLOAT, NORMAL_OCTAHEDRAL };
+
+    Position position;
+    Texcoord texcoord;
+    Normal normal;
+    bool use_texcoord;
+    bool use_normal;
+    bool use_material_index;
+
+    //! format compresse, par defaut.
+    VertexFormat( const Position _position= POSITION_UNORM16, const Texcoord _texcoord= TEXCOORD_HALF, const Normal _normal= NORMAL_OCTAHEDRAL ) :
+        position(_position), texcoord(_texcoord), normal(_normal), use_texcoord(true), use_normal(true), use_material_index(true) {}
+
+    //! renvoie la taille d'un sommet, en octets.
+    int stride( ) const;
+    //! position de chaque attribut dans un sommet, en octets.
+    int position_offset( ) const { return 0; }
+    int texcoord_offset( ) const;
+    int normal_offset( ) const;
+    int material_offset( ) const;
+};
+
+
+//! groupe de triangles d'un PackedMesh, cf TriangleGroup, et parametres de decodage de ses sommets.
+struct PackedGroup
+{
+    int index;              //!< propriete du groupe, cf TriangleGroup.
+    int first;              //!< premier indice du groupe.
+    int n;                  //!< nombre d'indices du groupe.
+    vec3 position_min;      //!< position = position_min + position_scale * unorm16.
+    vec3 position_scale;
+    vec2 texcoord_min;      //!< texcoord = texcoord_min + texcoord_scale * unorm16.
+    vec2 texcoord_scale;
+
+    PackedGroup( const int _index= 0, const int _first= 0, const int _n= 0 ) :
+        index(_index), first(_first), n(_n), position_min(0, 0, 0), position_scale(1, 1, 1), texcoord_min(0, 0), texcoord_scale(1, 1) {}
+};
+
+
+/*! copie compressee d'un mesh, prete a dessiner avec glDrawElements( ), groupe par groupe. les sommets partages par plusieurs groupes sont dupliques, chaque groupe est quantifie dans sa boite englobante.
+    les positions de tous les groupes sont quantifiees avec le meme pas, sur la meme grille : les sommets dupliques sont decodes sur le meme point de la grille, pas de fissures entre les groupes.
+
+    les shaders utilisent definitions( ) pour declarer les attributs et les decoder :
+    \code
+    PackedMesh packed;
+    GLuint vao= packed.create(mesh, mesh.groups(), VertexFormat());
+    GLuint program= read_program("shader.glsl", packed.definitions().c_str());
+
+    // shader.glsl
+    layout(location= 0) in PACKED_POSITION position;
+    layout(location= 1) in PACKED_TEXCOORD texcoord;
+    layout(location= 2) in PACKED_NORMAL normal;
+    ...
+    gl_Position= mvpMatrix * vec4(decode_position(position), 1);
+    vec3 n= decode_normal(normal);
+
+    // application
+    glBindVertexArray(vao);
+    glUseProgram(program);
+    for(int i= 0; i < int(packed.groups().size()); i++)
+    {
+        packed.uniforms(program, i);
+        packed.draw(i);
+    }
+    \endcode
+
+    les groupes peuvent aussi etre dessines par un seul multidraw indirect : les parametres de decodage de chaque groupe sont aussi des attributs d'instance, et instance_base des draws selectionne le groupe.
+    \code
+    GLuint program= read_program("shader.glsl", packed.definitions(true).c_str());
+
+    // shader.glsl, vertex shader
+    layout(location= 0) in PACKED_POSITION position;
+    ...
+    PACKED_GROUP        // declare les attributs d'instance
+    gl_Position= mvpMatrix * vec4(decode_position(position), 1);
+
+    // application, draws indirects : instance_count= 1, instance_base= indice du groupe
+    glMultiDrawElementsIndirect( ... );
+    \endcode
+ */
+class PackedMesh
+{
+public:
+    PackedMesh( ) : m_format(), m_groups(), m_vertex_count(0), m_index_count(0), m_vertex_buffer_size(0), m_vao(0), m_buffer(0), m_index_buffer(0), m_group_buffer(0) {}
+
+    /*! construit les buffers et le vertex array object. les groupes designent des triangles de mesh, cf Mesh::groups( ), en indices ou en sommets si le mesh n'est pas indexe.
+        si groups est vide, tous les triangles forment un seul groupe.
+     */
+    GLuint create( const Mesh& mesh, const std::vector<TriangleGroup>& groups, const VertexFormat& format= VertexFormat() );
+    //! detruit les objets openGL.
+    void release( );
+
+    //! renvoie le source glsl a passer a read_program( ) : types des attributs, uniforms et fonctions de decodage. indirect : parametres de decodage en attributs d'instance, au lieu d'uniforms.
+    std::string definitions( const bool indirect= false ) const;
+    //! transmet les parametres de decodage du groupe au shader program en cours d'utilisation.
+    void uniforms( const GLuint program, const int group ) const;
+    //! dessine les triangles d'un groupe. le vao et le shader program doivent etre selectionnes.
+    void draw( const int group ) const;
+    //! dessine n indices a partir de first, une partie d'un groupe, cf niveaux de details ou meshlets. les indices du mesh sont conserves. le vao et le shader program doivent etre selectionnes.
+    void draw( const int first, const int n ) const;
+
+    //! renvoie le vertex array object.
+    GLuint vao( ) const { return m_vao; }
+    //! renvoie les groupes de triangles.
+    const std::vector<PackedGroup>& groups( ) const { return m_groups; }
+    //! renvoie le format des sommets.
+    const VertexFormat& format( ) const { return m_format; }
+    //! renvoie le nombre de sommets, y compris les sommets dupliques entre les groupes.
+    int vertex_count( ) const { return m_vertex_count; }
+    //! renvoie le nombre d'indices.
+    int index_count( ) const { return m_index_count; }
+    //! renvoie la taille du vertex buffer, en octets.
+    size_t vertex_buffer_size( ) const { return m_vertex_buffer_size; }
+
+protected:
+    VertexFormat m_format;
+    std::vector<PackedGroup> m_groups;
+    int m_vertex_count;
+    int m_index_count;
+    size_t m_vertex_buffer_size;
+
+    GLuint m_vao;
+    GLuint m_buffer;
+    GLuint m_index_buffer;
+    GLuint m_group_buffer;
+};
+
+
+//! \name encodage des attributs.
+//@{
+//! convertit un float en half float, arrondi au plus proche.
+unsigned short float_to_half( const float f );
+//! convertit un half float en float.
+float half_to_float( const unsigned short h );
+//! encode une direction (normalisee), encodage octaedrique sur 2 snorm16.
+void encode_octahedral( const Vector& n, short& x, short& y );
+//! decode une direction encodee par encode_octahedral( ).
+Vector decode_octahedral( const short x, const short y );
+//@}
+
+///@}
+#endif
@@ -0,0 +1,478 @@
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "mesh_simplify.h"
+
+
+namespace {
+
+// quadrique d'erreur, somme des carres des distances a un ensemble de plans, ponderee.
+struct Quadric
+{
+    double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+    double w;
+
+    Quadric( ) : a2(0), b2(0), c2(0), ab(0), ac(0), bc(0), ad(0), bd(0), cd(0), d2(0), w(0) {}
+
+    // plan dot(n, p) + d = 0, n normalisee
+    Quadric( const Vector& n, const float d, const double weight ) :
+        a2(weight * n.x * n.x), b2(weight * n.y * n.y), c2(weight * n.z * n.z),
+        ab(weight * n.x * n.y), ac(weight * n.x * n.z), bc(weight * n.y * n.z),
+        ad(weight * n.x * d), bd(weight * n.y * d), cd(weight * n.z * d), d2(weight * d * d),
+        w(weight) {}
+
+    Quadric& operator+= ( const Quadric& q )
+    {
+        a2+= q.a2; b2+= q.b2; c2+= q.c2;
+        ab+= q.ab; ac+= q.ac; bc+= q.bc;
+        ad+= q.ad; bd+= q.bd; cd+= q.cd; d2+= q.d2;
+        w+= q.w;
+        return *this;
+    }
+
+    // carre de la distance moyenne aux plans
+    double error( const Point& p ) const
+    {
+        double x= p.x, y= p.y, z= p.z;
+        double r= a2*x*x + b2*y*y + c2*z*z + 2*(ab*x*y + ac*x*z + bc*y*z) + 2*(ad*x + bd*y + cd*z) + d2;
+        return (w > 0) ? std::abs(r) / w : 0;
+    }
+};
+
+// type de sommet : libre, sur un bord, sur une couture ou bloque.
+enum Kind { MANIFOLD, BORDER, SEAM, LOCKED };
+
+struct Collapse
+{
+    unsigned v0;
+    unsigned v1;
+    double error;
+
+    bool operator< ( const Collapse& b ) const { return error < b.error; }
+};
+
+// aretes orientees, sommet par sommet
+struct Adjacency
+{
+    std::vector<unsigned> offsets;
+    std::vector<unsigned> targets;
+
+    Adjacency( const std::vector<unsigned>& indices, const unsigned vertex_count ) : offsets(vertex_count +1, 0), targets(indices.size())
+    {
+        for(unsigned i= 0; i < indices.size(); i++)
+            offsets[indices[i] +1]++;
+        for(unsigned v= 0; v < vertex_count; v++)
+            offsets[v +1]+= offsets[v];
+
+        std::vector<unsigned> fill(offsets.begin(), offsets.end() -1);
+        for(unsigned i= 0; i +2 < indices.size(); i+= 3)
+        for(unsigned k= 0; k < 3; k++)
+        {
+            unsigned a= indices[i + k];
+            unsigned b= indices[i + (k+1) % 3];
+            targets[fill[a]++]= b;
+        }
+    }
+
+    bool edge( const unsigned a, const unsigned b ) const
+    {
+        for(unsigned i= offsets[a]; i < offsets[a +1]; i++)
+            if(targets[i] == b)
+                return true;
+        return false;
+    }
+};
+
+}
+
+
+std::vector<unsigned> simplify_indices( const std::vector<vec3>& _positions, const unsigned *_indices, const int index_count,
+    const int target_index_count, const float target_error, const bool lock_border, float *result_error )
+{
+    if(result_error)
+        *result_error= 0;
+
+    std::vector<unsigned> indices(_indices, _indices + index_count);
+    if(index_count <= target_index_count || index_count < 3)
+        return indices;
+
+    // re-numerote les sommets utilises
+    std::vector<unsigned> vertices= indices;
+    std::sort(vertices.begin(), vertices.end());
+    vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    for(unsigned i= 0; i < indices.size(); i++)
+        indices[i]= unsigned(std::lower_bound(vertices.begin(), vertices.end(), indices[i]) - vertices.begin());
+
+    const unsigned n= unsigned(vertices.size());
+    std::vector<Point> positions(n);
+    for(unsigned i= 0; i < n; i++)
+        positions[i]= Point(_positions[vertices[i]]);
+
+    // sommets a la meme position : remap, premier sommet a cette position, et wedge, liste circulaire des sommets a la meme position.
+    std::vector<unsigned> remap(n);
+    std::vector<unsigned> wedge(n);
+    {
+        std::vector<unsigned> order(n);
+        for(unsigned i= 0; i < n; i++)
+            order[i]= i;
+        std::sort(order.begin(), order.end(),
+            [&]( const unsigned a, const unsigned b )
+            {
+                if(positions[a].x != positions[b].x) return positions[a].x < positions[b].x;
+                if(positions[a].y != positions[b].y) return positions[a].y < positions[b].y;
+                if(positions[a].z != positions[b].z) return positions[a].z < positions[b].z;
+                return a < b;
+            } );
+
+        for(unsigned i= 0; i < n; )
+        {
+            unsigned end= i +1;
+            while(end < n && positions[order[end]].x == positions[order[i]].x && positions[order[end]].y == positions[order[i]].y && positions[order[end]].z == positions[order[i]].z)
+                end++;
+
+            for(unsigned k= i; k < end; k++)
+            {
+                remap[order[k]]= order[i];
+                wedge[order[k]]= order[(k +1 < end) ? k +1 : i];
+            }
+            i= end;
+        }
+    }
+
+    // aretes ouvertes : sans arete opposee (dans l'index buffer, pas dans l'espace des positions), sur un bord ou sur une couture
+    const unsigned none= ~0u;
+    std::vector<unsigned> openinc(n, none);
+    std::vector<unsigned> openout(n, none);
+    {
+        Adjacency adjacency(indices, n);
+        for(unsigned v= 0; v < n; v++)
+        for(unsigned i= adjacency.offsets[v]; i < adjacency.offsets[v +1]; i++)
+        {
+            unsigned t= adjacency.targets[i];
+            if(!adjacency.edge(t, v))
+            {
+                // plusieurs aretes ouvertes : le sommet lui meme, cf la classification
+                openinc[t]= (openinc[t] == none) ? v : t;
+                openout[v]= (openout[v] == none) ? t : v;
+            }
+        }
+    }
+
+    // classe les sommets, cf meshoptimizer, classifyVertices( )
+    std::vector<unsigned char> kinds(n, LOCKED);
+    for(unsigned i= 0; i < n; i++)
+    {
+        if(remap[i] != i)
+            continue;
+
+        if(wedge[i] == i)
+        {
+            // pas de couture
+            if(openinc[i] == none && openout[i] == none)
+                kinds[i]= MANIFOLD;
+            else if(openinc[i] != none && openinc[i] != i && openout[i] != none && openout[i] != i)
+                kinds[i]= lock_border ? LOCKED : BORDER;
+        }
+        else if(wedge[wedge[i]] == i)
+        {
+            // couture, 2 sommets, une arete ouverte entrante et sortante pour chaque sommet, et les aretes se correspondent
+            unsigned w= wedge[i];
+            unsigned iv= openinc[i], ov= openout[i];
+            unsigned iw= openinc[w], ow= openout[w];
+            if(iv != none && iv != i && ov != none && ov != i && iw != none && iw != w && ow != none && ow != w)
+                if(remap[iv] == remap[ow] && remap[ov] == remap[iw] && remap[iv] != remap[ov])
+                    kinds[i]= SEAM;
+        }
+    }
+    for(unsigned i= 0; i < n; i++)
+        kinds[i]= kinds[remap[i]];
+
+    // quadriques, par position
+    std::vector<Quadric> quadrics(n);
+    for(unsigned i= 0; i +2 < indices.size(); i+= 3)
+    {
+        unsigned a= indices[i], b= indices[i+1], c= indices[i+2];
+        Vector normal= cross(positions[b] - positions[a], positions[c] - positions[a]);
+        float area= length(normal);
+        if(area == 0)
+            continue;
+
+        normal= normal / area;
+        Quadric q(normal, -dot(normal, Vector(positions[a])), area / 2);
+        quadrics[remap[a]]+= q;
+        quadrics[remap[b]]+= q;
+        quadrics[remap[c]]+= q;
+
+        // conserve la forme des bords et des coutures, plan perpendiculaire au triangle qui passe par l'arete
+        for(unsigned k= 0; k < 3; k++)
+        {
+            unsigned v0= indices[i + k];
+            unsigned v1= indices[i + (k+1) % 3];
+            if(openout[v0] != v1 || (kinds[v0] != BORDER && kinds[v0] != SEAM))
+                continue;
+
+            Vector edge= positions[v1] - positions[v0];
+            float l= length(edge);
+            if(l == 0)
+                continue;
+
+            Vector n= normalize(cross(edge, normal));
+            Quadric e(n, -dot(n, Vector(positions[v0])), 10 * l * l);
+            quadrics[remap[v0]]+= e;
+            quadrics[remap[v1]]+= e;
+        }
+    }
+
+    const double limit= double(target_error) * double(target_error);
+    double max_error= 0;
+
+    std::vector<Collapse> collapses;
+    std::vector<unsigned> targets(n);
+    std::vector<unsigned char> locked(n);
+    std::vector<unsigned> offsets(n +1);
+    std::vector<unsigned> triangles;
+    while(int(indices.size()) > target_index_count)
+    {
+        // triangles autour de chaque position
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for(unsigned i= 0; i < indices.size(); i++)
+            offsets[remap[indices[i]] +1]++;
+        for(unsigned v= 0; v < n; v++)
+            offsets[v +1]+= offsets[v];
+        triangles.resize(indices.size());
+        {
+            std::vector<unsigned> fill(offsets.begin(), offsets.end() -1);
+            for(unsigned i= 0; i < indices.size(); i++)
+                triangles[fill[remap[indices[i]]]++]= i / 3;
+        }
+
+        // fusions possibles, et leur cout
+        collapses.clear();
+        for(unsigned i= 0; i +2 < indices.size(); i+= 3)
+        for(unsigned k= 0; k < 6; k++)
+        {
+            unsigned a= indices[i + k % 3];
+            unsigned b= indices[i + (k+1) % 3];
+            if(k >= 3)
+                std::swap(a, b);
+            if(remap[a] == remap[b])
+                continue;
+
+            bool open= (openout[a] == b || openinc[a] == b);
+            if(kinds[a] == MANIFOLD
+            || (kinds[a] == BORDER && kinds[b] == BORDER && open)
+            || (kinds[a] == SEAM && kinds[b] == SEAM && open))
+                collapses.push_back( { a, b, quadrics[remap[a]].error(positions[b]) } );
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        for(unsigned v= 0; v < n; v++)
+            targets[v]= v;
+        std::fill(locked.begin(), locked.end(), 0);
+
+        int goal= (int(indices.size()) - target_index_count) / 3;
+        int removed= 0;
+        for(unsigned c= 0; c < collapses.size() && removed < goal; c++)
+        {
+            if(collapses[c].error > limit)
+                break;
+
+            unsigned a= collapses[c].v0;
+            unsigned b= collapses[c].v1;
+            unsigned ra= remap[a];
+            unsigned rb= remap[b];
+            if(locked[ra] || locked[rb])
+                continue;
+
+            // couture : fusionne aussi l'autre cote
+            unsigned w= none, s= none;
+            if(kinds[a] == SEAM)
+            {
+                w= wedge[a];
+                s= (openout[a] == b) ? openinc[w] : openout[w];
+                if(s == none || s == w || remap[s] != rb)
+                    continue;
+            }
+
+            // verifie que les triangles autour de a ne se retournent pas, ni ne tournent de plus de 60 degres : les rotations s'accumulent d'une passe a l'autre
+            bool flip= false;
+            for(unsigned t= offsets[ra]; t < offsets[ra +1] && !flip; t++)
+            {
+                unsigned tri= triangles[t];
+                unsigned v[3]= { indices[3*tri], indices[3*tri+1], indices[3*tri+2] };
+                if(remap[v[0]] == rb || remap[v[1]] == rb || remap[v[2]] == rb)
+                    continue;       // triangle supprime
+
+                Point p[3]= { positions[v[0]], positions[v[1]], positions[v[2]] };
+                Vector n0= cross(p[1] - p[0], p[2] - p[0]);
+                for(int k= 0; k < 3; k++)
+                    if(remap[v[k]] == ra)
+                        p[k]= positions[b];
+                Vector n1= cross(p[1] - p[0], p[2] - p[0]);
+                if(dot(n0, n1) <= 0.5f * length(n0) * length(n1))
+                    flip= true;
+            }
+            if(flip)
+                continue;
+
+            // fusionne
+            targets[a]= b;
+            if(w != none)
+                targets[w]= s;
+            quadrics[rb]+= quadrics[ra];
+            max_error= std::max(max_error, collapses[c].error);
+            removed+= (kinds[a] == BORDER) ? 1 : 2;
+
+            // bloque les sommets des triangles modifies, jusqu'a la prochaine passe
+            locked[ra]= 1;
+            locked[rb]= 1;
+            for(unsigned t= offsets[ra]; t < offsets[ra +1]; t++)
+            {
+                unsigned tri= triangles[t];
+                locked[remap[indices[3*tri]]]= 1;
+                locked[remap[indices[3*tri+1]]]= 1;
+                locked[remap[indices[3*tri+2]]]= 1;
+            }
+        }
+
+        if(removed == 0)
+            break;
+
+        // re-construit l'index buffer, sans les triangles degeneres
+        unsigned m= 0;
+        for(unsigned i= 0; i +2 < indices.size(); i+= 3)
+        {
+            unsigned a= targets[indices[i]];
+            unsigned b= targets[indices[i+1]];
+            unsigned c= targets[indices[i+2]];
+            if(a == b || b == c || a == c)
+                continue;
+
+            indices[m]= a;
+            indices[m+1]= b;
+            indices[m+2]= c;
+            m+= 3;
+        }
+        indices.resize(m);
+    }
+
+    // indices des sommets
+    for(unsigned i= 0; i < indices.size(); i++)
+        indices[i]= vertices[indices[i]];
+
+    if(result_error)
+        *result_error= float(std::sqrt(max_error));
+    return indices;
+}
+
+
+std::vector<MeshLod> build_lods( Mesh& mesh, std::vector<TriangleGroup>& groups, const int max_levels, const float ratio, const float max_error )
+{
+    if(mesh.primitives() != GL_TRIANGLES || mesh.indices().empty())
+    {
+        printf("[error] build_lods( ): indexed triangles only...\n");
+        return {};
+    }
+
+    const std::vector<vec3>& positions= mesh.positions();
+    const std::vector<unsigned>& indices= mesh.indices();
+    const std::vector<unsigned>& materials= mesh.material_indices();
+    const bool has_materials= mesh.has_material_index();
+
+    // matiere de chaque sommet : les sommets indexes ne sont pas partages par plusieurs matieres
+    std::vector<unsigned> vertex_materials;
+    if(has_materials)
+    {
+        vertex_materials.resize(mesh.vertex_count(), 0);
+        for(unsigned i= 0; i < indices.size(); i++)
+            vertex_materials[indices[i]]= materials[i / 3];
+    }
+
+    std::vector<unsigned> lod_indices;
+    std::vector<unsigned> lod_materials;
+    lod_indices.reserve(indices.size() * 2);
+    std::vector<MeshLod> lods(groups.size());
+    int triangles[2]= { 0, 0 };
+    for(unsigned g= 0; g < groups.size(); g++)
+    {
+        const unsigned *group= indices.data() + groups[g].first;
+        const int n= groups[g].n;
+
+        MeshLod& lod= lods[g];
+        lod.center= Point(0, 0, 0);
+        lod.radius= 0;
+        if(n > 0)
+        {
+            Point pmin= Point(positions[group[0]]);
+            Point pmax= pmin;
+            for(int i= 0; i < n; i++)
+            {
+                pmin= min(pmin, Point(positions[group[i]]));
+                pmax= max(pmax, Point(positions[group[i]]));
+            }
+
+            lod.center= center(pmin, pmax);
+            for(int i= 0; i < n; i++)
+                lod.radius= std::max(lod.radius, distance(lod.center, Point(positions[group[i]])));
+        }
+
+        // niveau 0, le groupe initial
+        int first= int(lod_indices.size());
+        lod.levels.push_back( { first, n, 0 } );
+        lod_indices.insert(lod_indices.end(), group, group + n);
+        if(has_materials)
+            lod_materials.insert(lod_materials.end(), materials.begin() + groups[g].first / 3, materials.begin() + (groups[g].first + n) / 3);
+        triangles[0]+= n / 3;
+
+        std::vector<unsigned> level(group, group + n);
+        float error= 0;
+        for(int l= 1; l < max_levels; l++)
+        {
+            int target= int(level.size() / 3 * ratio) * 3;
+            float e= 0;
+            std::vector<unsigned> next= simplify_indices(positions, level.data(), int(level.size()), target, max_error * lod.radius, true, &e);
+            // pas assez simplifie, arrete la
+            if(next.empty() || next.size() > level.size() * 9 / 10)
+                break;
+
+            // majore l'erreur par rapport au niveau 0
+            error+= e;
+            lod.levels.push_back( { int(lod_indices.size()), int(next.size()), error } );
+            lod_indices.insert(lod_indices.end(), next.begin(), next.end());
+            if(has_materials)
+                for(unsigned i= 0; i < next.size(); i+= 3)
+                    lod_materials.push_back(vertex_materials[next[i]]);
+            triangles[1]+= int(next.size()) / 3;
+
+            std::swap(level, next);
+        }
+
+        groups[g].first= first;
+        groups[g].n= int(lod_indices.size()) - first;
+    }
+
+    printf("lods: %d groups, %d triangles, +%d triangles (%.1f%%)\n", int(groups.size()), triangles[0], triangles[1], 100.f * triangles[1] / std::max(1, triangles[0]));
+
+    // remplace les triangles, les sommets ne changent pas
+    mesh.indices(std::move(lod_indices));
+    if(has_materials)
+        mesh.material_indices(std::move(lod_materials));
+    return lods;
+}
+
+
+int select_lod( const MeshLod& lod, const Point& camera, const float pixels_per_unit, const float max_pixels )
+{
+    float d= distance(camera, lod.center) - lod.radius;
+    if(d <= 0)
+        return 0;
+
+    for(int l= int(lod.levels.size()) -1; l > 0; l--)
+        if(lod.levels[l].error * pixels_per_unit / d <= max_pixels)
+            return l;
+    return 0;
+}
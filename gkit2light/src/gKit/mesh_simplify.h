@@ -0,0 +1,59 @@
+
+#ifndef _MESH_SIMPLIFY_H
+#define _MESH_SIMPLIFY_H
+
+#include <vector>
+
+#include "vec.h"
+#include "mesh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! simplification de maillages indexes, quadriques d'erreur, et niveaux de details.
+
+/*! simplifie un index buffer, par fusion d'aretes, cf "Surface Simplification Using Quadric Error Metrics", M. Garland, P. Heckbert, 1997.
+    les sommets sont fusionnes sur des sommets existants : le resultat est un index buffer qui utilise les memes sommets, dans le meme vertex buffer.
+    les coutures (sommets a la meme position, mais avec d'autres attributs, texcoord, normale ou matiere) ne sont simplifiees que le long de la couture, les 2 cotes en meme temps.
+    lock_border : les bords ne sont pas modifies, les triangles voisins (dans un autre index buffer) restent raccordes.
+
+    target_index_count : nombre d'indices vise, target_error : erreur max (distance, dans le repere des positions).
+    renvoie le nouvel index buffer, et l'erreur atteinte dans error, si error n'est pas nul.
+ */
+std::vector<unsigned> simplify_indices( const std::vector<vec3>& positions, const unsigned *indices, const int index_count,
+    const int target_index_count, const float target_error, const bool lock_border= false, float *error= nullptr );
+
+
+//! niveau de detail : sequence de triangles dans l'index buffer.
+struct LodLevel
+{
+    int first;          //!< premier indice.
+    int n;              //!< nombre d'indices.
+    float error;        //!< erreur geometrique, par rapport au niveau 0, dans le repere des positions.
+};
+
+//! niveaux de details d'un groupe de triangles, du plus detaille au plus simple, + sphere englobante.
+struct MeshLod
+{
+    std::vector<LodLevel> levels;
+    Point center;
+    float radius;
+};
+
+/*! construit les niveaux de details de chaque groupe de triangles (cf Mesh::groups( )) d'un mesh indexe. chaque niveau a environ ratio fois moins de triangles que le precedent,
+    avec une erreur max de max_error * le rayon du groupe.
+    les niveaux sont ajoutes dans l'index buffer, apres les triangles du groupe, les groupes sont modifies et contiennent tous leurs niveaux,
+    le niveau 0 est le groupe initial. les bords des groupes ne sont pas modifies : les groupes voisins restent raccordes, quelque soit leur niveau.
+    les matieres des triangles sont conservees.
+ */
+std::vector<MeshLod> build_lods( Mesh& mesh, std::vector<TriangleGroup>& groups, const int max_levels= 4, const float ratio= 0.5f, const float max_error= 0.05f );
+
+/*! choisit le niveau le plus simple dont l'erreur projetee est inferieure a max_pixels.
+    pixels_per_unit : taille en pixels d'une longueur de 1 a une distance de 1 de la camera, cf `window_height() * projection.m[1][1] / 2` pour une projection perspective.
+ */
+int select_lod( const MeshLod& lod, const Point& camera, const float pixels_per_unit, const float max_pixels= 1 );
+
+///@}
+#endif
@@ -0,0 +1,388 @@
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "meshlet.h"
+#include "mesh_optimize.h"
+
+
+// etale les 10 bits de v, 2 bits a 0 entre chaque bit
+static
+uint32_t morton_spread( uint32_t v )
+{
+    v= (v | (v << 16)) & 0x030000FF;
+    v= (v | (v <<  8)) & 0x0300F00F;
+    v= (v | (v <<  4)) & 0x030C30C3;
+    v= (v | (v <<  2)) & 0x09249249;
+    return v;
+}
+
+
+void meshlet_bounds( const Mesh& mesh, Meshlet& meshlet )
+{
+    const std::vector<vec3>& positions= mesh.positions();
+    const std::vector<unsigned>& indices= mesh.indices();
+
+    // boite et sphere englobantes
+    Point pmin= Point(positions[indices[meshlet.first]]);
+    Point pmax= pmin;
+    for(int i= meshlet.first; i < meshlet.first + meshlet.n; i++)
+    {
+        pmin= min(pmin, Point(positions[indices[i]]));
+        pmax= max(pmax, Point(positions[indices[i]]));
+    }
+
+    meshlet.pmin= pmin;
+    meshlet.pmax= pmax;
+    meshlet.center= center(pmin, pmax);
+    meshlet.radius= 0;
+    for(int i= meshlet.first; i < meshlet.first + meshlet.n; i++)
+        meshlet.radius= std::max(meshlet.radius, distance(meshlet.center, Point(positions[indices[i]])));
+
+    // cone des normales, cf meshoptimizer, meshopt_computeClusterBounds( )
+    // l'axe du cone est la normale moyenne, son ouverture est l'angle max entre l'axe et les normales
+    meshlet.cone_apex= meshlet.center;
+    meshlet.cone_axis= Vector(0, 0, 0);
+    meshlet.cone_cutoff= 1;
+
+    Vector axis(0, 0, 0);
+    for(int i= meshlet.first; i +2 < meshlet.first + meshlet.n; i+= 3)
+    {
+        Vector n= cross(Point(positions[indices[i+1]]) - Point(positions[indices[i]]), Point(positions[indices[i+2]]) - Point(positions[indices[i]]));
+        if(length(n) > 0)
+            axis= axis + normalize(n);
+    }
+    if(length(axis) == 0)
+        return;
+    axis= normalize(axis);
+
+    float mindp= 1;
+    for(int i= meshlet.first; i +2 < meshlet.first + meshlet.n; i+= 3)
+    {
+        Vector n= cross(Point(positions[indices[i+1]]) - Point(positions[indices[i]]), Point(positions[indices[i+2]]) - Point(positions[indices[i]]));
+        if(length(n) > 0)
+            mindp= std::min(mindp, dot(normalize(n), axis));
+    }
+
+    // cone trop ouvert, pas de test
+    if(mindp <= 0.1f)
+        return;
+
+    // sommet du cone : recule le centre le long de l'axe, jusqu'a passer derriere le plan de tous les triangles
+    float maxt= 0;
+    for(int i= meshlet.first; i +2 < meshlet.first + meshlet.n; i+= 3)
+    {
+        Vector n= cross(Point(positions[indices[i+1]]) - Point(positions[indices[i]]), Point(positions[indices[i+2]]) - Point(positions[indices[i]]));
+        if(length(n) == 0)
+            continue;
+
+        n= normalize(n);
+        float dc= dot(meshlet.center - Point(positions[indices[i]]), n);
+        float dn= dot(axis, n);
+        maxt= std::max(maxt, dc / dn);
+    }
+
+    meshlet.cone_apex= meshlet.center - axis * maxt;
+    meshlet.cone_axis= axis;
+    // cos(angle + 90) du cone retourne = sin(angle)
+    meshlet.cone_cutoff= std::sqrt(1 - mindp * mindp);
+}
+
+
+std::vector<Meshlet> build_meshlets( Mesh& mesh, const std::vector<TriangleGroup>& _groups, const bool cones, const int max_vertices, const int max_triangles )
+{
+    if(mesh.primitives() != GL_TRIANGLES || mesh.indices().empty())
+    {
+        printf("[error] build_meshlets( ): indexed triangles only...\n");
+        return {};
+    }
+
+    const int triangle_count= mesh.triangle_count();
+    const int vertex_count= mesh.vertex_count();
+    const std::vector<vec3>& positions= mesh.positions();
+    const std::vector<unsigned>& indices= mesh.indices();
+
+    std::vector<TriangleGroup> groups= _groups;
+    if(groups.empty())
+        groups.push_back( {0, 0, 3*triangle_count} );
+
+    // triangles adjacents a chaque sommet
+    std::vector<int> offsets(vertex_count +1, 0);
+    for(int i= 0; i < 3*triangle_count; i++)
+        offsets[indices[i] +1]++;
+    for(int v= 0; v < vertex_count; v++)
+        offsets[v +1]+= offsets[v];
+
+    std::vector<int> adjacency(3*triangle_count);
+    {
+        std::vector<int> fill(offsets.begin(), offsets.end() -1);
+        for(int i= 0; i < 3*triangle_count; i++)
+            adjacency[fill[indices[i]]++]= i / 3;
+    }
+
+    // centre de chaque triangle, et direction principale de sa normale, si les cones sont utilises : les triangles d'un meshlet ont la meme direction principale,
+    // le cone des normales reste etroit, cf meshlet_bounds( ) et MeshletCuller::visible_cone( ). sinon, une seule direction, les meshlets sont plus gros
+    std::vector<Point> centers(triangle_count);
+    std::vector<unsigned char> directions(triangle_count, 0);
+    for(int t= 0; t < triangle_count; t++)
+    {
+        Point a= Point(positions[indices[3*t]]);
+        Point b= Point(positions[indices[3*t+1]]);
+        Point c= Point(positions[indices[3*t+2]]);
+        centers[t]= Point((Vector(a) + Vector(b) + Vector(c)) / 3);
+        if(!cones)
+            continue;
+
+        Vector n= cross(b - a, c - a);
+        Vector m(std::abs(n.x), std::abs(n.y), std::abs(n.z));
+        int axis= (m.x >= m.y && m.x >= m.z) ? 0 : (m.y >= m.z) ? 1 : 2;
+        directions[t]= (unsigned char) (2*axis + (n(axis) < 0));
+    }
+
+    std::vector<Meshlet> meshlets;
+    std::vector<unsigned> triangle_meshlets(triangle_count, 0);     // meshlet de chaque triangle
+    std::vector<char> used(triangle_count, 0);
+    std::vector<int> vertex_stamp(vertex_count, -1);                // meshlet en cours de construction qui utilise le sommet
+    std::vector<int> candidate_stamp(triangle_count, -1);           // meshlet en cours de construction qui a deja le triangle comme candidat
+    std::vector<int> candidates;
+    std::vector<std::pair<uint64_t, int>> codes;
+    std::vector<int> sequences;     // meshlet de chaque sequence de triangles, ou -1 pour les triangles hors des groupes
+
+    // les triangles hors des groupes gardent leur place
+    unsigned id= 0;
+    int next= 0;
+    for(unsigned g= 0; g < groups.size(); g++)
+    {
+        const int begin= groups[g].first / 3;
+        const int end= (groups[g].first + groups[g].n) / 3;
+        if(begin > next)
+        {
+            for(int t= next; t < begin; t++)
+                triangle_meshlets[t]= id;
+            sequences.push_back(-1);
+            id++;
+        }
+        next= end;
+        if(end <= begin)
+            continue;
+
+        // parcours les triangles du groupe par direction, puis dans l'ordre de morton
+        Point pmin= centers[begin];
+        Point pmax= centers[begin];
+        for(int t= begin; t < end; t++)
+        {
+            pmin= min(pmin, centers[t]);
+            pmax= max(pmax, centers[t]);
+        }
+
+        Vector extent= pmax - pmin;
+        float scale= 1023 / std::max(1e-8f, std::max(extent.x, std::max(extent.y, extent.z)));
+        codes.clear();
+        for(int t= begin; t < end; t++)
+        {
+            Vector q= (centers[t] - pmin) * scale;
+            uint32_t code= morton_spread(uint32_t(q.x)) | (morton_spread(uint32_t(q.y)) << 1) | (morton_spread(uint32_t(q.z)) << 2);
+            codes.push_back( std::make_pair((uint64_t(directions[t]) << 32) | code, t) );
+        }
+        std::sort(codes.begin(), codes.end());
+
+        unsigned cursor= 0;
+        for(;;)
+        {
+            while(cursor < codes.size() && used[codes[cursor].second])
+                cursor++;
+            if(cursor == codes.size())
+                break;
+
+            // nouveau meshlet
+            const int stamp= int(meshlets.size());
+            int vertices= 0;
+            int triangles= 0;
+            Vector sum(0, 0, 0);
+            candidates.clear();
+
+            int t= codes[cursor].second;
+            const int direction= directions[t];
+            for(;;)
+            {
+                // ajoute le triangle
+                used[t]= 1;
+                triangle_meshlets[t]= id;
+                triangles++;
+                sum= sum + Vector(centers[t]);
+                for(int k= 0; k < 3; k++)
+                {
+                    unsigned v= indices[3*t +k];
+                    if(vertex_stamp[v] != stamp)
+                    {
+                        vertex_stamp[v]= stamp;
+                        vertices++;
+                    }
+
+                    // et ses voisins comme candidats
+                    for(int a= offsets[v]; a < offsets[v +1]; a++)
+                    {
+                        int c= adjacency[a];
+                        if(c >= begin && c < end && !used[c] && candidate_stamp[c] != stamp && directions[c] == direction)
+                        {
+                            candidate_stamp[c]= stamp;
+                            candidates.push_back(c);
+                        }
+                    }
+                }
+
+                if(triangles >= max_triangles)
+                    break;
+
+                // choisit le candidat qui ajoute le moins de sommets, puis le plus proche
+                Point c= Point(sum / float(triangles));
+                int best= -1;
+                int best_new= 4;
+                float best_distance= 0;
+                unsigned k= 0;
+                for(unsigned i= 0; i < candidates.size(); i++)
+                {
+                    int b= candidates[i];
+                    if(used[b])
+                        continue;
+                    candidates[k++]= b;
+
+                    int n= (vertex_stamp[indices[3*b]] != stamp) + (vertex_stamp[indices[3*b+1]] != stamp) + (vertex_stamp[indices[3*b+2]] != stamp);
+                    if(vertices + n > max_vertices)
+                        continue;
+
+                    float d= distance2(c, centers[b]);
+                    if(n < best_new || (n == best_new && d < best_distance))
+                    {
+                        best= b;
+                        best_new= n;
+                        best_distance= d;
+                    }
+                }
+                candidates.resize(k);
+
+                if(best < 0 && candidates.empty())
+                {
+                    // pas de voisin : le triangle le plus proche, parmi les suivants dans l'ordre de morton
+                    int checked= 0;
+                    for(unsigned i= cursor; i < codes.size() && checked < 64; i++)
+                    {
+                        int b= codes[i].second;
+                        if(directions[b] != direction)
+                            break;
+                        if(used[b])
+                            continue;
+                        checked++;
+
+                        int n= (vertex_stamp[indices[3*b]] != stamp) + (vertex_stamp[indices[3*b+1]] != stamp) + (vertex_stamp[indices[3*b+2]] != stamp);
+                        if(vertices + n > max_vertices)
+                            continue;
+
+                        float d= distance2(c, centers[b]);
+                        if(best < 0 || d < best_distance)
+                        {
+                            best= b;
+                            best_distance= d;
+                        }
+                    }
+                }
+
+                if(best < 0)
+                    break;
+                t= best;
+            }
+
+            Meshlet meshlet;
+            meshlet.first= 0;
+            meshlet.n= 3*triangles;
+            meshlet.group= int(g);
+            meshlet.vertex_count= vertices;
+            sequences.push_back(int(meshlets.size()));
+            meshlets.push_back(meshlet);
+            id++;
+        }
+    }
+    if(triangle_count > next)
+    {
+        for(int t= next; t < triangle_count; t++)
+            triangle_meshlets[t]= id;
+        sequences.push_back(-1);
+        id++;
+    }
+
+    // re-ordonne les triangles, meshlet par meshlet, tri stable : les triangles d'un meshlet restent dans le meme ordre, cf Mesh::groups( )
+    std::vector<TriangleGroup> ranges= mesh.groups(triangle_meshlets);
+
+    // retrouve la position de chaque meshlet, et calcule ses englobants
+    for(unsigned i= 0; i < ranges.size(); i++)
+    {
+        int m= sequences[ranges[i].index];
+        if(m < 0)
+            continue;
+
+        meshlets[m].first= ranges[i].first;
+        meshlet_bounds(mesh, meshlets[m]);
+    }
+
+    // re-ordonne les triangles de chaque meshlet pour le cache de sommets : le decoupage detruit l'ordre construit par optimize_mesh( )
+    const int cache_size= 16;       // cf optimize_mesh( )
+    std::vector<unsigned> meshlet_indices= indices;
+    std::vector<unsigned> meshlet_materials= mesh.material_indices();
+    std::vector<int> clusters;
+    for(unsigned i= 0; i < meshlets.size(); i++)
+    {
+        const int first= meshlets[i].first / 3;
+        const int count= meshlets[i].n / 3;
+        std::vector<int> order= optimize_vertex_cache(indices.data() + 3*first, count, cache_size, clusters);
+        for(int k= 0; k < count; k++)
+        {
+            int t= first + order[k];
+            meshlet_indices[3*(first + k)]= indices[3*t];
+            meshlet_indices[3*(first + k) +1]= indices[3*t +1];
+            meshlet_indices[3*(first + k) +2]= indices[3*t +2];
+            if(!meshlet_materials.empty())
+                meshlet_materials[first + k]= mesh.material_indices()[t];
+        }
+    }
+    mesh.indices(std::move(meshlet_indices));
+    if(!meshlet_materials.empty())
+        mesh.material_indices(std::move(meshlet_materials));
+
+    double vertices= 0;
+    int triangles= 0;
+    std::vector<unsigned> drawn;        // indices des meshlets, dessines par l'application
+    for(unsigned i= 0; i < meshlets.size(); i++)
+    {
+        vertices+= meshlets[i].vertex_count;
+        triangles+= meshlets[i].n / 3;
+        drawn.insert(drawn.end(), mesh.indices().begin() + meshlets[i].first, mesh.indices().begin() + meshlets[i].first + meshlets[i].n);
+    }
+    if(!meshlets.empty())
+    {
+        VertexCacheStats stats= vertex_cache_stats(drawn, vertex_count, cache_size);
+        printf("meshlets: %d meshlets, %.1f triangles / meshlet, %.1f vertices / meshlet, acmr %.3f atvr %.3f\n",
+            int(meshlets.size()), float(triangles) / float(meshlets.size()), float(vertices / meshlets.size()), stats.acmr, stats.atvr);
+    }
+    return meshlets;
+}
+
+
+bool MeshletCuller::visible_frustum( const Meshlet& meshlet ) const
+{
+    return visible(meshlet.center, meshlet.radius);
+}
+
+bool MeshletCuller::visible_cone( const Meshlet& meshlet ) const
+{
+    if(meshlet.cone_cutoff >= 1)
+        return true;
+
+    Vector d= meshlet.cone_apex - camera;
+    float l= length(d);
+    if(l == 0)
+        return true;
+    return dot(d, meshlet.cone_axis) < meshlet.cone_cutoff * l;
+}
@@ -0,0 +1,70 @@
+
+#ifndef _MESHLET_H
+#define _MESHLET_H
+
+#include <vector>
+
+#include "vec.h"
+#include "mat.h"
+#include "mesh.h"
+#include "frustum.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! decoupe un mesh indexe en petits groupes de triangles voisins, les meshlets, et elimine les meshlets invisibles : en dehors du frustum ou orientes vers l'arriere.
+
+//! meshlet : sequence de triangles voisins dans l'index buffer, au plus 64 sommets et 124 triangles, + englobants.
+struct Meshlet
+{
+    int first;              //!< premier indice du meshlet dans l'index buffer.
+    int n;                  //!< nombre d'indices, 3 par triangle.
+    int group;              //!< indice du groupe de triangles qui contient le meshlet.
+    int vertex_count;       //!< nombre de sommets du meshlet.
+
+    Point pmin;             //!< boite englobante.
+    Point pmax;
+    Point center;           //!< sphere englobante.
+    float radius;
+
+    /*! cone des normales des triangles : tous les triangles sont orientes vers l'arriere, vus depuis camera, si
+        `dot(normalize(cone_apex - camera), cone_axis) >= cone_cutoff`. cone_cutoff= 1 si le cone est trop ouvert, le test echoue toujours.
+     */
+    Point cone_apex;
+    Vector cone_axis;
+    float cone_cutoff;
+};
+
+/*! decoupe chaque groupe de triangles d'un mesh indexe (cf Mesh::groups( )) en meshlets, et re-ordonne les triangles de chaque groupe : les triangles d'un meshlet sont contigus dans l'index buffer,
+    et re-ordonnes pour le cache de sommets, cf optimize_vertex_cache( ).
+    les groupes restent valides. les meshlets sont construits en ajoutant les triangles voisins qui ajoutent le moins de sommets, puis les plus proches.
+    cones : les triangles d'un meshlet ont la meme orientation principale, pour garder des cones des normales etroits, cf MeshletCuller::visible_cone( ). les meshlets sont plus petits.
+    renvoie les meshlets, dans l'ordre des groupes. si groups est vide, tous les triangles forment un seul groupe.
+ */
+std::vector<Meshlet> build_meshlets( Mesh& mesh, const std::vector<TriangleGroup>& groups, const bool cones= false, const int max_vertices= 64, const int max_triangles= 124 );
+
+//! calcule les englobants d'un meshlet, first et n doivent etre initialises.
+void meshlet_bounds( const Mesh& mesh, Meshlet& meshlet );
+
+
+//! test de visibilite des meshlets : frustum de la camera et cone des normales.
+struct MeshletCuller : public Frustum
+{
+    //! construit les 6 plans du frustum, cf Frustum.
+    MeshletCuller( const Transform& view, const Transform& projection ) : Frustum(view, projection) {}
+
+    //! renvoie vrai si la sphere englobante du meshlet touche le frustum.
+    bool visible_frustum( const Meshlet& meshlet ) const;
+    /*! renvoie vrai si au moins un triangle du meshlet peut etre oriente vers la camera.
+        uniquement si les faces arrieres ne sont pas dessinees, cf glEnable(GL_CULL_FACE), et sans matieres double face ou alpha test, visibles des 2 cotes.
+     */
+    bool visible_cone( const Meshlet& meshlet ) const;
+    //! renvoie vrai si le meshlet est (peut etre) visible. cone : utilise aussi le cone des normales, cf visible_cone( ).
+    bool visible( const Meshlet& meshlet, const bool cone= false ) const { return visible_frustum(meshlet) && (!cone || visible_cone(meshlet)); }
+    using Frustum::visible;
+};
+
+///@}
+#endif
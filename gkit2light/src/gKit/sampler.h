@@ -0,0 +1,208 @@
+//! \file sampler.h
+
+#ifndef _SAMPLER_H
+#define _SAMPLER_H
+
+#include <cstdint>
+#include <cassert>
+
+#include "rng.h"
+#include "pcg.h"
+#include "rand123.h"
+
+
+/*! generateur de nombres aleatoires sans etat partage : chaque echantillon d'un pixel correspond a une sequence independante et reproductible.
+    le resultat ne depend que de la graine, du pixel et de l'indice de l'echantillon, pas de l'ordre de calcul ni du nombre de threads.
+
+    la position dans la sequence de RNG est construite directement a partir du pixel et de l'echantillon, cf RNG::index( ) :
+    32 bits pour le pixel, 20 bits pour l'echantillon (1M echantillons par pixel) et 12 bits pour les nombres aleatoires d'un echantillon (4096 par echantillon).
+
+    RNG doit fournir index( ) avec un indice sur 64 bits : Philox, Philox32, Threefry, PCG32, RNG64.
+    \code
+    PixelSampler sampler(seed);
+    for(int i= 0; i < N; i++)
+    {
+        sampler.index(y * width + x, i);
+        float u1= sampler.sample();
+        float u2= sampler.sample();
+        ...
+    }
+    \endcode
+ */
+template< typename RNG >
+struct PixelSamplerT
+{
+    static constexpr int sample_bits= 20;
+    static constexpr int dimension_bits= 12;
+
+    PixelSamplerT( ) : rng() {}
+    PixelSamplerT( const uint64_t seed ) : rng(seed) {}
+
+    //! se place au debut de la sequence de l'echantillon sample du pixel.
+    PixelSamplerT& index( const unsigned pixel, const unsigned sample )
+    {
+        assert(sample < (1u << sample_bits));
+        rng.index( (uint64_t(pixel) << 32) | (uint64_t(sample) << dimension_bits) );
+        return *this;
+    }
+
+    //! renvoie un reel aleatoire uniforme entre 0 et 1 (exclus).
+    float sample( ) { return float(rng.sample() >> 8) * (1.f / 16777216.f); }   // 24 bits de mantisse, 2^-24
+
+    //! renvoie un entier aleatoire uniforme entre 0 et range (exclus).
+    unsigned sample_range( const unsigned range ) { return rng.sample_range(range); }
+
+    RNG rng;
+};
+
+//! sequences counter based, cf rand123.h
+typedef PixelSamplerT<Philox> PixelSampler;
+//! sequences pcg, cf pcg.h
+typedef PixelSamplerT<PCG32> PixelSamplerPCG;
+
+
+//! fonctions utilitaires des sequences a faible discrepance.
+namespace sequence
+{
+    //! inverse l'ordre des bits.
+    inline uint32_t reverse_bits( uint32_t x )
+    {
+        x= ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x= ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x= ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x= ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+    
+    //! hachage d'un entier, cf https://nullprogram.com/blog/2018/07/31/
+    inline uint32_t hash( uint32_t x )
+    {
+        x^= x >> 16;
+        x*= 0x7feb352du;
+        x^= x >> 15;
+        x*= 0x846ca68bu;
+        x^= x >> 16;
+        return x;
+    }
+    
+    //! combine 2 valeurs hachees.
+    inline uint32_t hash_combine( const uint32_t seed, const uint32_t v )
+    {
+        return seed ^ (v + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+    }
+    
+    /*! brouillage de Owen, permute les intervalles dyadiques, cf "Practical Hash-based Owen Scrambling", B. Burley, 2020
+        https://jcgt.org/published/0009/04/01/
+     */
+    inline uint32_t owen_scramble( uint32_t x, const uint32_t seed )
+    {
+        x= reverse_bits(x);
+        // Laine-Karras, version Burley
+        x^= x * 0x3d20adeau;
+        x+= seed;
+        x*= (seed >> 16) | 1;
+        x^= x * 0x05526c56u;
+        x^= x * 0x53a22864u;
+        return reverse_bits(x);
+    }
+    
+    //! 2 premieres dimensions de la sequence de Sobol, brouillees par Owen. l'indice est aussi brouille : chaque pixel utilise un sous-ensemble different de la sequence.
+    struct Sobol
+    {
+        static void point( const uint32_t index, const uint32_t seed, uint32_t& x, uint32_t& y )
+        {
+            uint32_t i= owen_scramble(index, seed);
+            
+            // dimension 0 : van der Corput, dimension 1 : polynome x + 1
+            uint32_t sx= reverse_bits(i);
+            uint32_t sy= 0;
+            for(uint32_t v= 1u << 31; i; i>>= 1, v^= v >> 1)
+                if(i & 1)
+                    sy^= v;
+            
+            x= owen_scramble(sx, hash_combine(seed, 0xa511e9b3u));
+            y= owen_scramble(sy, hash_combine(seed, 0x63d83595u));
+        }
+    };
+    
+    //! sequence R2, cf "The Unreasonable Effectiveness of Quasirandom Sequences", M. Roberts, 2018. decalage aleatoire (Cranley-Patterson) par pixel.
+    //! http://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
+    struct R2
+    {
+        static void point( const uint32_t index, const uint32_t seed, uint32_t& x, uint32_t& y )
+        {
+            // 2^32 / g et 2^32 / g^2, g= 1.32471795724474602596, nombre plastique, calcul modulo 2^32 en virgule fixe
+            x= hash(seed) + index * 0xc13fa9a9u;
+            y= hash(seed ^ 0x68e31da4u) + index * 0x91e10da5u;
+        }
+    };
+}
+
+/*! sequences a faible discrepance, meme interface que PixelSamplerT : index(pixel, sample) puis sample( ) pour chaque dimension.
+    les dimensions sont utilisees par paires, chaque paire est un point 2d de la sequence, brouille differemment pour chaque pixel et chaque paire.
+    utiliser les 2 dimensions d'une paire pour la meme decision, par exemple une direction (u1, u2), donne de meilleurs resultats.
+    
+    \code
+    SobolSampler sampler(seed);
+    for(int i= 0; i < N; i++)
+    {
+        sampler.index(y * width + x, i);
+        float u1= sampler.sample();
+        float u2= sampler.sample();
+        ...
+    }
+    \endcode
+ */
+template< typename Sequence >
+struct SequenceSamplerT
+{
+    SequenceSamplerT( ) : m_seed(0), m_pixel(0), m_sample(0), m_dimension(0), m_y(0) {}
+    SequenceSamplerT( const uint64_t seed ) : m_seed(sequence::hash(uint32_t(seed) ^ sequence::hash(uint32_t(seed >> 32)))), m_pixel(0), m_sample(0), m_dimension(0), m_y(0) {}
+    
+    //! se place au debut de l'echantillon sample du pixel.
+    SequenceSamplerT& index( const unsigned pixel, const unsigned sample )
+    {
+        m_pixel= sequence::hash_combine(m_seed, sequence::hash(pixel));
+        m_sample= sample;
+        m_dimension= 0;
+        return *this;
+    }
+    
+    //! renvoie la dimension suivante de l'echantillon, reel entre 0 et 1 (exclus).
+    float sample( )
+    {
+        if(m_dimension & 1)
+        {
+            m_dimension++;
+            return to_float(m_y);
+        }
+        
+        uint32_t x;
+        Sequence::point(m_sample, sequence::hash_combine(m_pixel, sequence::hash(m_dimension)), x, m_y);
+        m_dimension++;
+        return to_float(x);
+    }
+    
+    //! renvoie un entier entre 0 et range (exclus).
+    unsigned sample_range( const unsigned range )
+    {
+        unsigned x= unsigned(sample() * range);
+        return (x < range) ? x : range -1;
+    }
+    
+protected:
+    static float to_float( const uint32_t x ) { return float(x >> 8) * (1.f / 16777216.f); }   // 24 bits de mantisse, 2^-24
+    
+    uint32_t m_seed;
+    uint32_t m_pixel;
+    uint32_t m_sample;
+    uint32_t m_dimension;
+    uint32_t m_y;
+};
+
+//! sequence de Sobol brouillee par Owen.
+typedef SequenceSamplerT<sequence::Sobol> SobolSampler;
+//! sequence R2, decalee par pixel.
+typedef SequenceSamplerT<sequence::R2> R2Sampler;
+
+#endif
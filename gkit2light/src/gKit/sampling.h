@@ -0,0 +1,110 @@
+//! \file sampling.h directions aleatoires sur l'hemisphere, repere local d'une surface.
+
+#ifndef _SAMPLING_H
+#define _SAMPLING_H
+
+#include <cmath>
+#include <algorithm>
+
+#include "vec.h"
+
+
+//! \addtogroup math
+///@{
+
+/*! repere local d'une surface, construit a partir de la normale, la normale est l'axe z.
+    cf "generating a consistently oriented tangent space"
+    http://people.compute.dtu.dk/jerf/papers/abstracts/onb.html
+
+    \code
+    World world(n);
+    Vector l= world( sample_cosine_hemisphere(u1, u2) );     // direction dans le repere du monde
+    \endcode
+ */
+struct World
+{
+    World( const Vector& _n ) : n(_n)
+    {
+        if(n.z < -0.9999999f)
+        {
+            t= Vector(0, -1, 0);
+            b= Vector(-1, 0, 0);
+        }
+        else
+        {
+            float a= 1.f / (1.f + n.z);
+            float d= -n.x * n.y * a;
+            t= Vector(1.f - n.x * n.x * a, d, -n.x);
+            b= Vector(d, 1.f - n.y * n.y * a, -n.y);
+        }
+    }
+
+    //! transforme une direction du repere local vers le repere du monde.
+    Vector operator( ) ( const Vector& local )  const
+    {
+        return local.x * t + local.y * b + local.z * n;
+    }
+
+    //! transforme une direction du repere du monde vers le repere local.
+    Vector inverse( const Vector& global ) const
+    {
+        return Vector(dot(global, t), dot(global, b), dot(global, n));
+    }
+
+    Vector t;
+    Vector b;
+    Vector n;
+};
+
+
+//! \name directions dans le repere local, z est la normale. u1, u2 uniformes entre 0 et 1.
+//@{
+
+//! direction uniforme sur l'hemisphere.
+inline Vector sample_uniform_hemisphere( const float u1, const float u2 )
+{
+    float cos_theta= u1;
+    float sin_theta= std::sqrt(std::max(0.f, 1 - cos_theta * cos_theta));
+    float phi= float(2 * M_PI) * u2;
+    return Vector(std::cos(phi) * sin_theta, std::sin(phi) * sin_theta, cos_theta);
+}
+
+//! densite de sample_uniform_hemisphere( ).
+inline float pdf_uniform_hemisphere( )
+{
+    return float(1 / (2 * M_PI));
+}
+
+//! direction sur l'hemisphere, densite proportionnelle a cos theta.
+inline Vector sample_cosine_hemisphere( const float u1, const float u2 )
+{
+    float cos_theta= std::sqrt(1 - u1);
+    float sin_theta= std::sqrt(u1);
+    float phi= float(2 * M_PI) * u2;
+    return Vector(std::cos(phi) * sin_theta, std::sin(phi) * sin_theta, cos_theta);
+}
+
+//! densite de sample_cosine_hemisphere( ), cos theta / pi.
+inline float pdf_cosine_hemisphere( const float cos_theta )
+{
+    return (cos_theta > 0) ? cos_theta / float(M_PI) : 0;
+}
+
+//! direction sur l'hemisphere, densite proportionnelle a cos^n theta, cf reflets blinn-phong.
+inline Vector sample_cosine_power_hemisphere( const float n, const float u1, const float u2 )
+{
+    float cos_theta= std::pow(u1, 1 / (n + 1));
+    float sin_theta= std::sqrt(std::max(0.f, 1 - cos_theta * cos_theta));
+    float phi= float(2 * M_PI) * u2;
+    return Vector(std::cos(phi) * sin_theta, std::sin(phi) * sin_theta, cos_theta);
+}
+
+//! densite de sample_cosine_power_hemisphere( ), (n + 1) / 2pi cos^n theta.
+inline float pdf_cosine_power_hemisphere( const float n, const float cos_theta )
+{
+    return (cos_theta > 0) ? (n + 1) / float(2 * M_PI) * std::pow(cos_theta, n) : 0;
+}
+//@}
+
+///@}
+#endif
@@ -0,0 +1,405 @@
+//! \file simd_triangles.h intersection rayon / triangles par paquets de 8, organisation SoA, versions avx2, sse et scalaire.
+
+#ifndef _SIMD_TRIANGLES_H
+#define _SIMD_TRIANGLES_H
+
+#include <vector>
+#include <cfloat>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define GK_SSE 1
+#endif
+
+#include "bvh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+/*! paquet de 8 triangles, organisation SoA : les coordonnees des 8 triangles sont rangees dans des tableaux separes.
+    les triangles inutilises ont des aretes nulles, et un indice -1, ils ne sont jamais intersectes.
+ */
+struct TriangleBlock
+{
+    float px[8], py[8], pz[8];          // sommets a
+    float e1x[8], e1y[8], e1z[8];       // aretes ab
+    float e2x[8], e2y[8], e2z[8];       // aretes ac
+    int id[8];                          // indices des triangles
+};
+
+//! paquet de 8 rayons, organisation SoA.
+struct RayBlock
+{
+    float ox[8], oy[8], oz[8];          // origines
+    float dx[8], dy[8], dz[8];          // directions
+
+    //! place le rayon i dans le paquet.
+    void set( const int i, const Ray& ray )
+    {
+        ox[i]= ray.o.x; oy[i]= ray.o.y; oz[i]= ray.o.z;
+        dx[i]= ray.d.x; dy[i]= ray.d.y; dz[i]= ray.d.z;
+    }
+};
+
+/*! intersections d'un paquet : 1 intersection par rayon pour un paquet de rayons, ou 1 intersection par triangle pour un paquet de triangles.
+    t est aussi l'extremite du rayon, initialiser avec tmax avant les tests.
+ */
+struct HitBlock
+{
+    float t[8];
+    float u[8], v[8];
+    int triangle_id[8];
+
+    HitBlock( ) { reset(FLT_MAX); }
+    HitBlock( const float htmax ) { reset(htmax); }
+
+    //! pas d'intersection, extremite des rayons a htmax.
+    void reset( const float htmax )
+    {
+        for(int i= 0; i < 8; i++)
+        {
+            t[i]= htmax;
+            u[i]= 0; v[i]= 0;
+            triangle_id[i]= -1;
+        }
+    }
+
+    //! renvoie l'intersection i.
+    Hit hit( const int i ) const { return (triangle_id[i] == -1) ? Hit() : Hit(t[i], u[i], v[i], triangle_id[i]); }
+
+    //! renvoie l'intersection la plus proche, pour un paquet de triangles.
+    Hit closest( ) const
+    {
+        int k= -1;
+        for(int i= 0; i < 8; i++)
+            if(triangle_id[i] != -1 && (k == -1 || t[i] < t[k]))
+                k= i;
+
+        return (k == -1) ? Hit() : hit(k);
+    }
+
+    //! renvoie vrai si au moins une intersection.
+    bool any( ) const
+    {
+        for(int i= 0; i < 8; i++)
+            if(triangle_id[i] != -1)
+                return true;
+        return false;
+    }
+};
+
+
+//! \name intersection 1 rayon / 8 triangles. ne conserve que les intersections plus proches que hits.t.
+//@{
+
+//! version scalaire, meme test que Triangle::intersect( ).
+inline void intersect_scalar( const TriangleBlock& block, const Ray& ray, HitBlock& hits )
+{
+    for(int i= 0; i < 8; i++)
+    {
+        Vector e1(block.e1x[i], block.e1y[i], block.e1z[i]);
+        Vector e2(block.e2x[i], block.e2y[i], block.e2z[i]);
+
+        Vector pvec= cross(ray.d, e2);
+        float det= dot(e1, pvec);
+        float inv_det= 1 / det;
+        Vector tvec(Point(block.px[i], block.py[i], block.pz[i]), ray.o);
+
+        // comparaisons "positives", les triangles degeneres (det == 0, nan) ne sont jamais intersectes
+        float u= dot(tvec, pvec) * inv_det;
+        if(!(u >= 0 && u <= 1)) continue;
+
+        Vector qvec= cross(tvec, e1);
+        float v= dot(ray.d, qvec) * inv_det;
+        if(!(v >= 0 && u + v <= 1)) continue;
+
+        float t= dot(e2, qvec) * inv_det;
+        if(t >= 0 && t <= hits.t[i])
+        {
+            hits.t[i]= t;
+            hits.u[i]= u;
+            hits.v[i]= v;
+            hits.triangle_id[i]= block.id[i];
+        }
+    }
+}
+
+//! version scalaire, 8 rayons / 1 triangle. ne conserve que les intersections plus proches que hits.t.
+inline void intersect_scalar( const Triangle& triangle, const RayBlock& rays, HitBlock& hits )
+{
+    for(int i= 0; i < 8; i++)
+    {
+        Vector d(rays.dx[i], rays.dy[i], rays.dz[i]);
+
+        Vector pvec= cross(d, triangle.e2);
+        float det= dot(triangle.e1, pvec);
+        float inv_det= 1 / det;
+        Vector tvec(triangle.p, Point(rays.ox[i], rays.oy[i], rays.oz[i]));
+
+        float u= dot(tvec, pvec) * inv_det;
+        if(!(u >= 0 && u <= 1)) continue;
+
+        Vector qvec= cross(tvec, triangle.e1);
+        float v= dot(d, qvec) * inv_det;
+        if(!(v >= 0 && u + v <= 1)) continue;
+
+        float t= dot(triangle.e2, qvec) * inv_det;
+        if(t >= 0 && t <= hits.t[i])
+        {
+            hits.t[i]= t;
+            hits.u[i]= u;
+            hits.v[i]= v;
+            hits.triangle_id[i]= triangle.id;
+        }
+    }
+}
+//@}
+
+
+#ifdef GK_SSE
+namespace sse
+{
+    // 4 lanes, meme calcul que la version scalaire, dans le meme ordre
+    inline void intersect4( const __m128 ox, const __m128 oy, const __m128 oz, const __m128 dx, const __m128 dy, const __m128 dz,
+        const __m128 px, const __m128 py, const __m128 pz,
+        const __m128 e1x, const __m128 e1y, const __m128 e1z, const __m128 e2x, const __m128 e2y, const __m128 e2z, const __m128 id,
+        float *ht, float *hu, float *hv, int *hid )
+    {
+        // pvec= cross(d, e2)
+        __m128 pvx= _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 pvy= _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pvz= _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        // det= dot(e1, pvec)
+        __m128 det= _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, pvx), _mm_mul_ps(e1y, pvy)), _mm_mul_ps(e1z, pvz));
+        __m128 inv_det= _mm_div_ps(_mm_set1_ps(1), det);
+        // tvec= o - p
+        __m128 tx= _mm_sub_ps(ox, px);
+        __m128 ty= _mm_sub_ps(oy, py);
+        __m128 tz= _mm_sub_ps(oz, pz);
+        __m128 u= _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, pvx), _mm_mul_ps(ty, pvy)), _mm_mul_ps(tz, pvz)), inv_det);
+        // qvec= cross(tvec, e1)
+        __m128 qx= _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+        __m128 qy= _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+        __m128 qz= _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+        __m128 v= _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv_det);
+        __m128 t= _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv_det);
+
+        __m128 zero= _mm_setzero_ps();
+        __m128 one= _mm_set1_ps(1);
+        __m128 tmax= _mm_loadu_ps(ht);
+        __m128 mask= _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one));
+        mask= _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+        mask= _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+        mask= _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+        mask= _mm_and_ps(mask, _mm_cmple_ps(t, tmax));
+        if(_mm_movemask_ps(mask) == 0)
+            return;
+
+        // select(mask, a, b), sans sse4.1
+        #define GK_SELECT(m, a, b) _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+        _mm_storeu_ps(ht, GK_SELECT(mask, t, tmax));
+        _mm_storeu_ps(hu, GK_SELECT(mask, u, _mm_loadu_ps(hu)));
+        _mm_storeu_ps(hv, GK_SELECT(mask, v, _mm_loadu_ps(hv)));
+        _mm_storeu_ps((float *) hid, GK_SELECT(mask, id, _mm_loadu_ps((const float *) hid)));
+        #undef GK_SELECT
+    }
+}
+
+//! version sse, 1 rayon / 8 triangles, 2 x 4 triangles.
+inline void intersect_sse( const TriangleBlock& block, const Ray& ray, HitBlock& hits )
+{
+    __m128 ox= _mm_set1_ps(ray.o.x), oy= _mm_set1_ps(ray.o.y), oz= _mm_set1_ps(ray.o.z);
+    __m128 dx= _mm_set1_ps(ray.d.x), dy= _mm_set1_ps(ray.d.y), dz= _mm_set1_ps(ray.d.z);
+    for(int i= 0; i < 8; i+= 4)
+        sse::intersect4(ox, oy, oz, dx, dy, dz,
+            _mm_loadu_ps(block.px +i), _mm_loadu_ps(block.py +i), _mm_loadu_ps(block.pz +i),
+            _mm_loadu_ps(block.e1x +i), _mm_loadu_ps(block.e1y +i), _mm_loadu_ps(block.e1z +i),
+            _mm_loadu_ps(block.e2x +i), _mm_loadu_ps(block.e2y +i), _mm_loadu_ps(block.e2z +i),
+            _mm_loadu_ps((const float *) block.id +i),
+            hits.t +i, hits.u +i, hits.v +i, hits.triangle_id +i);
+}
+
+//! version sse, 8 rayons / 1 triangle, 2 x 4 rayons.
+inline void intersect_sse( const Triangle& triangle, const RayBlock& rays, HitBlock& hits )
+{
+    int id= triangle.id;
+    __m128 px= _mm_set1_ps(triangle.p.x), py= _mm_set1_ps(triangle.p.y), pz= _mm_set1_ps(triangle.p.z);
+    __m128 e1x= _mm_set1_ps(triangle.e1.x), e1y= _mm_set1_ps(triangle.e1.y), e1z= _mm_set1_ps(triangle.e1.z);
+    __m128 e2x= _mm_set1_ps(triangle.e2.x), e2y= _mm_set1_ps(triangle.e2.y), e2z= _mm_set1_ps(triangle.e2.z);
+    __m128 ids= _mm_castsi128_ps(_mm_set1_epi32(id));
+    for(int i= 0; i < 8; i+= 4)
+        sse::intersect4(
+            _mm_loadu_ps(rays.ox +i), _mm_loadu_ps(rays.oy +i), _mm_loadu_ps(rays.oz +i),
+            _mm_loadu_ps(rays.dx +i), _mm_loadu_ps(rays.dy +i), _mm_loadu_ps(rays.dz +i),
+            px, py, pz, e1x, e1y, e1z, e2x, e2y, e2z, ids,
+            hits.t +i, hits.u +i, hits.v +i, hits.triangle_id +i);
+}
+#endif
+
+
+#ifdef __AVX2__
+namespace avx2
+{
+    // 8 lanes, meme calcul que la version scalaire, dans le meme ordre
+    inline void intersect8( const __m256 ox, const __m256 oy, const __m256 oz, const __m256 dx, const __m256 dy, const __m256 dz,
+        const __m256 px, const __m256 py, const __m256 pz,
+        const __m256 e1x, const __m256 e1y, const __m256 e1z, const __m256 e2x, const __m256 e2y, const __m256 e2z, const __m256 id,
+        HitBlock& hits )
+    {
+        __m256 pvx= _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+        __m256 pvy= _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+        __m256 pvz= _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+        __m256 det= _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, pvx), _mm256_mul_ps(e1y, pvy)), _mm256_mul_ps(e1z, pvz));
+        __m256 inv_det= _mm256_div_ps(_mm256_set1_ps(1), det);
+        __m256 tx= _mm256_sub_ps(ox, px);
+        __m256 ty= _mm256_sub_ps(oy, py);
+        __m256 tz= _mm256_sub_ps(oz, pz);
+        __m256 u= _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, pvx), _mm256_mul_ps(ty, pvy)), _mm256_mul_ps(tz, pvz)), inv_det);
+        __m256 qx= _mm256_sub_ps(_mm256_mul_ps(ty, e1z), _mm256_mul_ps(tz, e1y));
+        __m256 qy= _mm256_sub_ps(_mm256_mul_ps(tz, e1x), _mm256_mul_ps(tx, e1z));
+        __m256 qz= _mm256_sub_ps(_mm256_mul_ps(tx, e1y), _mm256_mul_ps(ty, e1x));
+        __m256 v= _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), inv_det);
+        __m256 t= _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), inv_det);
+
+        __m256 zero= _mm256_setzero_ps();
+        __m256 one= _mm256_set1_ps(1);
+        __m256 tmax= _mm256_loadu_ps(hits.t);
+        __m256 mask= _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+        mask= _mm256_and_ps(mask, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+        mask= _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+        mask= _mm256_and_ps(mask, _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+        mask= _mm256_and_ps(mask, _mm256_cmp_ps(t, tmax, _CMP_LE_OQ));
+        if(_mm256_movemask_ps(mask) == 0)
+            return;
+
+        _mm256_storeu_ps(hits.t, _mm256_blendv_ps(tmax, t, mask));
+        _mm256_storeu_ps(hits.u, _mm256_blendv_ps(_mm256_loadu_ps(hits.u), u, mask));
+        _mm256_storeu_ps(hits.v, _mm256_blendv_ps(_mm256_loadu_ps(hits.v), v, mask));
+        _mm256_storeu_ps((float *) hits.triangle_id, _mm256_blendv_ps(_mm256_loadu_ps((const float *) hits.triangle_id), id, mask));
+    }
+}
+
+//! version avx2, 1 rayon / 8 triangles.
+inline void intersect_avx2( const TriangleBlock& block, const Ray& ray, HitBlock& hits )
+{
+    avx2::intersect8(
+        _mm256_set1_ps(ray.o.x), _mm256_set1_ps(ray.o.y), _mm256_set1_ps(ray.o.z),
+        _mm256_set1_ps(ray.d.x), _mm256_set1_ps(ray.d.y), _mm256_set1_ps(ray.d.z),
+        _mm256_loadu_ps(block.px), _mm256_loadu_ps(block.py), _mm256_loadu_ps(block.pz),
+        _mm256_loadu_ps(block.e1x), _mm256_loadu_ps(block.e1y), _mm256_loadu_ps(block.e1z),
+        _mm256_loadu_ps(block.e2x), _mm256_loadu_ps(block.e2y), _mm256_loadu_ps(block.e2z),
+        _mm256_loadu_ps((const float *) block.id),
+        hits);
+}
+
+//! version avx2, 8 rayons / 1 triangle.
+inline void intersect_avx2( const Triangle& triangle, const RayBlock& rays, HitBlock& hits )
+{
+    avx2::intersect8(
+        _mm256_loadu_ps(rays.ox), _mm256_loadu_ps(rays.oy), _mm256_loadu_ps(rays.oz),
+        _mm256_loadu_ps(rays.dx), _mm256_loadu_ps(rays.dy), _mm256_loadu_ps(rays.dz),
+        _mm256_set1_ps(triangle.p.x), _mm256_set1_ps(triangle.p.y), _mm256_set1_ps(triangle.p.z),
+        _mm256_set1_ps(triangle.e1.x), _mm256_set1_ps(triangle.e1.y), _mm256_set1_ps(triangle.e1.z),
+        _mm256_set1_ps(triangle.e2.x), _mm256_set1_ps(triangle.e2.y), _mm256_set1_ps(triangle.e2.z),
+        _mm256_castsi256_ps(_mm256_set1_epi32(triangle.id)),
+        hits);
+}
+#endif
+
+
+//! \name meilleure version disponible a la compilation : avx2, sse ou scalaire.
+//@{
+inline void intersect( const TriangleBlock& block, const Ray& ray, HitBlock& hits )
+{
+#if defined(__AVX2__)
+    intersect_avx2(block, ray, hits);
+#elif defined(GK_SSE)
+    intersect_sse(block, ray, hits);
+#else
+    intersect_scalar(block, ray, hits);
+#endif
+}
+
+inline void intersect( const Triangle& triangle, const RayBlock& rays, HitBlock& hits )
+{
+#if defined(__AVX2__)
+    intersect_avx2(triangle, rays, hits);
+#elif defined(GK_SSE)
+    intersect_sse(triangle, rays, hits);
+#else
+    intersect_scalar(triangle, rays, hits);
+#endif
+}
+//@}
+
+
+//! ensemble de triangles, organisation SoA, par paquets de 8.
+struct TriangleSoA
+{
+    TriangleSoA( ) : blocks(), count(0) {}
+    TriangleSoA( const std::vector<Triangle>& triangles ) : blocks(), count(0) { build(triangles); }
+
+    //! re-organise les triangles par paquets de 8. le dernier paquet est complete par des triangles degeneres.
+    void build( const std::vector<Triangle>& triangles )
+    {
+        count= int(triangles.size());
+        blocks.assign((count + 7) / 8, TriangleBlock());
+        for(int i= 0; i < int(blocks.size()) * 8; i++)
+        {
+            TriangleBlock& block= blocks[i / 8];
+            int k= i % 8;
+            if(i < count)
+            {
+                const Triangle& triangle= triangles[i];
+                block.px[k]= triangle.p.x; block.py[k]= triangle.p.y; block.pz[k]= triangle.p.z;
+                block.e1x[k]= triangle.e1.x; block.e1y[k]= triangle.e1.y; block.e1z[k]= triangle.e1.z;
+                block.e2x[k]= triangle.e2.x; block.e2y[k]= triangle.e2.y; block.e2z[k]= triangle.e2.z;
+                block.id[k]= triangle.id;
+            }
+            else
+            {
+                block.px[k]= 0; block.py[k]= 0; block.pz[k]= 0;
+                block.e1x[k]= 0; block.e1y[k]= 0; block.e1z[k]= 0;
+                block.e2x[k]= 0; block.e2y[k]= 0; block.e2z[k]= 0;
+                block.id[k]= -1;
+            }
+        }
+    }
+
+    //! renvoie le nombre de triangles.
+    int size( ) const { return count; }
+
+    //! intersection la plus proche, entre 0 et htmax.
+    Hit intersect( const Ray& ray, const float htmax ) const
+    {
+        HitBlock hits(htmax);
+        for(unsigned i= 0; i < blocks.size(); i++)
+            ::intersect(blocks[i], ray, hits);
+
+        return hits.closest();
+    }
+
+    //! renvoie vrai s'il existe une intersection entre 0 et htmax. s'arrete sur le premier paquet intersecte.
+    bool occluded( const Ray& ray, const float htmax ) const
+    {
+        HitBlock hits(htmax);
+        for(unsigned i= 0; i < blocks.size(); i++)
+        {
+            ::intersect(blocks[i], ray, hits);
+            if(hits.any())
+                return true;
+        }
+
+        return false;
+    }
+
+    std::vector<TriangleBlock> blocks;
+    int count;
+};
+
+///@}
+#endif
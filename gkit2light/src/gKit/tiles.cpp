@@ -0,0 +1,132 @@
+
+#include <cstdio>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#ifdef _OPENMP
+    #include <omp.h>
+#endif
+
+#include "tiles.h"
+
+
+void print_progress( const TileProgress& progress )
+{
+    printf("\r%3d%% %d/%d tiles, %.1fs, eta %.1fs   ",
+        int(100.f * progress.done / progress.total), progress.done, progress.total, progress.elapsed, progress.eta);
+    if(progress.done == progress.total)
+        printf("\n");
+    fflush(stdout);
+}
+
+
+TileScheduler::TileScheduler( const int width, const int height, const int tile_size, const uint64_t seed )
+    : m_width(width), m_height(height), m_tile_size(std::max(1, tile_size)), m_tiles_x(), m_tiles_y(), m_seed(seed), m_threads(0), m_interval(1)
+{
+    m_tiles_x= (m_width + m_tile_size -1) / m_tile_size;
+    m_tiles_y= (m_height + m_tile_size -1) / m_tile_size;
+}
+
+Tile TileScheduler::tile( const int id ) const
+{
+    assert(id >= 0 && id < tile_count());
+
+    Tile tile;
+    tile.x0= (id % m_tiles_x) * m_tile_size;
+    tile.y0= (id / m_tiles_x) * m_tile_size;
+    tile.x1= std::min(tile.x0 + m_tile_size, m_width);
+    tile.y1= std::min(tile.y0 + m_tile_size, m_height);
+    tile.id= id;
+    // 1 sequence aleatoire par bloc, ne depend que de la graine et de l'indice du bloc
+    tile.rng= PCG32(m_seed, id);
+    return tile;
+}
+
+
+static float elapsed( const std::chrono::high_resolution_clock::time_point& start )
+{
+    return std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// blocs restants d'un thread. aligne sur une ligne de cache pour eviter que les threads ne partagent les memes compteurs.
+struct alignas(64) TileRange
+{
+    std::atomic<int> next;
+    int end;
+};
+
+int TileScheduler::run( const std::function<void (Tile& tile)>& render, const std::function<void (const TileProgress& progress)>& progress ) const
+{
+    int n= m_threads;
+#ifdef _OPENMP
+    if(n <= 0) n= omp_get_max_threads();
+#endif
+    int count= tile_count();
+    n= std::max(1, std::min(n, count));
+
+    // repartit les blocs par bandes contigues, 1 bande par thread
+    std::vector<TileRange> ranges(n);
+    for(int i= 0; i < n; i++)
+    {
+        ranges[i].next= int(int64_t(count) * i / n);
+        ranges[i].end= int(int64_t(count) * (i+1) / n);
+    }
+
+    std::atomic<int> done(0);
+    auto start= std::chrono::high_resolution_clock::now();
+    std::atomic<float> last(0);
+    int reported= 0;
+
+#pragma omp parallel num_threads(n)
+    {
+        int thread_id= 0;
+    #ifdef _OPENMP
+        thread_id= omp_get_thread_num();
+    #endif
+
+        // commence par sa bande, puis vole les blocs des autres threads, en commencant par les bandes voisines
+        for(int k= 0; k < n; k++)
+        {
+            TileRange& range= ranges[(thread_id + k) % n];
+
+            for(;;)
+            {
+                int id= range.next.fetch_add(1, std::memory_order_relaxed);
+                if(id >= range.end)
+                    break;
+
+                Tile t= tile(id);
+                render(t);
+
+                int d= done.fetch_add(1, std::memory_order_relaxed) +1;
+                // evite la section critique si l'intervalle n'est pas ecoule
+                if(progress && (d == count || elapsed(start) - last.load(std::memory_order_relaxed) >= m_interval))
+                {
+                    float now= elapsed(start);
+                #pragma omp critical(tiles_progress)
+                    {
+                        // les threads peuvent arriver dans le desordre, ne jamais revenir en arriere...
+                        if(d > reported && (d == count || now - last >= m_interval))
+                        {
+                            last= now;
+                            reported= d;
+
+                            TileProgress p;
+                            p.done= d;
+                            p.total= count;
+                            p.elapsed= now;
+                            p.eta= now / d * (count - d);
+                            progress(p);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    auto stop= std::chrono::high_resolution_clock::now();
+    return int(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+}
@@ -0,0 +1,96 @@
+#ifndef _TILES_H
+#define _TILES_H
+
+#include <cstdint>
+#include <functional>
+
+#include "pcg.h"
+
+
+//! \addtogroup image
+///@{
+
+//! \file
+//! decoupe une image en blocs de pixels et repartit leur calcul sur tous les threads, cf openMP.
+
+//! bloc de pixels [x0 x1) x [y0 y1) d'une image.
+struct Tile
+{
+    int x0, y0;         //!< premier pixel du bloc.
+    int x1, y1;         //!< dernier pixel +1 du bloc.
+    int id;             //!< indice du bloc dans l'image.
+
+    //! generateur de nombres aleatoires du bloc, initialise avec la graine du scheduler et l'indice du bloc. le resultat ne depend pas de l'ordre de calcul des blocs, ni du nombre de threads.
+    PCG32 rng;
+
+    int width( ) const { return x1 - x0; }
+    int height( ) const { return y1 - y0; }
+};
+
+//! avancement du calcul, cf TileScheduler::run( ).
+struct TileProgress
+{
+    int done;           //!< nombre de blocs termines.
+    int total;          //!< nombre total de blocs.
+    float elapsed;      //!< temps ecoule depuis le debut du calcul, en secondes.
+    float eta;          //!< estimation du temps restant, en secondes.
+};
+
+//! affiche l'avancement du calcul sur la console. utilisable directement comme fonction de progression de TileScheduler::run( ).
+void print_progress( const TileProgress& progress );
+
+
+/*! repartit les blocs d'une image sur les threads openMP, avec vol de travail : chaque thread commence par une bande de blocs voisins,
+    puis vole les blocs restants des autres threads lorsqu'il a termine les siens. pas de verrou, uniquement des compteurs atomiques.
+
+    exemple :
+    \code
+    Image image(1024, 768);
+    TileScheduler scheduler(image.width(), image.height());
+    scheduler.run(
+        [&]( Tile& tile )
+        {
+            for(int y= tile.y0; y < tile.y1; y++)
+            for(int x= tile.x0; x < tile.x1; x++)
+            {
+                float u= tile.rng.sample() / float(PCG32::max());
+                image(x, y)= Color(u);
+            }
+        },
+        print_progress);
+    \endcode
+*/
+class TileScheduler
+{
+public:
+    //! constructeur. decoupe une image width x height en blocs de tile_size x tile_size pixels, seed initialise les generateurs aleatoires des blocs.
+    TileScheduler( const int width, const int height, const int tile_size= 16, const uint64_t seed= 0 );
+
+    //! renvoie le nombre de blocs.
+    int tile_count( ) const { return m_tiles_x * m_tiles_y; }
+    //! renvoie le bloc d'indice id.
+    Tile tile( const int id ) const;
+
+    //! fixe le nombre de threads utilises par run( ), 0 pour utiliser tous les threads disponibles, cf omp_get_max_threads( ).
+    void threads( const int n ) { m_threads= n; }
+
+    //! fixe l'intervalle minimum, en secondes, entre 2 appels de la fonction de progression.
+    void progress_interval( const float seconds ) { m_interval= seconds; }
+
+    /*! calcule tous les blocs. render( ) est appelee une seule fois par bloc, par un des threads.
+        progress( ) est appelee regulierement, par un seul thread a la fois, et une derniere fois lorsque tous les blocs sont termines.
+        renvoie le temps de calcul en millisecondes.
+     */
+    int run( const std::function<void (Tile& tile)>& render, const std::function<void (const TileProgress& progress)>& progress= nullptr ) const;
+
+protected:
+    int m_width, m_height;
+    int m_tile_size;
+    int m_tiles_x, m_tiles_y;
+    uint64_t m_seed;
+    int m_threads;
+    float m_interval;
+};
+
+///@}
+#endif
@@ -0,0 +1,171 @@
+
+#ifndef _VERTEX_HASH_H
+#define _VERTEX_HASH_H
+
+#include <cstdint>
+#include <vector>
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file
+//! indexation des sommets d'un maillage : table de hachage, adressage ouvert, sur les indices des attributs d'un sommet.
+
+//! representation de l'indexation complete d'un sommet.
+struct vertex
+{
+    int material;
+    int position;
+    int texcoord;
+    int normal;
+
+    vertex( ) : material(-1), position(-1), texcoord(-1), normal(-1) {}
+    vertex( const int m, const int p, const int t, const int n ) : material(m), position(p), texcoord(t), normal(n) {}
+
+    //! comparaison de 2 sommets / des indices de leurs attributs.
+    bool operator== ( const vertex& b ) const
+    {
+        return material == b.material && position == b.position && texcoord == b.texcoord && normal == b.normal;
+    }
+
+    //! comparaison lexicographique de 2 sommets / des indices de leurs attributs.
+    bool operator< ( const vertex& b ) const
+    {
+        if(material != b.material) return material < b.material;
+        if(position != b.position) return position < b.position;
+        if(texcoord != b.texcoord) return texcoord < b.texcoord;
+        if(normal != b.normal) return normal < b.normal;
+        return false;
+    }
+};
+
+
+/*! associe un indice unique a chaque sommet, dans l'ordre d'insertion : le premier sommet insere a l'indice 0, le suivant 1, etc.
+    meme numerotation qu'avec std::map<vertex, int> et `remap.insert( std::make_pair(v, int(remap.size())) )`, mais sans allocation par sommet.
+    les sommets sont ranges dans un tableau (dans l'ordre d'insertion), la table ne contient que leurs indices, sondage lineaire.
+
+    \code
+    VertexHash remap(face_count * 3);
+    bool inserted;
+    int id= remap.insert(vertex(material, p, t, n), inserted);
+    if(inserted)
+        // nouveau sommet, copier ses attributs...
+    \endcode
+
+    chaque thread peut indexer une partie des sommets dans sa propre table, les tables sont ensuite fusionnees dans l'ordre avec merge( ),
+    la numerotation finale est identique a celle d'une seule table.
+ */
+class VertexHash
+{
+public:
+    //! constructeur, n : nombre de sommets prevus (estimation).
+    VertexHash( const size_t n= 0 ) : m_vertices(), m_slots(), m_mask(0) { reserve(n); }
+
+    //! prevoit la place pour n sommets, evite de re-construire la table.
+    void reserve( const size_t n )
+    {
+        m_vertices.reserve(n);
+        if(2*n > m_slots.size())
+            rehash(2*n);
+    }
+
+    //! renvoie l'indice du sommet. insere le sommet, s'il n'existe pas encore, et inserted= true.
+    int insert( const vertex& v, bool& inserted )
+    {
+        if(2*(m_vertices.size() +1) > m_slots.size())
+            rehash(2*(m_vertices.size() +1));
+
+        for(uint32_t slot= hash(v) & m_mask; ; slot= (slot +1) & m_mask)
+        {
+            int id= m_slots[slot];
+            if(id < 0)
+            {
+                // nouveau sommet
+                id= int(m_vertices.size());
+                m_slots[slot]= id;
+                m_vertices.push_back(v);
+                inserted= true;
+                return id;
+            }
+
+            if(m_vertices[id] == v)
+            {
+                inserted= false;
+                return id;
+            }
+        }
+    }
+
+    //! renvoie l'indice du sommet, ou -1 s'il n'existe pas.
+    int find( const vertex& v ) const
+    {
+        if(m_slots.empty())
+            return -1;
+
+        for(uint32_t slot= hash(v) & m_mask; ; slot= (slot +1) & m_mask)
+        {
+            int id= m_slots[slot];
+            if(id < 0 || m_vertices[id] == v)
+                return id;
+        }
+    }
+
+    /*! insere les sommets d'une autre table, dans leur ordre d'insertion. renvoie le nouvel indice de chaque sommet de table :
+        l'indice `i` de table devient l'indice `remap[i]`.
+     */
+    std::vector<int> merge( const VertexHash& table )
+    {
+        reserve(m_vertices.size() + table.size());
+
+        std::vector<int> remap(table.size());
+        bool inserted;
+        for(unsigned i= 0; i < table.m_vertices.size(); i++)
+            remap[i]= insert(table.m_vertices[i], inserted);
+
+        return remap;
+    }
+
+    //! renvoie le nombre de sommets.
+    size_t size( ) const { return m_vertices.size(); }
+    //! renvoie les sommets, dans l'ordre d'insertion, vertices()[id] est le sommet d'indice id.
+    const std::vector<vertex>& vertices( ) const { return m_vertices; }
+
+    //! melange les indices des attributs.
+    static uint32_t hash( const vertex& v )
+    {
+        uint64_t a= uint64_t(uint32_t(v.position)) | (uint64_t(uint32_t(v.material)) << 32);
+        uint64_t b= uint64_t(uint32_t(v.texcoord)) | (uint64_t(uint32_t(v.normal)) << 32);
+        uint64_t h= a * 0x9E3779B97F4A7C15ull ^ b * 0xC2B2AE3D27D4EB4Full;
+        h^= h >> 32;
+        h*= 0xD6E8FEB86659FD93ull;
+        h^= h >> 32;
+        return uint32_t(h);
+    }
+
+protected:
+    // re-construit la table, au moins n entrees
+    void rehash( const size_t n )
+    {
+        size_t size= 16;
+        while(size < n)
+            size= size * 2;
+
+        m_slots.assign(size, -1);
+        m_mask= uint32_t(size -1);
+        for(unsigned id= 0; id < m_vertices.size(); id++)
+        {
+            uint32_t slot= hash(m_vertices[id]) & m_mask;
+            while(m_slots[slot] >= 0)
+                slot= (slot +1) & m_mask;
+            m_slots[slot]= int(id);
+        }
+    }
+
+    std::vector<vertex> m_vertices;     // sommets, dans l'ordre d'insertion
+    std::vector<int> m_slots;           // indice du sommet, ou -1
+    uint32_t m_mask;                    // taille de la table -1
+};
+
+///@}
+#endif
@@ -3,12 +3,14 @@
 #include <cstring>
 #include <ctype.h>
 #include <climits>
+#include <cmath>
 
-#include <map>
+#include <vector>
 #include <algorithm>
 
 #include "files.h"
 #include "wavefront.h"
+#include "vertex_hash.h"
 
 
 Mesh read_mesh( const char *filename )
@@ -171,29 +173,6 @@ Mesh read_mesh( const char *filename )
 }
 
 
-//! representation de l'indexation complete d'un sommet
-struct vertex
-{
-    int material;
-    int position;
-    int texcoord;
-    int normal;
-    
-    vertex( ) : material(-1), position(-1), texcoord(-1), normal(-1) {}
-    vertex( const int m, const int p, const int t, const int n ) : material(m), position(p), texcoord(t), normal(n) {}
-    
-    // comparaison lexicographique de 2 sommets / des indices de leurs attributs
-    bool operator< ( const vertex& b ) const
-    {
-        if(material != b.material) return material < b.material;
-        if(position != b.position) return position < b.position;
-        if(texcoord != b.texcoord) return texcoord < b.texcoord;
-        if(normal != b.normal) return normal < b.normal;
-        return false;
-    }
-};
-
-
 Mesh read_indexed_mesh( const char *filename )
 {
     FILE *in= fopen(filename, "rb");
@@ -216,7 +195,7 @@ Mesh read_indexed_mesh( const char *filename )
     std::vector<int> idt;
     std::vector<int> idn;
     
-    std::map<vertex, int> remap;
+    VertexHash remap;
     
     char tmp[1024];
     char line_buffer[1024];
@@ -312,8 +291,9 @@ Mesh read_indexed_mesh( const char *filename )
                     if(p < 0) break; // error
                     
                     // recherche / insere le sommet 
-                    auto found= remap.insert( std::make_pair(vertex(material_id, p, t, n), int(remap.size())) );
-                    if(found.second)
+                    bool inserted;
+                    int id= remap.insert(vertex(material_id, p, t, n), inserted);
+                    if(inserted)
                     {
                         // pas trouve, copie les nouveaux attributs
                         if(t != -1) data.texcoord(texcoords[t]);
@@ -322,7 +302,7 @@ Mesh read_indexed_mesh( const char *filename )
                     }
                     
                     // construit l'index buffer
-                    data.index(found.first->second);
+                    data.index(id);
                 }
             }
         }
@@ -356,7 +336,118 @@ Mesh read_indexed_mesh( const char *filename )
 }
 
 
-int write_mesh( const Mesh& mesh, const char *filename, const char *materials_filename )
+// ecriture des fichiers .obj / .mtl : les lignes sont formatees dans un buffer, puis ecrites en une seule fois, au lieu d'utiliser fprintf( ).
+namespace {
+
+struct TextBuffer
+{
+    std::vector<char> data;
+    size_t size;
+    
+    TextBuffer( const size_t n= 0 ) : data(n), size(0) {}
+    
+    // renvoie la position d'ecriture de n caracteres
+    char *reserve( const size_t n )
+    {
+        if(size + n > data.size())
+            data.resize(std::max(2*data.size(), size + n));
+        return data.data() + size;
+    }
+    
+    void character( const char c )
+    {
+        *reserve(1)= c;
+        size++;
+    }
+    
+    void text( const char *s )
+    {
+        size_t n= strlen(s);
+        memcpy(reserve(n), s, n);
+        size+= n;
+    }
+    
+    void integer( unsigned long long v )
+    {
+        char tmp[24];
+        int n= 0;
+        do
+        {
+            tmp[n++]= char('0' + v % 10);
+            v= v / 10;
+        }
+        while(v);
+        
+        char *p= reserve(n);
+        for(int i= 0; i < n; i++)
+            p[i]= tmp[n -1 -i];
+        size+= n;
+    }
+    
+    // meme resultat que printf("%f") : 6 decimales, arrondi au plus proche. 
+    void real( const float v )
+    {
+        // float * 10^6 est exact en double (24 + 14 bits)
+        double x= double(v) * 1000000.0;
+        if(!(std::abs(x) < 1e18))
+        {
+            // inf, nan, ou valeur trop grande
+            char tmp[64];
+            int n= snprintf(tmp, sizeof(tmp), "%f", v);
+            memcpy(reserve(n), tmp, n);
+            size+= n;
+            return;
+        }
+        
+        if(std::signbit(v))
+            character('-');
+        
+        unsigned long long q= (unsigned long long) std::nearbyint(std::abs(x));
+        integer(q / 1000000);
+        
+        unsigned f= unsigned(q % 1000000);
+        char *p= reserve(7);
+        p[0]= '.';
+        for(int i= 6; i > 0; i--)
+        {
+            p[i]= char('0' + f % 10);
+            f= f / 10;
+        }
+        size+= 7;
+    }
+    
+    int write( FILE *out ) const
+    {
+        return (fwrite(data.data(), 1, size, out) == size) ? 0 : -1;
+    }
+};
+
+// formate n elements, par blocs, eventuellement en parallele, et ecrit les blocs dans l'ordre.
+template < typename F >
+int write_lines( FILE *out, const int n, const bool parallel, F format )
+{
+    const int block= 65536;
+    const int count= (n + block -1) / block;
+    
+    int code= 0;
+    #pragma omp parallel for ordered schedule(static, 1) if(parallel)
+    for(int b= 0; b < count; b++)
+    {
+        TextBuffer buffer(block * 64);
+        format(buffer, b * block, std::min(n, (b+1) * block));
+        
+        #pragma omp ordered
+        if(buffer.write(out) < 0)
+            code= -1;
+    }
+    
+    return code;
+}
+
+}
+
+
+int write_mesh( const Mesh& mesh, const char *filename, const char *materials_filename, const bool parallel )
 {
     if(mesh == Mesh::error())
         return -1;
@@ -382,26 +473,52 @@ int write_mesh( const Mesh& mesh, const char *filename, const char *materials_fi
         printf("  %d positions, %d texcoords, %d normals\n", int(mesh.positions().size()), int(mesh.texcoords().size()), int(mesh.normals().size()));
     }
     
+    int code= 0;
     const std::vector<vec3>& positions= mesh.positions();
-    for(unsigned i= 0; i < positions.size(); i++)
-        fprintf(out, "v %f %f %f\n", positions[i].x, positions[i].y, positions[i].z);
+    code|= write_lines(out, int(positions.size()), parallel, 
+        [&]( TextBuffer& buffer, const int begin, const int end )
+        {
+            for(int i= begin; i < end; i++)
+            {
+                buffer.text("v ");
+                buffer.real(positions[i].x); buffer.character(' ');
+                buffer.real(positions[i].y); buffer.character(' ');
+                buffer.real(positions[i].z); buffer.character('\n');
+            }
+        } );
     fprintf(out, "\n");
     
     //~ bool has_texcoords= false;
     const std::vector<vec2>& texcoords= mesh.texcoords();
     bool has_texcoords= (texcoords.size() == positions.size());
-    for(unsigned i= 0; i < texcoords.size(); i++)
-        fprintf(out, "vt %f %f\n", texcoords[i].x, texcoords[i].y);
+    code|= write_lines(out, int(texcoords.size()), parallel, 
+        [&]( TextBuffer& buffer, const int begin, const int end )
+        {
+            for(int i= begin; i < end; i++)
+            {
+                buffer.text("vt ");
+                buffer.real(texcoords[i].x); buffer.character(' ');
+                buffer.real(texcoords[i].y); buffer.character('\n');
+            }
+        } );
     fprintf(out, "\n");
     
     //~ bool has_normals= false;
     const std::vector<vec3>& normals= mesh.normals();
     bool has_normals= (normals.size() == positions.size());
-    for(unsigned i= 0; i < normals.size(); i++)
-        fprintf(out, "vn %f %f %f\n", normals[i].x, normals[i].y, normals[i].z);
+    code|= write_lines(out, int(normals.size()), parallel, 
+        [&]( TextBuffer& buffer, const int begin, const int end )
+        {
+            for(int i= begin; i < end; i++)
+            {
+                buffer.text("vn ");
+                buffer.real(normals[i].x); buffer.character(' ');
+                buffer.real(normals[i].y); buffer.character(' ');
+                buffer.real(normals[i].z); buffer.character('\n');
+            }
+        } );
     fprintf(out, "\n");
     
-    int material_id= -1;
     const std::vector<unsigned>& materials= mesh.material_indices();
     bool has_materials= (materials.size() > 0);
     
@@ -409,35 +526,51 @@ int write_mesh( const Mesh& mesh, const char *filename, const char *materials_fi
     bool has_indices= (indices.size() > 0);
     
     unsigned n= has_indices ? indices.size() : positions.size();
-    for(unsigned i= 0; i +2 < n; i+= 3)
-    {
-        if(has_materials && material_id != int(materials[i/3]))
+    code|= write_lines(out, int(n / 3), parallel, 
+        [&]( TextBuffer& buffer, const int begin, const int end )
         {
-            material_id= int(materials[i/3]);
-            if(material_id != -1)
+            // matiere du triangle precedent, meme si il est dans un autre bloc
+            int material_id= (has_materials && begin > 0) ? int(materials[begin -1]) : -1;
+            for(int t= begin; t < end; t++)
             {
-                fprintf(out, "o %s\n", mesh.materials().name(material_id));
-                fprintf(out, "usemtl %s\n", mesh.materials().name(material_id));
+                unsigned i= 3*t;
+                if(has_materials && material_id != int(materials[t]))
+                {
+                    material_id= int(materials[t]);
+                    if(material_id != -1)
+                    {
+                        buffer.text("o "); buffer.text(mesh.materials().name(material_id)); buffer.character('\n');
+                        buffer.text("usemtl "); buffer.text(mesh.materials().name(material_id)); buffer.character('\n');
+                    }
+                }
+                
+                buffer.character('f');
+                for(unsigned k= 0; k < 3; k++)
+                {
+                    unsigned id= has_indices ? indices[i+k] +1 : i+k +1;
+                    buffer.character(' ');
+                    buffer.integer(id);
+                    if(has_texcoords && has_normals)
+                    {
+                        buffer.character('/'); buffer.integer(id);
+                        buffer.character('/'); buffer.integer(id);
+                    }
+                    else if(has_texcoords)
+                    {
+                        buffer.character('/'); buffer.integer(id);
+                    }
+                    else if(has_normals)
+                    {
+                        buffer.text("//"); buffer.integer(id);
+                    }
+                }
+                buffer.character('\n');
             }
-        }
-        
-        fprintf(out, "f");
-        for(unsigned k= 0; k < 3; k++)
-        {
-            unsigned id= has_indices ? indices[i+k] +1 : i+k +1;
-            fprintf(out, " %u", id);
-            if(has_texcoords && has_normals)
-                fprintf(out, "/%u/%u", id, id);
-            else if(has_texcoords)
-                fprintf(out, "/%u", id);
-            else if(has_normals)
-                fprintf(out, "//%u", id);
-        }
-        fprintf(out, "\n");
-    }
+        } );
     
-    fclose(out);
-    return 0;
+    if(fclose(out) != 0)
+        code= -1;
+    return code;
 }
 
 
@@ -545,40 +678,58 @@ int write_materials( const Materials& materials, const char *filename, const cha
     
     printf("writing materials '%s'...\n", filename);
     
+    TextBuffer buffer(4096);
     for(int i= 0; i < materials.count(); i++)
     {
         const Material& m= materials.material(i);
         
-        fprintf(out, "newmtl %s\n", materials.name(i));
+        buffer.text("newmtl "); buffer.text(materials.name(i)); buffer.character('\n');
         
         if(m.diffuse.r + m.diffuse.g + m.diffuse.b)
-            fprintf(out, "  Kd %f %f %f\n", m.diffuse.r, m.diffuse.g, m.diffuse.b);
+        {
+            buffer.text("  Kd "); 
+            buffer.real(m.diffuse.r); buffer.character(' '); buffer.real(m.diffuse.g); buffer.character(' '); buffer.real(m.diffuse.b); buffer.character('\n');
+        }
         if(m.diffuse_texture != -1)
-            fprintf(out, "  map_Kd %s\n", relative_filename(materials.filename(m.diffuse_texture), path).c_str());
+        {
+            buffer.text("  map_Kd "); buffer.text(relative_filename(materials.filename(m.diffuse_texture), path).c_str()); buffer.character('\n');
+        }
         
         if(m.specular.r + m.specular.g + m.specular.b)
-        fprintf(out, "  Ks %f %f %f\n", m.specular.r, m.specular.g, m.specular.b);
+        {
+            buffer.text("  Ks "); 
+            buffer.real(m.specular.r); buffer.character(' '); buffer.real(m.specular.g); buffer.character(' '); buffer.real(m.specular.b); buffer.character('\n');
+        }
         if(m.specular_texture != -1)
-            fprintf(out, "  map_Ks %s\n", relative_filename(materials.filename(m.specular_texture), path).c_str());
+        {
+            buffer.text("  map_Ks "); buffer.text(relative_filename(materials.filename(m.specular_texture), path).c_str()); buffer.character('\n');
+        }
         
         if(m.specular.power() > 0)
         {
-            fprintf(out, "  Ns %f\n", m.ns);
+            buffer.text("  Ns "); buffer.real(m.ns); buffer.character('\n');
             if(m.ns_texture != -1)
-                fprintf(out, "  map_Ns %s\n", relative_filename(materials.filename(m.ns_texture), path).c_str());
+            {
+                buffer.text("  map_Ns "); buffer.text(relative_filename(materials.filename(m.ns_texture), path).c_str()); buffer.character('\n');
+            }
         }
         
         if(m.emission.power() > 0)
         {
-            fprintf(out, "  Ke %f %f %f\n", m.emission.r, m.emission.g, m.emission.b);
+            buffer.text("  Ke "); 
+            buffer.real(m.emission.r); buffer.character(' '); buffer.real(m.emission.g); buffer.character(' '); buffer.real(m.emission.b); buffer.character('\n');
             if(m.emission_texture != -1)
-                fprintf(out, "  map_Ke %s\n", relative_filename(materials.filename(m.emission_texture), path).c_str());
+            {
+                buffer.text("  map_Ke "); buffer.text(relative_filename(materials.filename(m.emission_texture), path).c_str()); buffer.character('\n');
+            }
         }
         
-        fprintf(out, "\n");
+        buffer.character('\n');
     }
     
-    fclose(out);
-    return 0;
+    int code= buffer.write(out);
+    if(fclose(out) != 0)
+        code= -1;
+    return code;
 }
 
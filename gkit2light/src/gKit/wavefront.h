@@ -17,8 +17,8 @@ Mesh read_mesh( const char *filename );
 //! charge un fichier wavefront .obj et renvoie un mesh compose de triangles indexes. utiliser glDrawElements pour l'afficher. a detruire avec Mesh::release( ).
 Mesh read_indexed_mesh( const char *filename );
 
-//! enregistre un mesh dans un fichier .obj.
-int write_mesh( const Mesh& mesh, const char *filename, const char *materials_filename= nullptr );
+//! enregistre un mesh dans un fichier .obj. parallel : formate les lignes sur plusieurs threads, le fichier est identique.
+int write_mesh( const Mesh& mesh, const char *filename, const char *materials_filename= nullptr, const bool parallel= true );
 
 //! charge une description de matieres, utilise par read_mesh.
 Materials read_materials( const char *filename );
@@ -3,11 +3,11 @@
 #include <ctype.h>
 #include <climits>
 
-#include <map>
 #include <algorithm>
 
 #include "files.h"
 #include "wavefront.h"
+#include "vertex_hash.h"
 #include "wavefront_fast.h"
 
 // parse_int() + parse_float() + tools from fast_obj parser
@@ -157,15 +157,20 @@ Mesh read_mesh_fast( const char *filename )
         return Mesh::error();
     }
     
-    Mesh data(GL_TRIANGLES);
-    
     printf("loading mesh '%s'...\n", filename);
     
     std::vector<vec3> positions;
     std::vector<vec2> texcoords;
     std::vector<vec3> normals;
+    Materials materials;
     int material_id= -1;
     
+    // sommets et matieres des triangles, deplaces dans le mesh a la fin du chargement, cf Mesh( ) et material_indices( )
+    std::vector<vec3> mesh_positions;
+    std::vector<vec2> mesh_texcoords;
+    std::vector<vec3> mesh_normals;
+    std::vector<unsigned> mesh_materials;
+    
     std::vector<int> idp;
     std::vector<int> idt;
     std::vector<int> idn;
@@ -252,13 +257,13 @@ Mesh read_mesh_fast( const char *filename )
             // verifie qu'une matiere est deja definie pour le triangle
             if(material_id == -1)
                 // sinon affecte une matiere par defaut
-                material_id= data.materials().default_material_index();
-            
-            data.material(material_id);
+                material_id= materials.default_material_index();
             
             // triangulation de la face (supposee convexe)
             for(int v= 2; v < int(idp.size()); v++)
             {
+                mesh_materials.push_back(material_id);
+                
                 int idv[3]= { 0, v -1, v };
                 for(int i= 0; i < 3; i++)
                 {
@@ -268,9 +273,13 @@ Mesh read_mesh_fast( const char *filename )
                     int n= (idn[k] < 0) ? (int) normals.size()   + idn[k] : idn[k] -1;
                     
                     if(p < 0) break; // error
-                    if(t >= 0) data.texcoord(texcoords[t]);
-                    if(n >= 0) data.normal(normals[n]);
-                    data.vertex(positions[p]);
+                    
+                    // comme Mesh::vertex( ), un attribut absent est copie du sommet precedent
+                    if(t >= 0) mesh_texcoords.push_back(texcoords[t]);
+                    else if(!mesh_texcoords.empty()) mesh_texcoords.push_back(mesh_texcoords.back());
+                    if(n >= 0) mesh_normals.push_back(normals[n]);
+                    else if(!mesh_normals.empty()) mesh_normals.push_back(mesh_normals.back());
+                    mesh_positions.push_back(positions[p]);
                 }
             }
         }
@@ -279,21 +288,24 @@ Mesh read_mesh_fast( const char *filename )
         {
            if(sscanf(line, "mtllib %[^\r\n]", tmp) == 1)
            {
-               Materials materials= read_materials( normalize_filename(pathname(filename) + tmp).c_str() );
-               // enregistre les matieres dans le mesh
-               data.materials(materials);
+               materials= read_materials( normalize_filename(pathname(filename) + tmp).c_str() );
            }
         }
         
         else if(line[0] == 'u')
         {
            if(sscanf(line, "usemtl %[^\r\n]", tmp) == 1)
-               material_id= data.materials().find(tmp);
+               material_id= materials.find(tmp);
         }
     }
     
     fclose(in);
     
+    // construit le mesh, sans copier les sommets
+    Mesh data(GL_TRIANGLES, std::move(mesh_positions), std::move(mesh_texcoords), std::move(mesh_normals), std::vector<vec4>(), std::vector<unsigned>());
+    data.materials(materials);
+    data.material_indices(std::move(mesh_materials));
+    
     if(error)
         printf("[error] loading mesh '%s'...\n%s\n\n", filename, line_buffer);
     else
@@ -303,29 +315,6 @@ Mesh read_mesh_fast( const char *filename )
 }
 
 
-//! representation de l'indexation complete d'un sommet
-struct vertex
-{
-    int material;
-    int position;
-    int texcoord;
-    int normal;
-    
-    vertex( ) : material(-1), position(-1), texcoord(-1), normal(-1) {}
-    vertex( const int m, const int p, const int t, const int n ) : material(m), position(p), texcoord(t), normal(n) {}
-    
-    // comparaison lexicographique de 2 sommets / des indices de leurs attributs
-    bool operator< ( const vertex& b ) const
-    {
-        if(material != b.material) return material < b.material;
-        if(position != b.position) return position < b.position;
-        if(texcoord != b.texcoord) return texcoord < b.texcoord;
-        if(normal != b.normal) return normal < b.normal;
-        return false;
-    }
-};
-
-
 Mesh read_indexed_mesh_fast( const char *filename )
 {
     FILE *in= fopen(filename, "rb");
@@ -335,20 +324,26 @@ Mesh read_indexed_mesh_fast( const char *filename )
         return Mesh::error();
     }
     
-    Mesh data(GL_TRIANGLES);
-    
     printf("loading indexed mesh '%s'...\n", filename);
     
     std::vector<vec3> positions;
     std::vector<vec2> texcoords;
     std::vector<vec3> normals;
+    Materials materials;
     int material_id= -1;
     
+    // sommets, indices et matieres des triangles, deplaces dans le mesh a la fin du chargement, cf Mesh( ) et material_indices( )
+    std::vector<vec3> mesh_positions;
+    std::vector<vec2> mesh_texcoords;
+    std::vector<vec3> mesh_normals;
+    std::vector<unsigned> mesh_indices;
+    std::vector<unsigned> mesh_materials;
+    
     std::vector<int> idp;
     std::vector<int> idt;
     std::vector<int> idn;
     
-    std::map<vertex, int> remap;
+    VertexHash remap;
     
     char tmp[1024*64];
     char line_buffer[1024*64];
@@ -432,15 +427,15 @@ Mesh read_indexed_mesh_fast( const char *filename )
             // force une matiere par defaut, si necessaire
             if(material_id == -1)
             {
-                material_id= data.materials().default_material_index();
+                material_id= materials.default_material_index();
                 printf("usemtl default\n");
             }
             
-            data.material(material_id);
-            
             // triangule la face
             for(int v= 2; v < int(idp.size()); v++)
             {
+                mesh_materials.push_back(material_id);
+                
                 int idv[3]= { 0, v -1, v };
                 for(int i= 0; i < 3; i++)
                 {
@@ -453,17 +448,21 @@ Mesh read_indexed_mesh_fast( const char *filename )
                     if(p < 0) break; // error
                     
                     // recherche / insere le sommet 
-                    auto found= remap.insert( std::make_pair(vertex(material_id, p, t, n), int(remap.size())) );
-                    if(found.second)
+                    bool inserted;
+                    int id= remap.insert(vertex(material_id, p, t, n), inserted);
+                    if(inserted)
                     {
                         // pas trouve, copie les nouveaux attributs
-                        if(t != -1) data.texcoord(texcoords[t]);
-                        if(n != -1) data.normal(normals[n]);
-                        data.vertex(positions[p]);
+                        // comme Mesh::vertex( ), un attribut absent est copie du sommet precedent
+                        if(t != -1) mesh_texcoords.push_back(texcoords[t]);
+                        else if(!mesh_texcoords.empty()) mesh_texcoords.push_back(mesh_texcoords.back());
+                        if(n != -1) mesh_normals.push_back(normals[n]);
+                        else if(!mesh_normals.empty()) mesh_normals.push_back(mesh_normals.back());
+                        mesh_positions.push_back(positions[p]);
                     }
                     
                     // construit l'index buffer
-                    data.index(found.first->second);
+                    mesh_indices.push_back(id);
                 }
             }
         }
@@ -472,21 +471,24 @@ Mesh read_indexed_mesh_fast( const char *filename )
         {
            if(sscanf(line, "mtllib %[^\r\n]", tmp) == 1)
            {
-               Materials materials= read_materials( normalize_filename(pathname(filename) + tmp).c_str() );
-               // enregistre les matieres dans le mesh
-               data.materials(materials);
+               materials= read_materials( normalize_filename(pathname(filename) + tmp).c_str() );
            }
         }
         
         else if(line[0] == 'u')
         {
            if(sscanf(line, "usemtl %[^\r\n]", tmp) == 1)
-               material_id= data.materials().find(tmp);
+               material_id= materials.find(tmp);
         }
     }
     
     fclose(in);
     
+    // construit le mesh, sans copier les sommets ni les indices
+    Mesh data(GL_TRIANGLES, std::move(mesh_positions), std::move(mesh_texcoords), std::move(mesh_normals), std::vector<vec4>(), std::move(mesh_indices));
+    data.materials(materials);
+    data.material_indices(std::move(mesh_materials));
+    
     if(error)
         printf("[error] loading indexed mesh '%s'...\n%s\n\n", filename, line_buffer);
     else
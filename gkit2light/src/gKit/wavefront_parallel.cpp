@@ -0,0 +1,752 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "files.h"
+#include "wavefront.h"
+#include "wavefront_parallel.h"
+#include "vertex_hash.h"
+
+
+namespace {
+
+// commande mtllib ou usemtl, et nombre de faces du bloc avant la commande
+struct Command
+{
+    int face;
+    bool mtllib;
+    std::string name;
+};
+
+// matiere d'un groupe de faces
+struct Group
+{
+    int face;           // premiere face du groupe
+    int material;
+};
+
+// bloc de lignes du fichier, et son contenu
+struct Chunk
+{
+    const char *begin;
+    const char *end;
+
+    std::vector<vec3> positions;
+    std::vector<vec2> texcoords;
+    std::vector<vec3> normals;
+
+    std::vector<int> faces;     // premier sommet de chaque face dans idp, idt, idn. + 1 entree finale
+    std::vector<int> idp;       // indices des attributs des sommets, tels qu'ils sont dans le fichier, 0 : indice invalide
+    std::vector<int> idt;
+    std::vector<int> idn;
+    std::vector<int> counts;    // nombre de positions, texcoords et normales du bloc avant chaque face, pour les indices relatifs
+    std::vector<Command> commands;
+    std::vector<Group> groups;  // matiere des faces
+
+    const char *error;          // ligne incorrecte, ou nullptr
+
+    // assemblage
+    int first_position;         // indice de la premiere position du bloc dans le fichier
+    int first_texcoord;
+    int first_normal;
+    int first_triangle;
+    int triangles;              // nombre de triangles du bloc
+    size_t vertex_texcoords;    // nombre de sommets avec une texcoord
+    size_t vertex_normals;      // nombre de sommets avec une normale
+    bool complete;              // toutes les faces ont au moins 3 sommets valides
+
+    Chunk( const char *_begin, const char *_end ) : begin(_begin), end(_end), positions(), texcoords(), normals(), faces(), idp(), idt(), idn(), counts(), commands(), groups(), error(nullptr),
+        first_position(0), first_texcoord(0), first_normal(0), first_triangle(0), triangles(0), vertex_texcoords(0), vertex_normals(0), complete(true) {}
+};
+
+// sommets d'une face, indices des attributs dans le fichier, ou -1
+struct Face
+{
+    const int *idp;
+    const int *idt;
+    const int *idn;
+    int count;
+    int positions;      // nombre d'attributs avant la face, cf indices relatifs
+    int texcoords;
+    int normals;
+
+    Face( const Chunk& chunk, const int f ) :
+        idp(chunk.idp.data() + chunk.faces[f]), idt(chunk.idt.data() + chunk.faces[f]), idn(chunk.idn.data() + chunk.faces[f]), count(chunk.faces[f+1] - chunk.faces[f]),
+        positions(chunk.first_position + chunk.counts[3*f]), texcoords(chunk.first_texcoord + chunk.counts[3*f+1]), normals(chunk.first_normal + chunk.counts[3*f+2]) {}
+
+    // les sommets sont numerotes a partir de 1 ou de la fin du tableau (< 0), 0 : pas d'attribut
+    static int index( const int id, const int count )
+    {
+        int i= (id < 0) ? count + id : id -1;
+        return (i >= 0 && i < count) ? i : -1;
+    }
+
+    int position( const int k ) const { return index(idp[k], positions); }
+    int texcoord( const int k ) const { return index(idt[k], texcoords); }
+    int normal( const int k ) const { return index(idn[k], normals); }
+};
+
+// compte les triangles du bloc, et verifie que l'assemblage en parallele est possible
+void count_chunk( Chunk& chunk )
+{
+    int face_count= int(chunk.faces.size()) -1;
+    for(int f= 0; f < face_count; f++)
+    {
+        Face face(chunk, f);
+        if(face.count < 3)
+            chunk.complete= false;
+        else
+            chunk.triangles+= face.count -2;
+
+        for(int k= 0; k < face.count; k++)
+        {
+            if(face.position(k) < 0)
+                chunk.complete= false;
+            if(face.texcoord(k) >= 0)
+                chunk.vertex_texcoords++;
+            if(face.normal(k) >= 0)
+                chunk.vertex_normals++;
+        }
+    }
+}
+
+// les lignes se terminent par \n, ou par 0 pour la derniere ligne du fichier
+bool is_blank( const char c )
+{
+    return (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f');
+}
+
+const char *skip_blanks( const char *line )
+{
+    while(is_blank(*line))
+        line++;
+    return line;
+}
+
+// comme sscanf(" %f"), mais ne passe pas a la ligne suivante
+bool parse_float( const char *& line, float& x )
+{
+    line= skip_blanks(line);
+    if(*line == '\n' || *line == 0)
+        return false;
+
+    // cas simple, le plus frequent : au plus 7 chiffres significatifs, pas d'exposant.
+    // la mantisse et 10^n sont representes exactement par des float, et la division est arrondie correctement, meme resultat que strtof( ).
+    // cf "How to Read Floating Point Numbers Accurately", W. Clinger, 1990
+    {
+        static const float powers[]= { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+        const char *p= line;
+        float sign= 1;
+        if(*p == '-' || *p == '+')
+        {
+            if(*p == '-') sign= -1;
+            p++;
+        }
+
+        unsigned m= 0;
+        int digits= 0;
+        int decimals= 0;
+        bool fast= true;
+        for(; *p >= '0' && *p <= '9'; p++, digits++)
+            m= 10 * m + (*p - '0');
+        if(*p == '.')
+            for(p++; *p >= '0' && *p <= '9'; p++, digits++, decimals++)
+                m= 10 * m + (*p - '0');
+
+        if(digits == 0 || digits > 9 || m > (1u << 24) || decimals > 10)
+            fast= false;
+        if(*p == 'e' || *p == 'E' || *p == 'x' || *p == 'X')
+            fast= false;
+
+        if(fast)
+        {
+            x= sign * (float(m) / powers[decimals]);
+            line= p;
+            return true;
+        }
+    }
+
+    char *next= nullptr;
+    x= strtof(line, &next);
+    if(next == line)
+        return false;
+
+    line= next;
+    return true;
+}
+
+// comme sscanf(" %d")
+bool parse_int( const char *& line, int& x )
+{
+    line= skip_blanks(line);
+
+    const char *p= line;
+    int sign= 1;
+    if(*p == '-' || *p == '+')
+    {
+        if(*p == '-') sign= -1;
+        p++;
+    }
+
+    if(!(*p >= '0' && *p <= '9'))
+        return false;
+
+    int n= 0;
+    while(*p >= '0' && *p <= '9')
+        n= 10 * n + (*p++ - '0');
+
+    x= sign * n;
+    line= p;
+    return true;
+}
+
+// comme sscanf(" %[^\r\n]")
+std::string parse_name( const char *line )
+{
+    line= skip_blanks(line);
+
+    const char *end= line;
+    while(*end && *end != '\r' && *end != '\n')
+        end++;
+    return std::string(line, end);
+}
+
+// analyse une ligne, cf read_mesh( ). renvoie faux en cas d'erreur
+bool parse_line( Chunk& chunk, const char *line )
+{
+    // saute les espaces en debut de ligne
+    line= skip_blanks(line);
+
+    if(line[0] == 'v')
+    {
+        float x, y, z;
+        if(line[1] == ' ')          // position x y z
+        {
+            line+= 2;
+            if(!parse_float(line, x) || !parse_float(line, y) || !parse_float(line, z))
+                return false;
+            chunk.positions.push_back( vec3(x, y, z) );
+        }
+        else if(line[1] == 'n')     // normal x y z
+        {
+            line+= 2;
+            if(!parse_float(line, x) || !parse_float(line, y) || !parse_float(line, z))
+                return false;
+            chunk.normals.push_back( vec3(x, y, z) );
+        }
+        else if(line[1] == 't')     // texcoord x y
+        {
+            line+= 2;
+            if(!parse_float(line, x) || !parse_float(line, y))
+                return false;
+            chunk.texcoords.push_back( vec2(x, y) );
+        }
+    }
+
+    else if(line[0] == 'f')         // face a b c ..., p/t/n ou p//n ou p/t ou p
+    {
+        chunk.faces.push_back(int(chunk.idp.size()));
+        chunk.counts.push_back(int(chunk.positions.size()));
+        chunk.counts.push_back(int(chunk.texcoords.size()));
+        chunk.counts.push_back(int(chunk.normals.size()));
+
+        line= line +1;
+        for(;;)
+        {
+            int p= 0, t= 0, n= 0;
+            if(!parse_int(line, p))
+                break;
+
+            if(*line == '/')
+            {
+                line++;
+                if(*line != '/')
+                    parse_int(line, t);
+
+                if(*line == '/')
+                {
+                    line++;
+                    parse_int(line, n);
+                }
+            }
+
+            chunk.idp.push_back(p);
+            chunk.idt.push_back(t);
+            chunk.idn.push_back(n);
+        }
+    }
+
+    else if(line[0] == 'm')
+    {
+        if(strncmp(line, "mtllib", 6) == 0)
+        {
+            std::string name= parse_name(line + 6);
+            if(!name.empty())
+                chunk.commands.push_back( { int(chunk.faces.size()), true, name } );
+        }
+    }
+
+    else if(line[0] == 'u')
+    {
+        if(strncmp(line, "usemtl", 6) == 0)
+        {
+            std::string name= parse_name(line + 6);
+            if(!name.empty())
+                chunk.commands.push_back( { int(chunk.faces.size()), false, name } );
+        }
+    }
+
+    return true;
+}
+
+// analyse toutes les lignes du bloc, s'arrete sur la premiere erreur
+void parse_chunk( Chunk& chunk, const char *file_end )
+{
+    std::string last;
+    for(const char *line= chunk.begin; line < chunk.end; )
+    {
+        const char *eol= (const char *) memchr(line, '\n', chunk.end - line);
+        const char *next= (eol != nullptr) ? eol +1 : chunk.end;
+
+        // la derniere ligne du fichier n'est pas forcement terminee par \n, la copie pour ne pas lire apres la fin du fichier
+        const char *text= line;
+        if(eol == nullptr && chunk.end == file_end)
+        {
+            last.assign(line, chunk.end);
+            text= last.c_str();
+        }
+
+        if(!parse_line(chunk, text))
+        {
+            chunk.error= line;
+            break;
+        }
+
+        line= next;
+    }
+
+    chunk.faces.push_back(int(chunk.idp.size()));
+}
+
+// contenu du fichier, analyse en parallele
+struct ObjFile
+{
+    MappedFile file;
+    std::vector<Chunk> chunks;
+    int chunk_count;            // blocs utilises, jusqu'a la premiere erreur
+    const char *error;          // ligne incorrecte, ou nullptr
+
+    Materials materials;
+    std::vector<vec3> positions;
+    std::vector<vec2> texcoords;
+    std::vector<vec3> normals;
+
+    int triangle_count;
+    size_t vertex_count;        // nombre de sommets des faces
+    bool use_texcoords;
+    bool use_normals;
+    bool complete;              // assemblage en parallele possible
+
+    ObjFile( ) : file(), chunks(), chunk_count(0), error(nullptr), materials(), positions(), texcoords(), normals(),
+        triangle_count(0), vertex_count(0), use_texcoords(false), use_normals(false), complete(true) {}
+};
+
+/*! charge et analyse le fichier en parallele, resout les indices relatifs et les matieres des faces.
+    indexed : les matieres sont gerees comme read_indexed_mesh( ), la matiere par defaut n'est utilisee que si le fichier charge des matieres.
+ */
+bool read_obj( ObjFile& obj, const char *filename, const bool indexed )
+{
+    if(obj.file.open(filename) < 0)
+        return false;
+
+    // decoupe le fichier en blocs de lignes, ~1Mo
+    const char *file_begin= obj.file.data();
+    const char *file_end= obj.file.data() + obj.file.size();
+
+    std::vector<Chunk>& chunks= obj.chunks;
+    {
+        const size_t chunk_size= 1 << 20;
+        for(const char *begin= file_begin; begin < file_end; )
+        {
+            const char *end= begin + std::min(chunk_size, size_t(file_end - begin));
+            if(end < file_end)
+            {
+                const char *eol= (const char *) memchr(end, '\n', file_end - end);
+                end= (eol != nullptr) ? eol +1 : file_end;
+            }
+
+            chunks.push_back( Chunk(begin, end) );
+            begin= end;
+        }
+    }
+
+    // analyse les blocs en parallele
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int i= 0; i < int(chunks.size()); i++)
+        parse_chunk(chunks[i], file_end);
+
+    // indices des premiers attributs de chaque bloc, pour les indices relatifs. s'arrete sur le bloc qui contient une erreur, comme read_mesh( )
+    int position_count= 0;
+    int texcoord_count= 0;
+    int normal_count= 0;
+    for(unsigned c= 0; c < chunks.size(); c++)
+    {
+        Chunk& chunk= chunks[c];
+        chunk.first_position= position_count;
+        chunk.first_texcoord= texcoord_count;
+        chunk.first_normal= normal_count;
+        position_count+= int(chunk.positions.size());
+        texcoord_count+= int(chunk.texcoords.size());
+        normal_count+= int(chunk.normals.size());
+
+        obj.chunk_count= c +1;
+        if(chunk.error)
+        {
+            obj.error= chunk.error;
+            break;
+        }
+    }
+
+    // matieres des faces, dans l'ordre du fichier : mtllib, usemtl et matiere par defaut
+    Materials& materials= obj.materials;
+    int material_id= -1;
+    for(int c= 0; c < obj.chunk_count; c++)
+    {
+        Chunk& chunk= chunks[c];
+        int face_count= int(chunk.faces.size()) -1;
+        int f= 0;
+        for(unsigned k= 0; k <= chunk.commands.size(); k++)
+        {
+            // faces avant la commande
+            int next= (k < chunk.commands.size()) ? chunk.commands[k].face : face_count;
+            if(next > f)
+            {
+                // force une matiere par defaut, si necessaire
+                if(material_id == -1 && (!indexed || materials.count() > 0))
+                {
+                    material_id= materials.default_material_index();
+                    printf("usemtl default\n");
+                }
+
+                chunk.groups.push_back( { f, material_id } );
+                f= next;
+            }
+
+            if(k == chunk.commands.size())
+                break;
+
+            const Command& command= chunk.commands[k];
+            if(command.mtllib)
+            {
+                std::string materials_filename;
+                if(indexed || (command.name[0] != '/' && command.name[1] != ':'))   // windows c:\ pour les chemins complets...
+                    materials_filename= normalize_filename(pathname(filename) + command.name);
+                else
+                    materials_filename= command.name;
+
+                materials= read_materials( materials_filename.c_str() );
+            }
+            else
+                material_id= materials.find(command.name.c_str());
+        }
+    }
+
+    // regroupe les attributs, et compte les triangles de chaque bloc
+    obj.positions.resize(position_count);
+    obj.texcoords.resize(texcoord_count);
+    obj.normals.resize(normal_count);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int c= 0; c < obj.chunk_count; c++)
+    {
+        Chunk& chunk= chunks[c];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), obj.positions.begin() + chunk.first_position);
+        std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), obj.texcoords.begin() + chunk.first_texcoord);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), obj.normals.begin() + chunk.first_normal);
+        count_chunk(chunk);
+    }
+
+    // assemblage en parallele, si toutes les faces sont completes et si les sommets ont tous (ou aucun) texcoord et normale.
+    size_t vertex_texcoords= 0;
+    size_t vertex_normals= 0;
+    for(int c= 0; c < obj.chunk_count; c++)
+    {
+        Chunk& chunk= chunks[c];
+        obj.complete= obj.complete && chunk.complete;
+        obj.vertex_count+= chunk.idp.size();
+        vertex_texcoords+= chunk.vertex_texcoords;
+        vertex_normals+= chunk.vertex_normals;
+
+        chunk.first_triangle= obj.triangle_count;
+        obj.triangle_count+= chunk.triangles;
+    }
+
+    obj.use_texcoords= (vertex_texcoords > 0);
+    obj.use_normals= (vertex_normals > 0);
+    if(vertex_texcoords != 0 && vertex_texcoords != obj.vertex_count)
+        obj.complete= false;
+    if(vertex_normals != 0 && vertex_normals != obj.vertex_count)
+        obj.complete= false;
+
+    return true;
+}
+
+// affiche la ligne incorrecte
+void print_error( const ObjFile& obj, const char *message, const char *filename )
+{
+    const char *file_end= obj.file.data() + obj.file.size();
+    const char *eol= (const char *) memchr(obj.error, '\n', file_end - obj.error);
+    printf("[error] %s '%s'...\n%s\n\n", message, filename, std::string(obj.error, eol ? eol +1 : file_end).c_str());
+}
+
+}
+
+
+Mesh read_mesh_parallel( const char *filename )
+{
+    printf("loading mesh '%s'...\n", filename);
+
+    ObjFile obj;
+    if(!read_obj(obj, filename, false))
+    {
+        printf("[error] loading mesh '%s'...\n", filename);
+        return Mesh::error();
+    }
+
+    const std::vector<Chunk>& chunks= obj.chunks;
+    const int chunk_count= obj.chunk_count;
+    const std::vector<vec3>& positions= obj.positions;
+    const std::vector<vec2>& texcoords= obj.texcoords;
+    const std::vector<vec3>& normals= obj.normals;
+    const bool use_texcoords= obj.use_texcoords;
+    const bool use_normals= obj.use_normals;
+    const int triangle_count= obj.triangle_count;
+
+    // assemblage en parallele, ou sinon, assemble les faces une par une, comme read_mesh( ) avec Mesh::texcoord( ), normal( ), vertex( ) et material( )
+    std::vector<vec3> mesh_positions;
+    std::vector<vec2> mesh_texcoords;
+    std::vector<vec3> mesh_normals;
+    std::vector<unsigned> mesh_materials;
+    if(obj.complete)
+    {
+        mesh_positions.resize(3 * triangle_count);
+        if(use_texcoords) mesh_texcoords.resize(3 * triangle_count);
+        if(use_normals) mesh_normals.resize(3 * triangle_count);
+        mesh_materials.resize(triangle_count);
+        
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(int c= 0; c < chunk_count; c++)
+        {
+            const Chunk& chunk= chunks[c];
+            int triangle= chunk.first_triangle;
+            int face_count= int(chunk.faces.size()) -1;
+            unsigned group= 0;
+            for(int f= 0; f < face_count; f++)
+            {
+                while(group +1 < chunk.groups.size() && chunk.groups[group +1].face <= f)
+                    group++;
+                
+                Face face(chunk, f);
+                for(int v= 2; v < face.count; v++, triangle++)
+                {
+                    int idv[3]= { 0, v -1, v };
+                    for(int i= 0; i < 3; i++)
+                    {
+                        int k= idv[i];
+                        mesh_positions[3*triangle + i]= positions[face.position(k)];
+                        if(use_texcoords) mesh_texcoords[3*triangle + i]= texcoords[face.texcoord(k)];
+                        if(use_normals) mesh_normals[3*triangle + i]= normals[face.normal(k)];
+                    }
+                    
+                    mesh_materials[triangle]= chunk.groups[group].material;
+                }
+            }
+        }
+    }
+    else
+    {
+        mesh_positions.reserve(obj.vertex_count * 3 / 2);
+        for(int c= 0; c < chunk_count; c++)
+        {
+            const Chunk& chunk= chunks[c];
+            int face_count= int(chunk.faces.size()) -1;
+            unsigned group= 0;
+            for(int f= 0; f < face_count; f++)
+            {
+                while(group +1 < chunk.groups.size() && chunk.groups[group +1].face <= f)
+                    group++;
+                
+                // Mesh::material( )
+                if(mesh_materials.size() <= mesh_positions.size() / 3)
+                    mesh_materials.push_back(chunk.groups[group].material);
+                else
+                    mesh_materials.back()= chunk.groups[group].material;
+                
+                // triangule la face
+                Face face(chunk, f);
+                for(int v= 2; v < face.count; v++)
+                {
+                    int idv[3]= { 0, v -1, v };
+                    for(int i= 0; i < 3; i++)
+                    {
+                        int k= idv[i];
+                        int p= face.position(k);
+                        int t= face.texcoord(k);
+                        int n= face.normal(k);
+                        
+                        if(p < 0) break; // error
+                        
+                        // Mesh::texcoord( )
+                        if(t >= 0)
+                        {
+                            if(mesh_texcoords.size() <= mesh_positions.size())
+                                mesh_texcoords.push_back(texcoords[t]);
+                            else
+                                mesh_texcoords.back()= texcoords[t];
+                        }
+                        // Mesh::normal( )
+                        if(n >= 0)
+                        {
+                            if(mesh_normals.size() <= mesh_positions.size())
+                                mesh_normals.push_back(normals[n]);
+                            else
+                                mesh_normals.back()= normals[n];
+                        }
+                        
+                        // Mesh::vertex( ), copie les attributs du sommet precedent, s'ils ne sont pas definis
+                        mesh_positions.push_back(positions[p]);
+                        if(mesh_texcoords.size() > 0 && mesh_texcoords.size() != mesh_positions.size())
+                            mesh_texcoords.push_back(mesh_texcoords.back());
+                        if(mesh_normals.size() > 0 && mesh_normals.size() != mesh_positions.size())
+                            mesh_normals.push_back(mesh_normals.back());
+                        if(mesh_materials.size() > 0 && mesh_materials.size() < mesh_positions.size() / 3)
+                            mesh_materials.push_back(mesh_materials.back());
+                    }
+                }
+            }
+        }
+    }
+    
+    // construit le mesh, sans copier les sommets
+    Mesh data(GL_TRIANGLES, std::move(mesh_positions), std::move(mesh_texcoords), std::move(mesh_normals), std::vector<vec4>(), std::vector<unsigned>());
+    data.materials(obj.materials);
+    data.material_indices(std::move(mesh_materials));
+    
+    if(obj.error)
+        print_error(obj, "loading mesh", filename);
+    else
+        printf("mesh '%s': %d positions %s %s\n", filename, int(data.positions().size()), data.has_texcoord() ? "texcoord" : "", data.has_normal() ? "normal" : "");
+    
+    return data;
+}
+
+
+Mesh read_indexed_mesh_parallel( const char *filename )
+{
+    printf("loading indexed mesh '%s'...\n", filename);
+    
+    ObjFile obj;
+    if(!read_obj(obj, filename, true))
+    {
+        printf("[error] loading indexed mesh '%s'...\n", filename);
+        return Mesh::error();
+    }
+    
+    // faces incompletes ou sommets sans texcoord / normale : pas d'assemblage en parallele, utilise la version sequentielle
+    if(!obj.complete)
+        return read_indexed_mesh(filename);
+    
+    const std::vector<Chunk>& chunks= obj.chunks;
+    const int chunk_count= obj.chunk_count;
+    
+    // indexe les sommets de chaque bloc, dans l'ordre des faces
+    std::vector<VertexHash> tables(chunk_count);
+    std::vector<unsigned> indices(3 * obj.triangle_count);
+    std::vector<unsigned> mesh_materials(obj.triangle_count);
+    
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int c= 0; c < chunk_count; c++)
+    {
+        const Chunk& chunk= chunks[c];
+        VertexHash& remap= tables[c];
+        remap.reserve(chunk.idp.size());
+        
+        int triangle= chunk.first_triangle;
+        int face_count= int(chunk.faces.size()) -1;
+        unsigned group= 0;
+        for(int f= 0; f < face_count; f++)
+        {
+            while(group +1 < chunk.groups.size() && chunk.groups[group +1].face <= f)
+                group++;
+            
+            int material_id= chunk.groups[group].material;
+            Face face(chunk, f);
+            for(int v= 2; v < face.count; v++, triangle++)
+            {
+                int idv[3]= { 0, v -1, v };
+                for(int i= 0; i < 3; i++)
+                {
+                    int k= idv[i];
+                    bool inserted;
+                    indices[3*triangle + i]= remap.insert(vertex(material_id, face.position(k), face.texcoord(k), face.normal(k)), inserted);
+                }
+                
+                mesh_materials[triangle]= material_id;
+            }
+        }
+    }
+    
+    // fusionne les tables dans l'ordre des blocs : meme numerotation que read_indexed_mesh( )
+    VertexHash remap;
+    {
+        size_t n= 0;
+        for(int c= 0; c < chunk_count; c++)
+            n+= tables[c].size();
+        remap.reserve(n);
+    }
+    
+    std::vector<std::vector<int>> chunk_remaps(chunk_count);
+    for(int c= 0; c < chunk_count; c++)
+        chunk_remaps[c]= remap.merge(tables[c]);
+    
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int c= 0; c < chunk_count; c++)
+    {
+        const Chunk& chunk= chunks[c];
+        const std::vector<int>& chunk_remap= chunk_remaps[c];
+        for(int i= 3 * chunk.first_triangle; i < 3 * (chunk.first_triangle + chunk.triangles); i++)
+            indices[i]= chunk_remap[indices[i]];
+    }
+    
+    // copie les attributs des sommets
+    const std::vector<vertex>& vertices= remap.vertices();
+    std::vector<vec3> mesh_positions(vertices.size());
+    std::vector<vec2> mesh_texcoords(obj.use_texcoords ? vertices.size() : 0);
+    std::vector<vec3> mesh_normals(obj.use_normals ? vertices.size() : 0);
+    
+    #pragma omp parallel for
+    for(int i= 0; i < int(vertices.size()); i++)
+    {
+        mesh_positions[i]= obj.positions[vertices[i].position];
+        if(obj.use_texcoords) mesh_texcoords[i]= obj.texcoords[vertices[i].texcoord];
+        if(obj.use_normals) mesh_normals[i]= obj.normals[vertices[i].normal];
+    }
+    
+    // construit le mesh, sans copier les sommets ni les indices
+    Mesh data(GL_TRIANGLES, std::move(mesh_positions), std::move(mesh_texcoords), std::move(mesh_normals), std::vector<vec4>(), std::move(indices));
+    data.materials(obj.materials);
+    data.material_indices(std::move(mesh_materials));
+    
+    if(obj.error)
+        print_error(obj, "loading indexed mesh", filename);
+    else
+        printf("  %d indices, %d positions %d texcoords %d normals\n", 
+            int(data.indices().size()), int(data.positions().size()), int(data.texcoords().size()), int(data.normals().size()));
+    
+    return data;
+}
@@ -0,0 +1,24 @@
+#ifndef _OBJ_PARALLEL_H
+#define _OBJ_PARALLEL_H
+
+#include "mesh.h"
+
+
+//! \addtogroup objet3D
+///@{
+
+//! \file 
+//! charge un fichier wavefront .obj et construit un mesh. version parallele : le fichier est projete en memoire et decoupe en blocs de lignes, analyses sur tous les threads.
+
+/*! charge un fichier wavefront .obj et renvoie un mesh compose de triangles non indexes, identique au resultat de read_mesh( ). utiliser glDrawArrays pour l'afficher. a detruire avec Mesh::release( ).
+    les blocs sont analyses en parallele (openMP), puis assembles dans l'ordre du fichier : indices relatifs (negatifs), matieres (usemtl et mtllib).
+ */
+Mesh read_mesh_parallel( const char *filename );
+
+/*! charge un fichier wavefront .obj et renvoie un mesh compose de triangles indexes, identique au resultat de read_indexed_mesh( ). utiliser glDrawElements pour l'afficher. a detruire avec Mesh::release( ).
+    les sommets de chaque bloc sont indexes en parallele, cf VertexHash, puis les tables sont fusionnees dans l'ordre du fichier.
+ */
+Mesh read_indexed_mesh_parallel( const char *filename );
+
+///@}
+#endif
@@ -5,15 +5,31 @@
 // indice du sommet : gl_VertexID
 uniform mat4 mvpMatrix;
 uniform mat4 modelMatrix;
+#ifdef PACKED_VERTEX
+// sommets compresses, cf PackedMesh::definitions( )
+layout(location= 0) in PACKED_POSITION packed_position;
+layout(location= 1) in PACKED_TEXCOORD packed_texcoord;
+layout(location= 2) in PACKED_NORMAL packed_normal;
+#ifdef PACKED_INDIRECT
+// parametres de decodage de la cellule, attributs d'instance, cf PackedMesh::definitions(true)
+PACKED_GROUP
+#endif
+#else
 layout(location= 0) in vec3 position;
 layout(location= 1) in vec2 texcoord;
 layout(location= 2) in vec3 normal;
+#endif
 
 out vec3 normalVertex;
 out vec2 texcoordVertex; 
 
 void main( )
 {
+#ifdef PACKED_VERTEX
+    vec3 position= decode_position(packed_position);
+    vec2 texcoord= decode_texcoord(packed_texcoord);
+    vec3 normal= decode_normal(packed_normal);
+#endif
     gl_Position= mvpMatrix * vec4(position, 1);
     mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
     normalVertex = normalize(normalMatrix * normal);
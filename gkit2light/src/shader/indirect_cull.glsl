@@ -0,0 +1,134 @@
+//! \file indirect_cull.glsl elimination des cellules et des meshlets invisibles, ecrit les parametres des draws visibles, cf IndirectCuller.
+
+#version 430
+
+#ifdef COMPUTE_SHADER
+
+// meme organisation que dans indirect_cull.cpp
+struct Cell
+{
+    vec4 pmin;          // w : nombre de niveaux de details
+    vec4 pmax;
+    vec4 sphere;        // sphere englobante des niveaux de details
+    vec4 errors;        // erreur de chaque niveau
+};
+
+struct Candidate
+{
+    vec4 sphere;
+    uint first;
+    uint count;
+    uint cell;
+    uint level;         // niveau de details, + MESHLET pour les meshlets du niveau 0
+};
+
+struct Draw
+{
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    uint vertex_base;
+    uint instance_base;
+};
+
+const uint MESHLET= 0x100u;
+
+layout(binding= 4, std430) readonly buffer cellData
+{
+    Cell cells[];
+};
+
+layout(binding= 5, std430) readonly buffer candidateData
+{
+    Candidate candidates[];
+};
+
+layout(binding= 6, std430) writeonly buffer drawData
+{
+    Draw draws[];
+};
+
+layout(binding= 7, std430) buffer countData
+{
+    uint count;
+};
+
+uniform vec4 planes[6];         // plans du frustum, repere du monde, cf Frustum
+uniform vec3 camera;
+uniform float pixels_per_unit;
+uniform uint use_lods;
+uniform uint use_meshlets;
+
+// erreur projetee max, en pixels, cf select_lod( )
+const float max_pixels= 1;
+
+// meme test que Frustum::visible( ) : p-vertex, le sommet de la boite le plus loin dans la direction de la normale de chaque plan
+bool visible_box( const in vec3 pmin, const in vec3 pmax )
+{
+    for(int i= 0; i < 6; i++)
+    {
+        vec3 p= mix(pmin, pmax, greaterThanEqual(planes[i].xyz, vec3(0)));
+        if(dot(planes[i].xyz, p) + planes[i].w < 0)
+            return false;
+    }
+    return true;
+}
+
+bool visible_sphere( const in vec3 center, const in float radius )
+{
+    for(int i= 0; i < 6; i++)
+        if(dot(planes[i].xyz, center) + planes[i].w < -radius)
+            return false;
+    return true;
+}
+
+// meme choix que select_lod( )
+uint select_lod( const in Cell cell )
+{
+    float d= distance(camera, cell.sphere.xyz) - cell.sphere.w;
+    if(d <= 0)
+        return 0u;
+
+    for(int l= int(cell.pmin.w) -1; l > 0; l--)
+        if(cell.errors[l] * pixels_per_unit / d <= max_pixels)
+            return uint(l);
+    return 0u;
+}
+
+layout(local_size_x= 256) in;
+void main( )
+{
+    uint id= gl_GlobalInvocationID.x;
+    if(id >= candidates.length())
+        return;
+
+    Candidate candidate= candidates[id];
+    Cell cell= cells[candidate.cell];
+
+    // cellule en dehors du frustum
+    if(!visible_box(cell.pmin.xyz, cell.pmax.xyz))
+        return;
+
+    // un seul candidat par cellule : le niveau choisi, ou le niveau 0 complet, ou les meshlets du niveau 0
+    uint level= (use_lods != 0u) ? select_lod(cell) : 0u;
+    if(level > 0u || use_meshlets == 0u)
+    {
+        if(candidate.level != level)
+            return;
+    }
+    else
+    {
+        if(candidate.level != MESHLET)
+            return;
+
+        // meshlet en dehors du frustum. pas de test du cone des normales : les faces arrieres sont dessinees, cf MeshletCuller::visible_cone( )
+        if(!visible_sphere(candidate.sphere.xyz, candidate.sphere.w))
+            return;
+    }
+
+    // emet les parametres du draw, instance_base : indice de la cellule, selectionne ses parametres de decodage, cf PackedMesh::definitions(true)
+    uint index= atomicAdd(count, 1u);
+    draws[index]= Draw(candidate.count, 1u, candidate.first, 0u, candidate.cell);
+}
+
+#endif
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 
 #ifdef VERTEX_SHADER
 layout(location= 0) in vec3 position;
@@ -24,8 +24,12 @@ uniform sampler2D gDepth;
 // paramètres
 uniform mat4 invProjView;
 
-uniform vec3 lights[500];
-uniform uint nbLights; 
+// lumieres, premier indice + nombre de lumieres de chaque froxel, et indices des lumieres, cf LightClusters
+layout(std430, binding= 0) readonly buffer clusterLights { Light lights[]; };
+layout(std430, binding= 1) readonly buffer clusterRanges { uvec2 clusters[]; };
+layout(std430, binding= 2) readonly buffer clusterIndices { uint light_indices[]; };
+
+out vec4 fragment_color;
 
 vec3 reconstructWorldPos(vec2 uv)
 {
@@ -50,19 +54,28 @@ void main()
 
     vec3 pos = reconstructWorldPos(gl_FragCoord.xy);
 
-    float result = 0.4; 
-    for (uint i = 0u; i<nbLights; i++){
-        vec3 l = lights[i] - pos; 
-        float dist2 = length(l) * length(l) * 0.1;
+    // uniquement les lumieres du froxel qui contient le pixel
+    uvec2 cluster = clusters[cluster_index(gl_FragCoord.xy, depth)];
+
+    vec3 result = vec3(0.4); 
+    for (uint i = 0u; i < cluster.y; i++){
+        Light light = lights[light_indices[cluster.x + i]];
+        vec3 l = light.position.xyz - pos; 
+        float dist2 = dot(l, l);
+        float radius2 = light.position.w * light.position.w;
+        if (dist2 >= radius2)
+            continue;
 
-        vec3 l_dir = normalize(l);
+        vec3 l_dir = l * inversesqrt(dist2);
+        // attenuation, nulle au rayon d'influence
+        float window = 1.0 - (dist2 * dist2) / (radius2 * radius2);
 
-        float cos_theta = max(dot(normal, l_dir) / dist2, 0.0);
+        float cos_theta = max(dot(normal, l_dir) / (dist2 * 0.1), 0.0);
     
-        result += cos_theta ; 
+        result += light.color.rgb * light.color.a * cos_theta * window * window; 
     }
     vec3 color = albedo.rgb * result;
 
-    gl_FragColor = vec4(color, albedo.a);
+    fragment_color = vec4(color, albedo.a);
 }
 #endif
\ No newline at end of file
@@ -4,12 +4,20 @@
 // doit calculer la position d'un sommet dans le repere projectif
 // indice du sommet : gl_VertexID
 uniform mat4 mvpMatrix;
+#ifdef PACKED_VERTEX
+// sommets compresses, cf PackedMesh::definitions( )
+layout(location= 0) in PACKED_POSITION packed_position;
+#else
 layout(location= 0) in vec3 position;
+#endif
 
 out float height;
 
 void main( )
 {
+#ifdef PACKED_VERTEX
+    vec3 position= decode_position(packed_position);
+#endif
     height = position.y;
     gl_Position= mvpMatrix * vec4(position, 1);
 }
@@ -21,6 +21,8 @@
 #include "texture.h"
 
 #include "orbiter.h"
+#include "tiles.h"
+#include "sampling.h"
 
 #define EPSILON 0.00001f
 
@@ -127,38 +129,6 @@ struct Source : public Triangle
 };
 
 
-// construit un repere ortho tbn, a partir d'un seul vecteur...
-// cf "generating a consistently oriented tangent space" 
-// http://people.compute.dtu.dk/jerf/papers/abstracts/onb.html
-struct World
-{
-    World( const Vector& _n ) : n(_n) 
-    {
-        if(n.z < -0.9999999f)
-        {
-            t= Vector(0, -1, 0);
-            b= Vector(-1, 0, 0);
-        }
-        else
-        {
-            float a= 1.f / (1.f + n.z);
-            float d= -n.x * n.y * a;
-            t= Vector(1.f - n.x * n.x * a, d, -n.x);
-            b= Vector(d, 1.f - n.y * n.y * a, -n.y);
-        }
-    }
-    
-    Vector operator( ) ( const Vector& local )  const
-    {
-        return local.x * t + local.y * b + local.z * n;
-    }
-    
-    Vector t;
-    Vector b;
-    Vector n;
-};
-
-
 GLuint make_texture( const int unit, const int width, const int height )
 {
     GLuint texture;
@@ -295,35 +265,39 @@ struct IS : public App
                     point= hit.p;
                     normal= hit.n;
                     
-                    // frame
-                #pragma omp parallel for schedule(dynamic, 16)
-                    for(int y= 0; y < m_hitp.height(); y++)
-                    for(int x= 0; x < m_hitp.width(); x++)
-                    {
-                        // clear
-                        m_hitp(x, y)= Black();
-                        m_hitn(x, y)= Black();
-                        m_hitv(x, y)= Black();
-                        
-                        Point o= d0 + x*dx0 + y*dy0;
-                        Point e= d1 + x*dx1 + y*dy1;
-                        
-                        Ray ray(o, e);
-                        Hit hit;
-                        if(intersect(ray, hit))
+                    // frame, par blocs de pixels sur tous les threads
+                    TileScheduler scheduler(m_hitp.width(), m_hitp.height());
+                    scheduler.run(
+                        [&]( Tile& tile )
                         {
-                            m_hitp(x, y)= Color(hit.p.x, hit.p.y, hit.p.z);
-                            m_hitn(x, y)= Color(hit.n.x, hit.n.y, hit.n.z);
-                            
-                            Ray shadow(hit.p + hit.n * 0.001f, point + normal * 0.001f);
-                            Hit shadow_hit;
-                            int v= 1;
-                            if(intersect(shadow, shadow_hit))
-                                v= 0;
-                            
-                            m_hitv(x, y)= Color(v, v, v);
-                        }
-                    }
+                            for(int y= tile.y0; y < tile.y1; y++)
+                            for(int x= tile.x0; x < tile.x1; x++)
+                            {
+                                // clear
+                                m_hitp(x, y)= Black();
+                                m_hitn(x, y)= Black();
+                                m_hitv(x, y)= Black();
+                                
+                                Point o= d0 + x*dx0 + y*dy0;
+                                Point e= d1 + x*dx1 + y*dy1;
+                                
+                                Ray ray(o, e);
+                                Hit hit;
+                                if(intersect(ray, hit))
+                                {
+                                    m_hitp(x, y)= Color(hit.p.x, hit.p.y, hit.p.z);
+                                    m_hitn(x, y)= Color(hit.n.x, hit.n.y, hit.n.z);
+                                    
+                                    Ray shadow(hit.p + hit.n * 0.001f, point + normal * 0.001f);
+                                    Hit shadow_hit;
+                                    int v= 1;
+                                    if(intersect(shadow, shadow_hit))
+                                        v= 0;
+                                    
+                                    m_hitv(x, y)= Color(v, v, v);
+                                }
+                            }
+                        });
                     
                     // transferre les donnees
                     glActiveTexture(GL_TEXTURE0);
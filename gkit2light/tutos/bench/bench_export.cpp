@@ -0,0 +1,126 @@
+//! \file bench_export.cpp debit de write_mesh( ) : fprintf( ) par attribut, buffer formate sur 1 thread, ou sur plusieurs threads.
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <chrono>
+
+#include "vec.h"
+#include "mesh.h"
+#include "wavefront.h"
+
+
+// version de reference, fprintf( ) par attribut et par sommet de face.
+int write_mesh_fprintf( const Mesh& mesh, const char *filename )
+{
+    FILE *out= fopen(filename, "wt");
+    if(out == nullptr)
+        return -1;
+    
+    const std::vector<vec3>& positions= mesh.positions();
+    for(unsigned i= 0; i < positions.size(); i++)
+        fprintf(out, "v %f %f %f\n", positions[i].x, positions[i].y, positions[i].z);
+    fprintf(out, "\n");
+    
+    const std::vector<vec2>& texcoords= mesh.texcoords();
+    for(unsigned i= 0; i < texcoords.size(); i++)
+        fprintf(out, "vt %f %f\n", texcoords[i].x, texcoords[i].y);
+    fprintf(out, "\n");
+    
+    const std::vector<vec3>& normals= mesh.normals();
+    for(unsigned i= 0; i < normals.size(); i++)
+        fprintf(out, "vn %f %f %f\n", normals[i].x, normals[i].y, normals[i].z);
+    fprintf(out, "\n");
+    
+    const std::vector<unsigned>& indices= mesh.indices();
+    for(unsigned i= 0; i +2 < indices.size(); i+= 3)
+    {
+        fprintf(out, "f");
+        for(unsigned k= 0; k < 3; k++)
+            fprintf(out, " %u/%u/%u", indices[i+k] +1, indices[i+k] +1, indices[i+k] +1);
+        fprintf(out, "\n");
+    }
+    
+    fclose(out);
+    return 0;
+}
+
+// compare 2 fichiers
+bool same_files( const char *a, const char *b )
+{
+    FILE *fa= fopen(a, "rb");
+    FILE *fb= fopen(b, "rb");
+    bool same= (fa && fb);
+    std::vector<char> ba(1 << 20), bb(1 << 20);
+    while(same)
+    {
+        size_t na= fread(ba.data(), 1, ba.size(), fa);
+        size_t nb= fread(bb.data(), 1, bb.size(), fb);
+        same= (na == nb) && memcmp(ba.data(), bb.data(), na) == 0;
+        if(na == 0)
+            break;
+    }
+    if(fa) fclose(fa);
+    if(fb) fclose(fb);
+    return same;
+}
+
+long file_size( const char *filename )
+{
+    FILE *in= fopen(filename, "rb");
+    if(in == nullptr)
+        return 0;
+    fseek(in, 0, SEEK_END);
+    long size= ftell(in);
+    fclose(in);
+    return size;
+}
+
+
+int main( int argc, char **argv )
+{
+    // grille de n x n quads, 2n^2 triangles indexes. n= 708 : 1M triangles
+    int n= 708;
+    if(argc > 1) n= atoi(argv[1]);
+    
+    Mesh mesh(GL_TRIANGLES);
+    for(int y= 0; y <= n; y++)
+    for(int x= 0; x <= n; x++)
+    {
+        float u= float(x) / n;
+        float v= float(y) / n;
+        mesh.texcoord(u, v);
+        mesh.normal(std::sin(u * 7.f) * 0.1f, 1, std::cos(v * 5.f) * 0.1f);
+        mesh.vertex(u * 100 - 50, std::sin(u * 13.f) * std::cos(v * 11.f) * 3, v * 100 - 50);
+    }
+    for(int y= 0; y < n; y++)
+    for(int x= 0; x < n; x++)
+    {
+        int a= y * (n+1) + x;
+        mesh.triangle(a, a +1, a + n +2);
+        mesh.triangle(a, a + n +2, a + n +1);
+    }
+    printf("%d triangles, %d vertices\n", mesh.triangle_count(), mesh.vertex_count());
+    
+    const char *filenames[]= { "export_fprintf.obj", "export_buffer.obj", "export_parallel.obj" };
+    for(int i= 0; i < 3; i++)
+    {
+        auto start= std::chrono::high_resolution_clock::now();
+        if(i == 0)
+            write_mesh_fprintf(mesh, filenames[i]);
+        else
+            write_mesh(mesh, filenames[i], nullptr, /* parallel */ i == 2);
+        auto stop= std::chrono::high_resolution_clock::now();
+        
+        float time= std::chrono::duration<float>(stop - start).count();
+        long size= file_size(filenames[i]);
+        printf("%-20s %.3fs, %.1f MB/s, %.1f Mtriangles/s\n", filenames[i], time, size / time / 1e6f, mesh.triangle_count() / time / 1e6f);
+    }
+    
+    printf("identical files: %s\n", (same_files(filenames[0], filenames[1]) && same_files(filenames[0], filenames[2])) ? "yes" : "NO");
+    for(int i= 0; i < 3; i++)
+        remove(filenames[i]);
+    
+    return 0;
+}
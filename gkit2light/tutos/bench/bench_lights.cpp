@@ -0,0 +1,111 @@
+
+//! \file bench_lights.cpp mesure le temps de selection d'une source de lumiere : recherche lineaire, recherche dichotomique, table d'alias.
+
+#include <cstdio>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "light_sampler.h"
+#include "sampler.h"
+
+
+// recherche lineaire dans la fonction de repartition, cf version initiale de lancerRayons
+int select_linear( const std::vector<float>& cdf, const float u )
+{
+    for(int i= 0; i < int(cdf.size()); i++)
+        if(u < cdf[i])
+            return i;
+
+    return int(cdf.size()) -1;
+}
+
+
+template< typename F >
+double bench( const std::vector<float>& u, const int samples, F select )
+{
+    // accumule les indices pour que le compilateur ne supprime pas les calculs...
+    unsigned sum= 0;
+    auto start= std::chrono::high_resolution_clock::now();
+    for(int i= 0; i < samples; i++)
+        sum+= select(u[i]);
+    auto stop= std::chrono::high_resolution_clock::now();
+
+    if(sum == 1)
+        printf("!!\n");
+
+    return std::chrono::duration<double, std::nano>(stop - start).count() / samples;
+}
+
+
+int main( int argc, char **argv )
+{
+    const int counts[]= { 10, 10000, 1000000 };
+    const int samples= 4000000;
+
+    // nombres aleatoires generes a l'avance, pour ne mesurer que la selection
+    std::vector<float> u(samples);
+    {
+        PixelSampler sampler(1);
+        sampler.index(0, 0);
+        for(int i= 0; i < samples; i++)
+            u[i]= sampler.sample();
+    }
+
+    printf("%8s %14s %14s %14s %10s\n", "sources", "linear ns", "cdf ns", "alias ns", "max error");
+    for(int count : counts)
+    {
+        // sources : aire * puissance aleatoires, entre 1 et 100
+        PixelSampler sampler(count);
+        sampler.index(0, 0);
+
+        std::vector<int> ids(count);
+        std::vector<float> weights(count);
+        for(int i= 0; i < count; i++)
+        {
+            ids[i]= i;
+            weights[i]= 1 + 99 * sampler.sample();
+        }
+
+        LightSampler lights;
+        lights.build(ids, weights);
+
+        std::vector<float> cdf(count);
+        {
+            double total= 0;
+            for(int i= 0; i < count; i++)
+                total+= weights[i];
+
+            double cumul= 0;
+            for(int i= 0; i < count; i++)
+            {
+                cumul+= weights[i] / total;
+                cdf[i]= float(cumul);
+            }
+        }
+
+        // la recherche lineaire est trop lente pour beaucoup de sources, moins d'echantillons...
+        int linear_samples= std::max(1000, int(int64_t(samples) * 10 / count));
+        double linear= bench(u, linear_samples, [&]( const float x ) { return select_linear(cdf, x); });
+        double search= bench(u, samples, [&]( const float x ) { return lights.sample_cdf(x).triangle_id; });
+        double alias= bench(u, samples, [&]( const float x ) { return lights.sample(x).triangle_id; });
+
+        // verifie la distribution de la table d'alias sur les 10 sources
+        double error= 0;
+        if(count <= 10)
+        {
+            std::vector<int> histogram(count, 0);
+            for(int i= 0; i < samples; i++)
+                histogram[lights.sample(u[i]).triangle_id]++;
+
+            for(int i= 0; i < count; i++)
+                error= std::max(error, std::abs(double(histogram[i]) / samples - lights.pdf(i)) / lights.pdf(i));
+        }
+
+        printf("%8d %14.2f %14.2f %14.2f %10.4f\n", count, linear, search, alias, error);
+    }
+
+    return 0;
+}
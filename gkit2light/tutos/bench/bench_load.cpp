@@ -0,0 +1,115 @@
+//! \file bench_load.cpp temps de chargement et memoire max des differentes versions de read_mesh( ), et construction d'un mesh sommet par sommet, par blocs ou par deplacement.
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "vec.h"
+#include "mesh.h"
+#include "wavefront.h"
+#include "wavefront_fast.h"
+#include "wavefront_parallel.h"
+#include "mesh_cache.h"
+
+
+// memoire max utilisee par le processus, en Mo. la valeur ne diminue jamais : un seul test par execution.
+long peak_memory( )
+{
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+#else
+    return -1;
+#endif
+}
+
+// grille de n x n quads, sommets non indexes.
+void grid( const int n, std::vector<vec3>& positions, std::vector<vec2>& texcoords, std::vector<vec3>& normals )
+{
+    for(int y= 0; y < n; y++)
+    for(int x= 0; x < n; x++)
+    {
+        const int quad[6][2]= { {0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1} };
+        for(int i= 0; i < 6; i++)
+        {
+            float u= float(x + quad[i][0]) / n;
+            float v= float(y + quad[i][1]) / n;
+            positions.push_back( vec3(u, v, 0) );
+            texcoords.push_back( vec2(u, v) );
+            normals.push_back( vec3(0, 0, 1) );
+        }
+    }
+}
+
+
+int main( int argc, char **argv )
+{
+    if(argc < 2)
+    {
+        printf("usage: %s read_mesh|indexed|fast|indexed_fast|parallel|indexed_parallel|cache file.obj\n", argv[0]);
+        printf("usage: %s vertex|vertices|move [n]\n", argv[0]);
+        return 0;
+    }
+
+    const char *mode= argv[1];
+    const char *filename= (argc > 2) ? argv[2] : "data/bigguy.obj";
+
+    Mesh mesh;
+    auto start= std::chrono::high_resolution_clock::now();
+    if(strcmp(mode, "read_mesh") == 0) mesh= read_mesh(filename);
+    else if(strcmp(mode, "indexed") == 0) mesh= read_indexed_mesh(filename);
+    else if(strcmp(mode, "fast") == 0) mesh= read_mesh_fast(filename);
+    else if(strcmp(mode, "indexed_fast") == 0) mesh= read_indexed_mesh_fast(filename);
+    else if(strcmp(mode, "parallel") == 0) mesh= read_mesh_parallel(filename);
+    else if(strcmp(mode, "indexed_parallel") == 0) mesh= read_indexed_mesh_parallel(filename);
+    else if(strcmp(mode, "cache") == 0) mesh= read_mesh_cache(filename);
+    else
+    {
+        // construction d'un mesh, a partir de sommets deja en memoire
+        int n= (argc > 2) ? atoi(argv[2]) : 1000;
+        std::vector<vec3> positions;
+        std::vector<vec2> texcoords;
+        std::vector<vec3> normals;
+        grid(n, positions, texcoords, normals);
+
+        start= std::chrono::high_resolution_clock::now();
+        if(strcmp(mode, "vertex") == 0)
+        {
+            // sommet par sommet
+            mesh= Mesh(GL_TRIANGLES);
+            for(unsigned i= 0; i < positions.size(); i++)
+                mesh.texcoord(texcoords[i]).normal(normals[i]).vertex(positions[i]);
+        }
+        else if(strcmp(mode, "vertices") == 0)
+        {
+            // par blocs, une ligne de la grille a la fois
+            mesh= Mesh(GL_TRIANGLES);
+            mesh.reserve(int(positions.size()), 0, true, true);
+            for(unsigned i= 0; i < positions.size(); i+= 6*n)
+                mesh.vertices(6*n, positions.data() + i, texcoords.data() + i, normals.data() + i);
+        }
+        else if(strcmp(mode, "move") == 0)
+            // deplace les tableaux, sans copie
+            mesh= Mesh(GL_TRIANGLES, std::move(positions), std::move(texcoords), std::move(normals), std::vector<vec4>(), std::vector<unsigned>());
+        else
+        {
+            printf("[error] unknown mode '%s'...\n", mode);
+            return 1;
+        }
+    }
+    auto stop= std::chrono::high_resolution_clock::now();
+    int cpu= int(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+
+    if(mesh == Mesh::error() || mesh.vertex_count() == 0)
+        return 1;
+
+    printf("%s: %dms, peak memory %ldMB, %d vertices, %d indices\n", mode, cpu, peak_memory(), mesh.vertex_count(), mesh.index_count());
+    return 0;
+}
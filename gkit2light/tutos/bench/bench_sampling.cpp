@@ -0,0 +1,149 @@
+
+//! \file bench_sampling.cpp compare l'erreur de l'eclairage direct estime en echantillonnant l'hemisphere : directions uniformes ou cos theta, nombres aleatoires ou sequences a faible discrepance.
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+
+#include "vec.h"
+#include "mat.h"
+#include "color.h"
+#include "mesh.h"
+#include "wavefront.h"
+#include "orbiter.h"
+#include "bvh.h"
+#include "sampler.h"
+#include "sampling.h"
+
+
+// point visible dans un pixel
+struct PixelHit
+{
+    Point p;
+    Vector n;
+};
+
+// estime l'eclairage direct du point, N directions, uniformes ou cos theta
+template< typename Sampler >
+float estimate( const Mesh& mesh, const BVH& bvh, const PixelHit& hit, const bool cosine, Sampler& sampler, const unsigned pixel, const int N )
+{
+    World world(hit.n);
+    double sum= 0;
+    for(int i= 0; i < N; i++)
+    {
+        sampler.index(pixel, i);
+        float u1= sampler.sample();
+        float u2= sampler.sample();
+
+        Vector local= cosine ? sample_cosine_hemisphere(u1, u2) : sample_uniform_hemisphere(u1, u2);
+        float pdf= cosine ? pdf_cosine_hemisphere(local.z) : pdf_uniform_hemisphere();
+        if(pdf <= 0)
+            continue;
+
+        Ray ray(hit.p, world(local));
+        if(Hit h= bvh.intersect(ray))
+            sum+= mesh.triangle_material(h.triangle_id).emission.power() * local.z / pdf;
+    }
+
+    return float(sum / N);
+}
+
+// erreur quadratique moyenne sur tous les pixels
+template< typename Sampler >
+double mse( const Mesh& mesh, const BVH& bvh, const std::vector<PixelHit>& hits, const std::vector<float>& reference, const bool cosine, const int N )
+{
+    Sampler sampler(1);
+    double error= 0;
+    for(unsigned i= 0; i < hits.size(); i++)
+    {
+        float e= estimate(mesh, bvh, hits[i], cosine, sampler, i, N) - reference[i];
+        error+= double(e) * double(e);
+    }
+
+    return error / hits.size();
+}
+
+
+int main( int argc, char **argv )
+{
+    const char *mesh_filename= "data/cornell.obj";
+    const char *orbiter_filename= "data/cornell_orbiter.txt";
+    if(argc > 1) mesh_filename= argv[1];
+    if(argc > 2) orbiter_filename= argv[2];
+
+    Mesh mesh= read_mesh(mesh_filename);
+    if(mesh.triangle_count() == 0)
+        return 1;
+
+    Orbiter camera;
+    if(argc > 1 && argc < 3)
+    {
+        Point pmin, pmax;
+        mesh.bounds(pmin, pmax);
+        camera.lookat(pmin, pmax);
+    }
+    else if(camera.read_orbiter(orbiter_filename) < 0)
+        return 1;
+
+    std::vector<Triangle> triangles;
+    for(int i= 0; i < mesh.triangle_count(); i++)
+        triangles.emplace_back(mesh.triangle(i), i);
+
+    BVH bvh;
+    bvh.build(triangles);
+
+    // points visibles d'une petite image
+    int width= 64;
+    int height= 48;
+    camera.projection(width, height, 45);
+    Transform inv= Inverse(camera.viewport() * camera.projection() * camera.view());
+
+    std::vector<PixelHit> hits;
+    for(int y= 0; y < height; y++)
+    for(int x= 0; x < width; x++)
+    {
+        Ray ray(inv(Point(x + 0.5f, y + 0.5f, 0)), inv(Point(x + 0.5f, y + 0.5f, 1)));
+        if(Hit hit= bvh.intersect(ray))
+        {
+            const TriangleData& data= mesh.triangle(hit.triangle_id);
+            float w= 1 - hit.u - hit.v;
+            Vector n= normalize(w * Vector(data.na) + hit.u * Vector(data.nb) + hit.v * Vector(data.nc));
+            if(dot(n, ray.d) > 0)
+                n= -n;
+
+            hits.push_back( { ray.o + hit.t * ray.d + 0.0001f * n, n } );
+        }
+    }
+
+    // reference : beaucoup de directions cos theta, sequence de Sobol
+    const int reference_samples= 4096;
+    std::vector<float> reference(hits.size());
+    {
+        SobolSampler sampler(12345);
+        for(unsigned i= 0; i < hits.size(); i++)
+            reference[i]= estimate(mesh, bvh, hits[i], true, sampler, i, reference_samples);
+    }
+
+    printf("%d pixels, reference %d samples\n", int(hits.size()), reference_samples);
+    printf("%6s %18s %18s %18s %18s %18s\n", "N", "uniform random", "cosine random", "cosine pcg", "cosine sobol", "cosine r2");
+
+    const int counts[]= { 4, 16, 64, 256 };
+    for(int N : counts)
+    {
+        auto start= std::chrono::high_resolution_clock::now();
+        double uniform= mse<PixelSampler>(mesh, bvh, hits, reference, false, N);
+        double cosine= mse<PixelSampler>(mesh, bvh, hits, reference, true, N);
+        double pcg= mse<PixelSamplerPCG>(mesh, bvh, hits, reference, true, N);
+        double sobol= mse<SobolSampler>(mesh, bvh, hits, reference, true, N);
+        double r2= mse<R2Sampler>(mesh, bvh, hits, reference, true, N);
+        auto stop= std::chrono::high_resolution_clock::now();
+
+        // mse, et gain par rapport a la methode actuelle, directions uniformes
+        printf("%6d %10.5f (x%4.1f) %10.5f (x%4.1f) %10.5f (x%4.1f) %10.5f (x%4.1f) %10.5f (x%4.1f)  %dms\n", N,
+            uniform, 1.0, cosine, uniform / cosine, pcg, uniform / pcg, sobol, uniform / sobol, r2, uniform / r2,
+            int(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count()));
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+
+//! \file bench_triangles.cpp mesure le debit des tests rayon / triangles : version scalaire AoS, paquets SoA scalaire, sse et avx2.
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+#include "vec.h"
+#include "mat.h"
+#include "mesh.h"
+#include "wavefront.h"
+#include "orbiter.h"
+#include "simd_triangles.h"
+
+
+// lance les rayons, renvoie le debit en millions de rayons par seconde
+double bench( const std::vector<Ray>& rays, std::vector<Hit>& hits, const std::function<void (std::vector<Hit>& hits)>& run )
+{
+    auto start= std::chrono::high_resolution_clock::now();
+    run(hits);
+    auto stop= std::chrono::high_resolution_clock::now();
+
+    double seconds= std::chrono::duration<double>(stop - start).count();
+    double mrays= rays.size() / seconds / 1000000;
+    return mrays;
+}
+
+// compare avec les resultats de reference, renvoie le nombre de differences
+int compare( const std::vector<Hit>& reference, const std::vector<Hit>& hits )
+{
+    int errors= 0;
+    for(unsigned i= 0; i < reference.size(); i++)
+    {
+        if(bool(reference[i]) != bool(hits[i]))
+            errors++;
+        else if(reference[i] && std::abs(reference[i].t - hits[i].t) > 1e-5f * std::max(1.f, reference[i].t))
+            errors++;
+    }
+    return errors;
+}
+
+
+int main( int argc, char **argv )
+{
+    const char *mesh_filename= "data/cornell.obj";
+    const char *orbiter_filename= "data/cornell_orbiter.txt";
+    if(argc > 1) mesh_filename= argv[1];
+    if(argc > 2) orbiter_filename= argv[2];
+
+    Mesh mesh= read_mesh(mesh_filename);
+    if(mesh.triangle_count() == 0)
+        return 1;
+
+    Orbiter camera;
+    if(argc > 1 && argc < 3)
+    {
+        Point pmin, pmax;
+        mesh.bounds(pmin, pmax);
+        camera.lookat(pmin, pmax);
+    }
+    else if(camera.read_orbiter(orbiter_filename) < 0)
+        return 1;
+
+    std::vector<Triangle> triangles;
+    for(int i= 0; i < mesh.triangle_count(); i++)
+        triangles.emplace_back(mesh.triangle(i), i);
+
+    TriangleSoA soa(triangles);
+
+    // rayons de la camera, 1 par pixel, image 256x192 : tous les rayons testent tous les triangles...
+    int width= 256;
+    int height= 192;
+    camera.projection(width, height, 45);
+    Transform inv= Inverse(camera.viewport() * camera.projection() * camera.view());
+
+    std::vector<Ray> rays;
+    for(int y= 0; y < height; y++)
+    for(int x= 0; x < width; x++)
+    {
+        Point o= inv(Point(x + 0.5f, y + 0.5f, 0));
+        Point e= inv(Point(x + 0.5f, y + 0.5f, 1));
+        rays.push_back( Ray(o, e) );
+    }
+
+    printf("%d triangles, %d rays\n", int(triangles.size()), int(rays.size()));
+
+    // reference, version scalaire AoS
+    std::vector<Hit> reference(rays.size());
+    double mrays= bench(rays, reference,
+        [&]( std::vector<Hit>& hits )
+        {
+            for(unsigned i= 0; i < rays.size(); i++)
+            {
+                Hit hit;
+                hit.t= rays[i].tmax;
+                for(unsigned k= 0; k < triangles.size(); k++)
+                    if(Hit h= triangles[k].intersect(rays[i], hit.t))
+                        hit= h;
+                hits[i]= hit;
+            }
+        });
+    printf("%-24s %8.2f Mrays/s\n", "scalar AoS", mrays);
+
+    // 1 rayon / 8 triangles
+    typedef void (*BlockKernel)( const TriangleBlock&, const Ray&, HitBlock& );
+    std::vector<std::pair<const char *, BlockKernel>> block_kernels;
+    block_kernels.push_back( { "1x8 scalar SoA", intersect_scalar } );
+#ifdef GK_SSE
+    block_kernels.push_back( { "1x8 sse", intersect_sse } );
+#endif
+#ifdef __AVX2__
+    block_kernels.push_back( { "1x8 avx2", intersect_avx2 } );
+#endif
+
+    for(auto& kernel : block_kernels)
+    {
+        std::vector<Hit> hits(rays.size());
+        double mrays= bench(rays, hits,
+            [&]( std::vector<Hit>& hits )
+            {
+                for(unsigned i= 0; i < rays.size(); i++)
+                {
+                    HitBlock block(rays[i].tmax);
+                    for(unsigned k= 0; k < soa.blocks.size(); k++)
+                        kernel.second(soa.blocks[k], rays[i], block);
+                    hits[i]= block.closest();
+                }
+            });
+        printf("%-24s %8.2f Mrays/s, %d errors\n", kernel.first, mrays, compare(reference, hits));
+    }
+
+    // 8 rayons / 1 triangle
+    typedef void (*RayKernel)( const Triangle&, const RayBlock&, HitBlock& );
+    std::vector<std::pair<const char *, RayKernel>> ray_kernels;
+    ray_kernels.push_back( { "8x1 scalar SoA", intersect_scalar } );
+#ifdef GK_SSE
+    ray_kernels.push_back( { "8x1 sse", intersect_sse } );
+#endif
+#ifdef __AVX2__
+    ray_kernels.push_back( { "8x1 avx2", intersect_avx2 } );
+#endif
+
+    for(auto& kernel : ray_kernels)
+    {
+        std::vector<Hit> hits(rays.size());
+        double mrays= bench(rays, hits,
+            [&]( std::vector<Hit>& hits )
+            {
+                for(unsigned i= 0; i + 8 <= rays.size(); i+= 8)
+                {
+                    RayBlock block;
+                    HitBlock hit_block;
+                    for(int k= 0; k < 8; k++)
+                    {
+                        block.set(k, rays[i+k]);
+                        hit_block.t[k]= rays[i+k].tmax;
+                    }
+
+                    for(unsigned k= 0; k < triangles.size(); k++)
+                        kernel.second(triangles[k], block, hit_block);
+
+                    for(int k= 0; k < 8; k++)
+                        hits[i+k]= hit_block.hit(k);
+                }
+            });
+        printf("%-24s %8.2f Mrays/s, %d errors\n", kernel.first, mrays, compare(reference, hits));
+    }
+
+    return 0;
+}
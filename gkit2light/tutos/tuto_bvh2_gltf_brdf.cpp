@@ -13,6 +13,7 @@
 #include "image_io.h"
 #include "orbiter.h"
 #include "gltf.h"
+#include "tiles.h"
 
 
 //! rayon.
@@ -627,7 +628,8 @@ int main( int argc, char **argv )
         // parcourir les mesh
         printf("%d meshes\n", int(scene.meshes.size()));
         
-    #pragma omp parallel for
+        // les mesh n'ont pas tous le meme nombre de triangles, distribue les mesh 1 par 1 aux threads
+    #pragma omp parallel for schedule(dynamic, 1)
         for(unsigned mesh_id= 0; mesh_id < scene.meshes.size(); mesh_id++)
         {
             const GLTFMesh& mesh= scene.meshes[mesh_id];
@@ -694,29 +696,34 @@ int main( int argc, char **argv )
     Transform inv= Inverse(viewport * projection * view * model);
     
     
-    // calcule l'image en parallele avec openMP
-#pragma omp parallel for
-    for(int y= 0; y < image.height(); y++)
-    for(int x= 0; x < image.width(); x++)
-    {
-        // genere le rayon pour le pixel x,y
-        Point o= inv( Point(x, y, 0) ); // origine
-        Point e= inv( Point(x, y, 1) ); // extremite
-        Ray ray(o, Vector(o, e));
-        
-        // intersections !
-        if(Hit hit= top_bvh.intersect(ray))
+    // calcule l'image en parallele, par blocs de pixels, cf TileScheduler
+    TileScheduler scheduler(image.width(), image.height());
+    int cpu= scheduler.run(
+        [&]( Tile& tile )
         {
-            // evalue les parametres de la matiere au point d'intersection
-            Brdf fr= hit_brdf(hit, scene, textures);
-            
-            float cos_theta= std::abs(dot(fr.n, normalize(ray.d)));
-            Color color= fr.diffuse * cos_theta;
-            
-            image(x, y)= Color(color, 1);
-        }
-    }
-    printf("\n");
+            for(int y= tile.y0; y < tile.y1; y++)
+            for(int x= tile.x0; x < tile.x1; x++)
+            {
+                // genere le rayon pour le pixel x,y
+                Point o= inv( Point(x, y, 0) ); // origine
+                Point e= inv( Point(x, y, 1) ); // extremite
+                Ray ray(o, Vector(o, e));
+                
+                // intersections !
+                if(Hit hit= top_bvh.intersect(ray))
+                {
+                    // evalue les parametres de la matiere au point d'intersection
+                    Brdf fr= hit_brdf(hit, scene, textures);
+                    
+                    float cos_theta= std::abs(dot(fr.n, normalize(ray.d)));
+                    Color color= fr.diffuse * cos_theta;
+                    
+                    image(x, y)= Color(color, 1);
+                }
+            }
+        },
+        print_progress);
+    printf("%dms\n", cpu);
     
     write_image(image, "render.png");
     return 0;